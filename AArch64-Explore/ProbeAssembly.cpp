@@ -0,0 +1,581 @@
+//
+//  ProbeAssembly.cpp
+//  AArch64-Explore
+//
+//  The assembly probes: each one's builder and its registration.
+//
+
+#include <iostream>
+
+#include "General.h"
+#include "dataBuffer.h"
+#include "assemblyProbe.h"
+
+//The probe builders below are written in the encoder's mnemonics.
+using namespace A64;
+//=============================================================================
+
+/*
+	Each probe is written as the body of the inner loop, for pp.probeCount
+	copies of whatever is being tested; see PerformAssemblyProbe() in main.cpp
+	for the code around it, and for what the registers hold on entry (x1 is
+	always the data buffer).
+*/
+//-----------------------------------------------------------------------------
+
+struct ROBSize_NOPs_APD:AssemblyProbeData{
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp);
+};
+static ProbeRegistration gROBSize_NOPs({
+	.name="rob-nops", .construct=ConstructProbe<ROBSize_NOPs_APD>,
+	.lo=0, .hi=3600, .stride=20});
+
+uint ROBSize_NOPs_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	return AssemblyProbeExtend(ibuf, 0, pp);
+}
+
+int ROBSize_NOPs_APD::AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp)
+{
+	uint o=0;
+	
+	for(int i=fromCount; i<pp.probeCount; i++){
+		ibuf[o++] = nop();
+	}
+	return o;
+}
+//-----------------------------------------------------------------------------
+
+struct ZCL1_Registers_APD:AssemblyProbeData{
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp);
+};
+static ProbeRegistration gZCL1_Registers({
+	.name="zcl1-registers", .construct=ConstructProbe<ZCL1_Registers_APD>,
+	.lo=0, .hi=400, .stride=1,
+	.dataBytes=4_kiB,
+	.events={"LD_UNIT_UOP", "ST_UNIT_UOP", "ST_MEMORY_ORDER_VIOLATION_NONSPEC"},
+	.headings={"loads", "stores", "violations"}});
+
+uint ZCL1_Registers_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	uint o=0;
+
+	//Copy x1 to x2
+	ibuf[o++] = mov(x2, x1);
+
+//	ibuf[o++] = mov(x3, x1);
+//	ibuf[o++] = mov(x4, x1);
+	ibuf[o++] = add(x3, x1, 64);
+//	ibuf[o++] = add(x4, x1, 64);
+	ibuf[o++] = add(x5, x1, 64);
+	ibuf[o++] = add(x6, x1, 128);
+	ibuf[o++] = add(x7, x1, 192);
+	ibuf[o++] = mov(x10, 1);
+
+	return o+AssemblyProbeExtend(ibuf+o, 0, pp);
+}
+
+int ZCL1_Registers_APD::AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp)
+{
+	uint o=0;
+
+#if 0
+	for(int i=fromCount; i<pp.probeCount; i++){
+/*
+//Doesn't activate ZCL -- addresses don't "obviously" match
+		ibuf[o++] = str(x1, mem(x1));
+		ibuf[o++] = ldr(x2, mem(x2));
+*/
+
+/*
+//Activates ZCL (but slow validation)
+		ibuf[o++] = str(x1, mem(x2));
+		ibuf[o++] = ldr(x2, mem(x2));
+*/
+/*
+//Activates ZCL (faster validation)
+		ibuf[o++] = str(x1, mem(x2));
+		ibuf[o++] = ldr(x1, mem(x2));
+
+		ibuf[o++] = str(x3, mem(x4));
+		ibuf[o++] = ldr(x3, mem(x4));
+*/
+
+/*
+//Now with Fp/SIMD registers
+//Both cases see no acceleration.
+//Not obviously the same address
+//		ibuf[o++] = str(q0, mem(x1));
+//		ibuf[o++] = ldr(q0, mem(x2));
+
+//Obviously the same address:
+		ibuf[o++] = str(q0, mem(x1));
+		ibuf[o++] = ldr(q0, mem(x1));
+*/
+
+		ibuf[o++] = str(x1, mem(x2));
+		ibuf[o++] = add(x2, x2, 8);
+		ibuf[o++] = ldur(x1, mem(x2, -8));
+	}
+	return o;
+#endif //0
+
+//......................
+	enum LSType{
+		kIndependentLoadsAndStores,
+		kStoreSameAddressDiftRegister,
+		kStoreSameAddressSameRegister,
+		kLoadDiftAddressSameRegister,
+		kLoadSameAddressSameRegister,
+		kLoadFeedsStoreData,
+		kStoreAddressMatchesLoadAddress,
+		kStoreAddressMatchesLoadAddressWithDIV,
+		kStoreAddressRegMatchesLoadAddressRegWithDIV,
+		kStoreAddressRegMatchesLoadAddressReg,
+		};
+
+	auto lsType=kStoreAddressRegMatchesLoadAddressReg;
+	switch(lsType){
+
+	case kIndependentLoadsAndStores:
+//(a) independent loads and store
+//Two loads, two stores, one cycle per loop body
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = str(x0, mem(x5));
+			ibuf[o++] = ldr(x16, mem(x6));
+			ibuf[o++] = ldr(x17, mem(x7));
+		}break;
+
+	case kStoreSameAddressDiftRegister:
+//(b) Now store to the same address (but not using same address register)
+//Two loads, two stores, again one cycle per loop body
+//M1 can "consolidate" the two stores, doesn't have to serialize
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = str(x0, mem(x2));
+			ibuf[o++] = ldr(x16, mem(x6));
+			ibuf[o++] = ldr(x17, mem(x7));
+		}break;
+
+	case kStoreSameAddressSameRegister:
+//(c) Now store to the same address (using same address register)
+//Two loads, two stores, again one cycle per loop body
+//M1 can "consolidate" the two stores, doesnt have to serialize
+//In theory front end could "prune" this case, so we have net 3 LSU ops
+// (and higher throughput?), but we don't see that.
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = ldr(x16, mem(x6));
+			ibuf[o++] = ldr(x17, mem(x7));
+		}break;
+
+	case kLoadDiftAddressSameRegister:
+//(d) Now load to the register (frome dift addresses)
+//Two loads, two stores, again one cycle per loop body
+//In theory front end could "prune" the earlier load, so we have net 3 LSU ops
+// (and higher throughput?), but we don't see that.
+//(Of course earlier load would have to test against TLB, so not trivial...)
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = ldr(x16, mem(x6));
+			ibuf[o++] = ldr(x16, mem(x7));
+		}break;
+
+	case kLoadSameAddressSameRegister:
+//(d) Now store to the same address (using same address register)
+//Two loads, two stores, again one cycle per loop body
+//M1 can "consolidate" the two stores, doesnt have to serialize
+//In theory front end could "prune" this case, so we have net 3 LSU ops
+// (and higher throughput?), but we don't see that.
+//This case is easier because no TLB issue!
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = ldr(x16, mem(x6));
+			ibuf[o++] = ldr(x16, mem(x6));
+		}break;
+
+	case kLoadFeedsStoreData:
+//(e) Now store to the same address (using same address register)
+//Two loads, two stores, again one cycle per loop body
+//Still no problem. Each x0 loads to a different physical register, nothing
+// that can't easily be queued.
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = str(x0, mem(x1));
+			ibuf[o++] = ldr(x0, mem(x6));
+			ibuf[o++] = ldr(x17, mem(x7));
+		}break;
+
+	case kStoreAddressMatchesLoadAddress:
+//(f) Now the hard case.
+// Store to same address as load.
+// Naively the load has to serialize after the store, and that's what we see.
+// longterm, as 6 cycles per load/store.
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x1, mem(x1));
+			ibuf[o++] = ldr(x2, mem(x2));
+		}break;
+
+	case kStoreAddressMatchesLoadAddressWithDIV:
+//(g) Now the hard case
+// Store to same address as load, but add some extra work as DIV
+// Naively the load has to serialize after the store, and that's what we see.
+// But the DIV can overlap with the store, so ~3+8 cycles.
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x1, mem(x1));
+			ibuf[o++] = ldr(x2, mem(x2));
+			ibuf[o++] = udiv(x2, x2, x10);
+		}break;
+
+	case kStoreAddressRegMatchesLoadAddressRegWithDIV:
+//(h) Now the hard case (but we get saved by ZCL).
+// Store to same address as load, but add some extra work as DIV
+// Naively the load has to serialize after the store.
+// But the ZCL can see that the store feeds the load, so ~5.5 cycles
+// Add 8 NOPs to separate the STR and LDR and cycle count drops even further,
+// to ~3 cycles.
+		for(int i=fromCount; i<pp.probeCount; i++){
+			ibuf[o++] = str(x1, mem(x2));
+			ibuf[o++] = ldr(x2, mem(x2));
+			/*
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			*/
+			ibuf[o++] = udiv(x2, x2, x10);
+		}break;
+		
+		case kStoreAddressRegMatchesLoadAddressReg:
+		for(int i=fromCount; i<pp.probeCount; i++){
+/*
+//Doesn't activate ZCL -- addresses don't "obviously" match
+//~7 cycles per load/store
+			ibuf[o++] = str(x1, mem(x1));
+			ibuf[o++] = ldr(x2, mem(x2));
+*/
+/*
+//Maybe activates ZCL -- but x2 appears to change, so slow validation?
+//Still ~7 cycles per load/store, but speeds up DIV case.
+			ibuf[o++] = str(x1, mem(x2));
+			ibuf[o++] = ldr(x2, mem(x2));
+*/
+//Activates ZCL (faster validation)
+//~5 cycles
+			ibuf[o++] = str(x1, mem(x2));
+			ibuf[o++] = ldr(x1, mem(x2));
+//Compare with
+			//ibuf[o++] = str(x1, mem(x2));
+			//ibuf[o++] = ldr(x1, mem(x1));
+//same pattern, same values as far as LSU, LSDP etc are concerned (x1=x2)
+// this runs at ~7cycles because non-matching address registers means front-end
+// cannot ZCL.
+
+//Can the front-end track minor changes to addresses?
+//Patent says yes, but experiment says not yet:
+//We get the same result (usual ~7 cycles) whether or not we include the NOPs
+//below to try to activate the 2012 patent.
+			/*
+			ibuf[o++] = str(x1, mem(x2));
+			ibuf[o++] = add(x2, x2, 8);
+
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+
+			ibuf[o++] = ldur(x1, mem(x2, -8));
+			ibuf[o++] = sub(x2, x2, 8);
+
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			*/
+//What about FP?
+//Non-matching address registers: 7 cycles
+	//	ibuf[o++] = str(q0, mem(x1));
+	//	ibuf[o++] = ldr(q0, mem(x2));
+
+//Matching address registers: ALSO 7 cycles, so no ZCL
+	//	ibuf[o++] = str(q0, mem(x1));
+	//	ibuf[o++] = ldr(q0, mem(x1));
+		}break;
+		
+	}return o;
+}
+//-----------------------------------------------------------------------------
+
+struct ZCL2_Stack_APD:AssemblyProbeData{
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp);
+};
+static ProbeRegistration gZCL2_Stack({
+	.name="zcl2-stack", .construct=ConstructProbe<ZCL2_Stack_APD>,
+	.lo=0, .hi=400, .stride=1,
+	.events={"LD_UNIT_UOP", "ST_UNIT_UOP", "ST_MEMORY_ORDER_VIOLATION_NONSPEC"},
+	.headings={"loads", "stores", "violations"}});
+
+uint ZCL2_Stack_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	return AssemblyProbeExtend(ibuf, 0, pp);
+}
+
+int ZCL2_Stack_APD::AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp)
+{
+//Note that we are assuming a "large enough" red zone below the stack pointer,
+// which is dodgy for production code, but good enough for tests!
+	uint o=0;
+	
+	for(int i=fromCount; i<pp.probeCount; i++){
+//Store to stack then load from stack.
+//With no NOPs (so ZCL does not kick in) takes 7 cycles, with NOPs takes
+// ~2.5 cycles.
+//FP is not accelerated with or withoput NOPs.
+			ibuf[o++] = stp(x28, x27, mem(sp, -16));
+			//ibuf[o++] = stp(q0, q1, mem(sp, -80));
+			
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+
+			ibuf[o++] = ldp(x28, x27, mem(sp, -16));
+			//ibuf[o++] = ldp(q0, q1, mem(sp, -80));
+
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+			ibuf[o++] = nop();
+	}
+	return o;
+}
+//-----------------------------------------------------------------------------
+
+struct ZCL3_Stride_APD:AssemblyProbeData{
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp);
+};
+static ProbeRegistration gZCL3_Stride({
+	.name="zcl3-stride", .construct=ConstructProbe<ZCL3_Stride_APD>,
+	.lo=0, .hi=400, .stride=1,
+	.dataBytes=16_kiB,
+	.events={"LD_UNIT_UOP", "L1D_CACHE_MISS_LD"},
+	.headings={"loads", "L1D misses"}});
+
+uint ZCL3_Stride_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	uint o=0;
+
+	//Note that (as always) x1 will hold the address of the data buffer.
+	ibuf[o++] = mov(x10, 1);
+	ibuf[o++] = mov(x2, x1);
+
+	return o+AssemblyProbeExtend(ibuf+o, 0, pp);
+}
+
+int ZCL3_Stride_APD::AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp)
+{
+	uint o=0;
+
+	//Fill the databuffer appropriately (the part the new probes walk).
+	void** dataBuffer=static_cast<void**>(pp.dataBuffer);
+	for(int i=fromCount*2; i<pp.probeCount*2; i++){
+		dataBuffer[i]=&dataBuffer[i+1];
+	}
+
+	for(int i=fromCount; i<pp.probeCount; i++){
+		ibuf[o++] = ldr(x2, mem(x2));
+		//Throw in some NOPs if you like...
+		//ibuf[o++] = mul(x2, x2, x10);
+		ibuf[o++] = udiv(x2, x2, x10);
+		//Throw in some NOPs if you like...
+	}
+
+	return o;
+}
+//-----------------------------------------------------------------------------
+
+struct TLB_NumSimultaneousLookups_APD:AssemblyProbeData{
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp);
+};
+static ProbeRegistration gTLB_NumSimultaneousLookups({
+	.name="tlb-simultaneous-lookups", .construct=ConstructProbe<TLB_NumSimultaneousLookups_APD>,
+	.lo=0, .hi=400, .stride=1,
+	.dataBytes=64_kiB,
+	.events={"LD_UNIT_UOP", "SYNC_DTLB_MISS"},
+	.headings={"loads", "DTLB misses"}});
+
+uint TLB_NumSimultaneousLookups_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	uint o=0;
+	
+	//Create a base address offset by 32K since we can't encode that
+	// directly in a load.
+	ibuf[o++] = add(x3, x1, 32768);
+
+	ibuf[o++] = mov(x4, 16464);
+	ibuf[o++] = mov(x5, 32928);
+
+	return o+AssemblyProbeExtend(ibuf+o, 0, pp);
+}
+
+int TLB_NumSimultaneousLookups_APD::AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp)
+{
+	uint o=0;
+	
+	for(int i=fromCount; i<pp.probeCount; i++){
+//Three loads to same page. Takes 1 cycle.
+/*
+		ibuf[o++] = ldr(x2, mem(x1));
+		ibuf[o++] = ldr(x2, mem(x1, 8));
+		ibuf[o++] = ldr(x2, mem(x1, 16));
+*/
+//Three loads to two pages. Takes 1.4 cycles.
+/*
+		ibuf[o++] = ldr(x2, mem(x1));
+		ibuf[o++] = ldr(x2, mem(x1, 8));
+		ibuf[o++] = ldr(x2, mem(x1, 16384));
+*/
+//Three loads to three pages. Takes 2.5 cycles.
+/*
+		ibuf[o++] = ldr(x2, mem(x1));
+		ibuf[o++] = ldr(x2, mem(x1, 16384));
+		ibuf[o++] = ldr(x2, mem(x3));
+*/
+//Worst possible case. Keep changing the page address so no reuse of page lookups.
+/*
+		ibuf[o++] = ldr(x2, mem(x1));
+		ibuf[o++] = ldr(x2, mem(x1, x4));
+		ibuf[o++] = ldr(x2, mem(x1, x5));
+		ibuf[o++] = add(x1, x1, 49152);
+			//wrap around at 8 pages: 2 load per cycle. queue entries frequently matched
+		ibuf[o++] = and_(x1, x1, 0xfffffffffffdffff);
+			//wrap around at 16 pages: 1 load per cycle. queue entries never matched.
+		//ibuf[o++] = and_(x1, x1, 0xfffffffffffbffff);
+			//wrap around at 32 pages: 1 load per 2 cycles. Every load Replays?
+		//ibuf[o++] = and_(x1, x1, 0xfffffffffff7ffff);
+			//wrap around at 64 pages: 1 load per 2 cycles. Every load Replays?
+		//ibuf[o++] = and_(x1, x1, 0xffffffffffefffff);
+*/
+//Oh no, the above was not worst case. It can get FAR worse!
+// What it we split a load across a page boundary?
+// Forces microcode to kick, takes ~31 cycles per bad load.
+
+		ibuf[o++] = ldr(x2, mem(x1));
+		ibuf[o++] = ldr(x2, mem(x1));
+		ibuf[o++] = ldur(x2, mem(x3, -1));
+		
+	}
+	return o;
+}
+//-----------------------------------------------------------------------------
+
+struct L1D_TestWayPredictor_APD:AssemblyProbeData{
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp);
+};
+static ProbeRegistration gL1D_TestWayPredictor({
+	.name="l1d-way-predictor", .construct=ConstructProbe<L1D_TestWayPredictor_APD>,
+	.lo=0, .hi=8*400, .stride=64,
+	.dataBytes=kDefaultDataBufferSize,
+	.events={"LD_UNIT_UOP", "L1D_CACHE_MISS_LD"},
+	.headings={"loads", "L1D misses"}});
+
+uint L1D_TestWayPredictor_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	uint o=0;
+
+	//Fill the databuffer appropriately.
+	uint64_t* dataBuffer=static_cast<uint64_t*>(pp.dataBuffer);
+	for(int i=0; i<1000000; i++){
+		//This will fill 56M bytes, but buffer is 256MB in size so will fit.
+
+		dataBuffer[0]=(16119L<<32)|26296;
+		dataBuffer[1]=(29134L<<32)|16716;
+		dataBuffer[2]=(27337L<<32)|19203;
+		dataBuffer[3]=(22781L<<32)| 1290;
+		dataBuffer[4]=(26336L<<32)|15258;
+		dataBuffer[5]=( 1981L<<32)| 6166;
+		dataBuffer[6]=( 1030L<<32)|13888;
+/*
+		dataBuffer[0]=0;
+		dataBuffer[1]=0;
+		dataBuffer[2]=0;
+		dataBuffer[3]=0;
+		dataBuffer[4]=0;
+		dataBuffer[5]=0;
+		dataBuffer[6]=0;
+*/
+		dataBuffer+=7;
+	}
+	//Note that (as always) x1 will hold the address of the data buffer.
+	ibuf[o++] = add(x5, x1, 0);
+	ibuf[o++] = add(x6, x1, 64);
+	ibuf[o++] = add(x7, x1, 128);
+	ibuf[o++] = add(x8, x1, 192);
+	ibuf[o++] = add(x9, x1, 256);
+	ibuf[o++] = add(x10, x1, 320);
+	//Offset x9 and x10 to put them in different banks from x5 and x6
+	ibuf[o++] = add(x9, x9, 16);
+	ibuf[o++] = add(x10, x10, 16);
+	
+	ibuf[o++] = mov(x4, 0);
+
+	return o+AssemblyProbeExtend(ibuf+o, 0, pp);
+}
+
+int L1D_TestWayPredictor_APD::AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp)
+{
+	uint o=0;
+
+	//We emit whole blocks of 64, so can only extend from a block boundary.
+	if(fromCount%64!=0){return -1;}
+
+	for(int i=fromCount; i<pp.probeCount; i+=64){
+		//We specifically want x1 to just keep going through the buffer,
+		// without being reset at the start of each loop.
+		ibuf[o++] = ldr(x20, post(x1, 1));
+
+		for(int j=0; j<64; j++){
+			ibuf[o++] = bfi(x4, x20, 13, 3);
+			ibuf[o++] = ror(x20, x20, 1);
+
+			ibuf[o++] = ldrb(w15, mem(x5, x4));
+			ibuf[o++] = ldrb(w16, mem(x6, x4));
+			ibuf[o++] = ldrb(w17, mem(x7, x4));
+			ibuf[o++] = ldrb(w18, mem(x8, x4));
+			ibuf[o++] = ldrb(w19, mem(x9, x4));
+			ibuf[o++] = ldrb(w21, mem(x10, x4));
+		}
+	}
+	return o;
+}
+//=============================================================================
@@ -235,6 +235,9 @@ template<size_t l>
 */
 };
 
+static ProbeRegistration gL1CacheLineLength({
+	.name="l1-cache-line-length", .perform=PerformCacheProbe});
+
 void PerformCacheProbe(){//BandwidthProbeData& bpd){
 //loop over tests
 //need to turn this into multiple calls -- can't loop over template instantiatons
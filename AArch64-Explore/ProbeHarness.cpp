@@ -0,0 +1,90 @@
+//
+//  ProbeHarness.cpp
+//  AArch64-Explore
+//
+//  Measures the measurement machinery itself.
+//
+
+#include <iostream>
+
+#include "General.h"
+#include "Probes.h"
+#include "m1cycles.h"
+//=============================================================================
+
+/*
+	Every probe pays for the harness that times it. With the std::function
+	flavor of CycleAverager that is an indirect call per inner iteration,
+	plus whatever the compiler cannot do to a body it cannot see (keep
+	values in registers across iterations, schedule around the call, ...).
+	CycleAverager::Inline<kUnroll>() instead inlines the body, and unrolls.
+
+	To see just the harness, the bodies here are as close to nothing as we
+	can make them without the compiler deleting them:
+	- an empty asm volatile (no instructions, but cannot be removed), and
+	- one dependent add, which is about the cheapest real work there is,
+	  and tells us whether the harness disturbs a one cycle critical path.
+	The per-iteration difference between the rows is the harness overhead.
+*/
+
+static int const kHarnessInnerCount=1_M;
+static int const kHarnessOuterCount=5;
+
+static uint64_t volatile gSink;
+//.............................................................................
+
+template <typename F>
+  static void PrintHarnessRow(char const* name, F const& measure){
+	auto [cycles, ns]=measure();
+	cout<<setw(24)<<name
+	    <<setw(10)<<setprecision(2)<<cycles
+	    <<setw(10)<<setprecision(2)<<ns
+	    <<endl;
+}
+//=============================================================================
+
+static ProbeRegistration gHarness({.name="harness", .perform=PerformHarnessProbe});
+
+void PerformHarnessProbe(){
+	auto const
+	  hLine="---------------------------------------------------------------";
+
+	cout<<"Harness overhead per inner iteration"<<endl;
+	cout<<fixed<<setw(24)<<"harness"<<setw(10)<<"cycles"<<setw(10)<<"ns"<<endl;
+
+	CycleAverager cycleAverager(kHarnessInnerCount, kHarnessOuterCount);
+	auto empty=[](){asm volatile("");};
+
+	cout<<hLine<<endl<<"Empty body"<<endl;
+	PrintHarnessRow("std::function", [&](){
+		return cycleAverager(empty);
+	});
+	PrintHarnessRow("Inline<1>", [&](){
+		return cycleAverager.Inline<1>(empty);
+	});
+	PrintHarnessRow("Inline<8>", [&](){
+		return cycleAverager.Inline<8>(empty);
+	});
+
+	//The add chain: x lives in a register for the inlined variants, but has
+	// to be reloaded and stored around each std::function call.
+	//(The asm hides x from the optimizer, so the adds cannot be folded.)
+	uint64_t x=1;
+	auto add=[&](){
+		asm volatile("" : "+r" (x));
+		x++;
+	};
+
+	cout<<hLine<<endl<<"One dependent add"<<endl;
+	PrintHarnessRow("std::function", [&](){
+		return cycleAverager(add);
+	});
+	PrintHarnessRow("Inline<1>", [&](){
+		return cycleAverager.Inline<1>(add);
+	});
+	PrintHarnessRow("Inline<8>", [&](){
+		return cycleAverager.Inline<8>(add);
+	});
+	gSink=x;
+}
+//=============================================================================
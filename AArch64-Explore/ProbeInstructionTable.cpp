@@ -0,0 +1,333 @@
+//
+//  ProbeInstructionTable.cpp
+//  AArch64-Explore
+//
+//  Latency, throughput and pipe sharing for every instruction form we encode.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "General.h"
+#include "Probes.h"
+#include "dataBuffer.h"
+#include "corePlacement.h"
+#include "assemblyProbe.h"
+
+//The forms below are written in the encoder's mnemonics.
+using namespace A64;
+//=============================================================================
+#pragma mark Introduction
+/*
+	The same three experiments, by hand, for each new instruction get old
+	fast; this runs them for every form in kForms, and prints the table:
+	- latency: a chain of copies, each one's result the next one's first
+	  source. Cycles per copy.
+	- throughput: copies whose destinations rotate through 16 registers, and
+	  whose sources are never written, so nothing waits on anything.
+	  Cycles per copy (ie reciprocal throughput).
+	- pipe sharing, for every pair of forms: the two throughput streams
+	  interleaved, each rotating through its own 8 registers. If A and B
+	  issue to different pipes the pair costs max(tA, tB); if to the same
+	  pipes, tA+tB. We print where the pair falls between those, 0 to 1.
+	  (Meaningless if both are limited by the width of the machine rather
+	  than by their pipes: the pair then looks shared.)
+
+	Each point is one MeasureAssemblyProbe() (so the usual prologue, loop,
+	outer sampling and convergence), with kCopies copies in the loop body.
+
+	There are a few hundred points, and they are independent, so we fork
+	one worker per core place_on_core() could have chosen (see
+	equivalent_cpus()), each measuring every n'th point, pinned to its own
+	core with its own counters, code buffer and data buffer, and sending its
+	results back over a pipe. With --cpu there is just the one core, and we
+	measure in-process.
+
+	The registers, on entry to the body:
+	x2  chain register for X forms, =1
+	x3  source register for X forms, =1 (so udiv/sdiv divide by 1)
+	x4  chain register for loads, the data buffer, whose first word
+	    holds its own address (so ldr x4, [x4] chases itself)
+	x1  source (base) register for loads and stores, the data buffer
+	v2, v3  chain and source registers for FP/SIMD forms, =0
+	x8-x23, v8-v23  rotated destinations
+*/
+//=============================================================================
+
+static uint const kCopies=128;
+
+enum RegisterClass{kXRegs, kVRegs, kMemory};
+
+//A form is emitted as emit(d, n, m), register numbers: d the destination,
+// n the first source (the one a chain runs through), m any other.
+struct InstructionForm{
+	char const*   name;
+	RegisterClass dClass, nClass;
+	Instruction   (*emit)(uint d, uint n, uint m);
+	//Without a result of the class of its first source, there is no chain.
+	bool          fChain;
+};
+
+static InstructionForm const kForms[]={
+	{"add x, x, x",        kXRegs, kXRegs, [](uint d, uint n, uint m){return add(xreg(d), xreg(n), xreg(m));}, true},
+	{"add x, x, #imm",     kXRegs, kXRegs, [](uint d, uint n, uint m){return add(xreg(d), xreg(n), 1);}, true},
+	{"sub x, x, x",        kXRegs, kXRegs, [](uint d, uint n, uint m){return sub(xreg(d), xreg(n), xreg(m));}, true},
+	{"subs x, x, x",       kXRegs, kXRegs, [](uint d, uint n, uint m){return subs(xreg(d), xreg(n), xreg(m));}, true},
+	{"and x, x, x",        kXRegs, kXRegs, [](uint d, uint n, uint m){return and_(xreg(d), xreg(n), xreg(m));}, true},
+	{"orr x, x, x",        kXRegs, kXRegs, [](uint d, uint n, uint m){return orr(xreg(d), xreg(n), xreg(m));}, true},
+	{"eor x, x, x",        kXRegs, kXRegs, [](uint d, uint n, uint m){return eor(xreg(d), xreg(n), xreg(m));}, true},
+	{"and x, x, #imm",     kXRegs, kXRegs, [](uint d, uint n, uint m){return and_(xreg(d), xreg(n), 0xff);}, true},
+	{"orr x, x, #imm",     kXRegs, kXRegs, [](uint d, uint n, uint m){return orr(xreg(d), xreg(n), 0x100);}, true},
+	{"eor x, x, #imm",     kXRegs, kXRegs, [](uint d, uint n, uint m){return eor(xreg(d), xreg(n), 0x100);}, true},
+	{"mov x, x",           kXRegs, kXRegs, [](uint d, uint n, uint m){return mov(xreg(d), xreg(n));}, true},
+	{"mov x, #imm",        kXRegs, kXRegs, [](uint d, uint n, uint m){return movz(xreg(d), 0x1234);}, false},
+	{"movk x, #imm, lsl",  kXRegs, kXRegs, [](uint d, uint n, uint m){return movk(xreg(d), 0x1234, 16);}, false},
+	{"bfi x, x",           kXRegs, kXRegs, [](uint d, uint n, uint m){return bfi(xreg(d), xreg(n), 8, 8);}, true},
+	{"ror x, x, #imm",     kXRegs, kXRegs, [](uint d, uint n, uint m){return ror(xreg(d), xreg(n), 7);}, true},
+	{"mul x, x, x",        kXRegs, kXRegs, [](uint d, uint n, uint m){return mul(xreg(d), xreg(n), xreg(m));}, true},
+	{"madd x, x, x, x",    kXRegs, kXRegs, [](uint d, uint n, uint m){return madd(xreg(d), xreg(n), xreg(m), xreg(m));}, true},
+	{"udiv x, x, x",       kXRegs, kXRegs, [](uint d, uint n, uint m){return udiv(xreg(d), xreg(n), xreg(m));}, true},
+	{"sdiv x, x, x",       kXRegs, kXRegs, [](uint d, uint n, uint m){return sdiv(xreg(d), xreg(n), xreg(m));}, true},
+
+	{"ldr x, [x]",         kXRegs, kMemory, [](uint d, uint n, uint m){return ldr(xreg(d), mem(xreg(n)));}, true},
+	{"ldur x, [x]",        kXRegs, kMemory, [](uint d, uint n, uint m){return ldur(xreg(d), mem(xreg(n)));}, true},
+	{"ldr d, [x]",         kVRegs, kMemory, [](uint d, uint n, uint m){return ldr(dreg(d), mem(xreg(n)));}, false},
+	{"ldr q, [x]",         kVRegs, kMemory, [](uint d, uint n, uint m){return ldr(qreg(d), mem(xreg(n)));}, false},
+	{"ldp x, x, [x]",      kXRegs, kMemory, [](uint d, uint n, uint m){return ldp(xreg(d), xreg(d+8), mem(xreg(n)));}, false},
+	//Stores have no result: d is the data, and there is no chain.
+	{"str x, [x]",         kXRegs, kMemory, [](uint d, uint n, uint m){return str(xreg(d), mem(xreg(n), 64));}, false},
+	{"str q, [x]",         kVRegs, kMemory, [](uint d, uint n, uint m){return str(qreg(d), mem(xreg(n), 64));}, false},
+
+	{"fmov d, x",          kVRegs, kXRegs, [](uint d, uint n, uint m){return fmov(dreg(d), xreg(n));}, false},
+	{"fadd d, d, d",       kVRegs, kVRegs, [](uint d, uint n, uint m){return fadd(dreg(d), dreg(n), dreg(m));}, true},
+	{"fmul d, d, d",       kVRegs, kVRegs, [](uint d, uint n, uint m){return fmul(dreg(d), dreg(n), dreg(m));}, true},
+	{"fmadd d, d, d, d",   kVRegs, kVRegs, [](uint d, uint n, uint m){return fmadd(dreg(d), dreg(n), dreg(m), dreg(m));}, true},
+	{"mov v.16b, v.16b",   kVRegs, kVRegs, [](uint d, uint n, uint m){return mov16b(vreg(d), vreg(n));}, true},
+	{"orr v.16b, v, v",    kVRegs, kVRegs, [](uint d, uint n, uint m){return orr16b(vreg(d), vreg(n), vreg(m));}, true},
+	{"add v.4s, v, v",     kVRegs, kVRegs, [](uint d, uint n, uint m){return add4s(vreg(d), vreg(n), vreg(m));}, true},
+	{"fadd v.2d, v, v",    kVRegs, kVRegs, [](uint d, uint n, uint m){return fadd2d(vreg(d), vreg(n), vreg(m));}, true},
+	//fmla also reads its destination, so the throughput rotation is a
+	// 16-long chain; that is enough to cover its latency.
+	{"fmla v.2d, v, v",    kVRegs, kVRegs, [](uint d, uint n, uint m){return fmla2d(vreg(d), vreg(n), vreg(m));}, true},
+};
+static int const kNumForms=lengthof(kForms);
+//.............................................................................
+
+//Chain and source registers, by class (see the Introduction).
+static uint ChainRegister(RegisterClass c){
+	return (c==kMemory)? 4: 2;
+}
+static uint SourceRegister(RegisterClass c){
+	return (c==kMemory)? 1: 3;
+}
+static uint const kFirstRotated=8, kNumRotated=16;
+//=============================================================================
+#pragma mark Measurement
+
+//One point of the table: a latency or throughput for form a, or a mix of
+// the throughputs of forms a and b.
+struct TableJob{
+	enum Kind{kLatency, kThroughput, kMix};
+	Kind kind;
+	int  a, b;
+};
+
+struct InstructionTable_APD:AssemblyProbeData{
+	TableJob job;
+
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+};
+
+uint InstructionTable_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	uint o=0;
+
+	ibuf[o++] = mov(x2, 1);
+	ibuf[o++] = mov(x3, 1);
+	ibuf[o++] = str(x1, mem(x1));
+	ibuf[o++] = mov(x4, x1);
+
+	auto& a=kForms[job.a];
+	auto& b=kForms[job.b];
+	auto const half=kNumRotated/2;
+	//A pair of forms writing the same register file split the rotation.
+	auto fSplit=(job.kind==TableJob::kMix && a.dClass==b.dClass);
+	auto nA=fSplit? half: kNumRotated;
+
+	for(uint i=0; i<pp.probeCount; i++){
+		switch(job.kind){
+		case TableJob::kLatency:{
+			auto r=ChainRegister(a.nClass);
+			ibuf[o++] = a.emit(r, r, SourceRegister(a.dClass));
+			break;
+		}
+		case TableJob::kThroughput:
+			ibuf[o++] = a.emit(kFirstRotated+i%kNumRotated,
+			  SourceRegister(a.nClass), SourceRegister(a.dClass));
+			break;
+		case TableJob::kMix:
+			ibuf[o++] = a.emit(kFirstRotated+i%nA,
+			  SourceRegister(a.nClass), SourceRegister(a.dClass));
+			ibuf[o++] = b.emit(kFirstRotated+(fSplit? half+i%half: i%kNumRotated),
+			  SourceRegister(b.nClass), SourceRegister(b.dClass));
+			break;
+		}
+	}
+	return o;
+}
+//.............................................................................
+
+//Measures jobs[first], jobs[first+step], ... into results (cycles per copy,
+// or per pair of copies for a mix).
+static void MeasureJobs(vector<TableJob> const& jobs, int first, int step,
+  vector<double>& results){
+	auto dataBuffer=AllocateDataBuffer(4_kiB);
+	auto code=AcquireCodeBuffer();
+	if( !code.IsValid() ){exit(1);}
+
+	InstructionTable_APD apd;
+	ProbeParameters pp(nullptr, dataBuffer, kCopies);
+	for(auto j=first; j<jobs.size(); j+=step){
+		apd.job=jobs[j];
+		auto min=MeasureAssemblyProbe(pp, apd, code);
+		results[j]=min.cycles()/kCopies;
+		if(apd.fRetiredMismatch){
+			printf("%s (job %d): retired %.1f instructions per trip, built %.1f\n",
+			  kForms[jobs[j].a].name, j, min.retireds(), apd.expectedRetireds);
+		}
+	}
+	ReleaseCodeBuffer(code);
+}
+//.............................................................................
+
+//Measures every job, spread over one forked worker per equivalent cpu.
+static vector<double> MeasureAllJobs(vector<TableJob> const& jobs){
+	vector<double> results(jobs.size(), 0);
+	auto cpus=equivalent_cpus(kUsePCore);
+	int numWorkers=(int)cpus.size();
+	if(numWorkers==1){
+		MeasureJobs(jobs, 0, 1, results);
+		return results;
+	}
+
+	cout<<"Measuring on "<<numWorkers<<" cores"<<endl;
+	cout.flush();
+	fflush(stdout);
+	vector<pid_t> pids;
+	vector<int>   pipes;
+	for(auto w=0; w<numWorkers; w++){
+		int fds[2];
+		if( pipe(fds)!=0 ){
+			printf("pipe failed\n");
+			exit(1);
+		}
+		auto pid=fork();
+		if(pid<0){
+			printf("fork failed\n");
+			exit(1);
+		}
+		if(pid==0){
+			//The worker: its own core and counters, then its share.
+			close(fds[0]);
+			if(cpus[w]>=0){select_cpu(cpus[w]);}
+			setup_performance_counters(kUsePCore, NULL);
+			MeasureJobs(jobs, w, numWorkers, results);
+			//A result that does not get through fails the worker; the
+			// parent's read then comes up short, and it reports the worker.
+			for(auto j=w; j<jobs.size(); j+=numWorkers){
+				if( write(fds[1], &results[j], sizeof(double))!=sizeof(double) ){
+					printf("Worker %d could not send its results: %s\n", w, strerror(errno));
+					fflush(stdout);
+					_exit(1);
+				}
+			}
+			close(fds[1]);
+			fflush(stdout);
+			_exit(0);
+		}
+		close(fds[1]);
+		pids.push_back(pid);
+		pipes.push_back(fds[0]);
+	}
+
+	//Each worker's results are a few KiB at most, well within what a pipe
+	// buffers, so reading the workers in turn cannot deadlock.
+	for(auto w=0; w<numWorkers; w++){
+		for(auto j=w; j<jobs.size(); j+=numWorkers){
+			if( read(pipes[w], &results[j], sizeof(double))!=sizeof(double) ){
+				printf("Worker %d died\n", w);
+				exit(1);
+			}
+		}
+		close(pipes[w]);
+		waitpid(pids[w], NULL, 0);
+	}
+	return results;
+}
+//=============================================================================
+#pragma mark The table
+
+static ProbeRegistration gInstructionTable({
+	.name="instruction-table", .perform=PerformInstructionTableProbe});
+
+void PerformInstructionTableProbe(){
+	vector<TableJob> jobs;
+	for(auto a=0; a<kNumForms; a++){
+		if(kForms[a].fChain){jobs.push_back({TableJob::kLatency, a, a});}
+		jobs.push_back({TableJob::kThroughput, a, a});
+	}
+	for(auto a=0; a<kNumForms; a++){
+		for(auto b=a+1; b<kNumForms; b++){jobs.push_back({TableJob::kMix, a, b});}
+	}
+	auto results=MeasureAllJobs(jobs);
+
+	vector<double> latency(kNumForms, -1), throughput(kNumForms, 0);
+	vector<vector<double>> mix(kNumForms, vector<double>(kNumForms, 0));
+	for(auto j=0; j<jobs.size(); j++){
+		auto& job=jobs[j];
+		switch(job.kind){
+		case TableJob::kLatency:    latency   [job.a]=results[j];        break;
+		case TableJob::kThroughput: throughput[job.a]=results[j];        break;
+		case TableJob::kMix:        mix[job.a][job.b]=mix[job.b][job.a]=results[j]; break;
+		}
+	}
+
+	cout<<fixed<<left<<setw(24)<<"form"<<right
+	    <<setw(10)<<"latency"<<setw(12)<<"recip tput"<<setw(8)<<"IPC"<<endl;
+	for(auto a=0; a<kNumForms; a++){
+		cout<<setw(3)<<a<<" "<<left<<setw(20)<<kForms[a].name<<right;
+		if(latency[a]>=0){
+			cout<<setw(10)<<setprecision(2)<<latency[a];
+		}else{
+			cout<<setw(10)<<"-";
+		}
+		cout<<setw(12)<<setprecision(3)<<throughput[a]
+		    <<setw(8)<<setprecision(2)<<1/throughput[a]<<endl;
+	}
+
+	//0 = disjoint pipes, 1 = the same pipes (see the Introduction).
+	cout<<endl<<"Pipe sharing (0 disjoint .. 1 same)"<<endl<<"    ";
+	for(auto b=0; b<kNumForms; b++){cout<<setw(4)<<b;}
+	cout<<endl;
+	for(auto a=0; a<kNumForms; a++){
+		cout<<setw(3)<<a<<" ";
+		for(auto b=0; b<kNumForms; b++){
+			if(a==b){
+				cout<<setw(4)<<"";
+				continue;
+			}
+			auto tMax=max(throughput[a], throughput[b]);
+			auto tMin=min(throughput[a], throughput[b]);
+			auto sharing=(mix[a][b]-tMax)/tMin;
+			cout<<setw(4)<<setprecision(1)<<max(0.0, min(1.0, sharing));
+		}
+		cout<<endl;
+	}
+}
+//=============================================================================
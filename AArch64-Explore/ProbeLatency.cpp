@@ -16,6 +16,10 @@
 #include "General.h"
 #include "Probes.h"
 #include "m1cycles.h"
+#include "timebase.h"
+#include "corePlacement.h"
+#include "chainArena.h"
+#include "chainImage.h"
 //=============================================================================
 
 static auto const kFastMode=false;
@@ -49,38 +53,21 @@ const uint sizeofPage512K64 =16_kiB+64*5;
 const uint sizeofPage8K64   =16_kiB+64*3;
 */
 
-//The various node types we will construct.
-// Of course the base node is just a pointer to the next node. However to this
-//- first, we want to add adding, to ensure that the nodeSize is the size of a pointer,
-//  a cache, a page, or whatever.
-//- second, for a few speciality tests we want the node to have a payload, either
-//  ahead of or behind the "next" pointer.
-//  We do this via some trickery.
-//  Look at how the arrays for payload0 and payload1 work out.
-//  In the case of a node the size of a pointer, the array sizes are zero (legal in C++),
-//  and the payloads do not exist and take no space.
-// In every other case, the payloads take some space (each 8 bytes) but the result is
-// smaller than the padding size, so they overlap with padding.
-
-template <uint nodeSizeInB>
-  struct Node{
-	union{
-		struct{
-			uint64_t payload0[nodeSizeInB==sizeofPtr4];
-			Node<nodeSizeInB>* next;
-			uint64_t payload1[nodeSizeInB==sizeofPtr4];
-		};
-		std::byte padding[nodeSizeInB];
-	};
-};
-
-struct Node0{
-	uint64_t payload;
-	Node0* next;
-};
-struct Node1{
-	Node1* next;
-	uint64_t payload;
+//How the nodes of a chain are laid out. Every node is nodeBytes long (the
+// stride of the chain) and holds its next pointer nextOffset bytes in; the
+// reductions also read a payload word, payloadOffset bytes in. These are
+// all run time values, so any stride (8B to kMaxLatencyStrideBytes) can be
+// tried from the command line (see --stride in main.cpp) rather than by
+// instantiating a new Node<> template.
+//(The templated Node<N> this replaces was padded out to pointer alignment,
+// so Node<63>, Node<121> etc were really 64B, 128B, ... nodes. Here the
+// stride is exactly what is asked for; one that is not a multiple of 8
+// leaves some next pointers unaligned, or even split across lines, which
+// is legal, but a different experiment.)
+struct NodeLayout{
+	size_t nodeBytes;
+	size_t nextOffset   =0;
+	size_t payloadOffset=0;
 };
 
 uint64_t kZero=0;
@@ -89,14 +76,20 @@ uint64_t kOne=1;
 //-----------------------------------------------------------------------------
 
 static auto const kMaxDepthBytes   =kFastMode? 60_MiB: 1500_MiB;
-static auto const kMaxNumNodes     =kMaxDepthBytes/sizeofPtr;
 static int const kL1DepthTestBytes =8*128_kiB;
 //fix !!! back to 1M
-static int  const kMinInnerCount   =kFastMode? 500_k: 10_M;
+//With the counter overhead now subtracted, and outer samples added
+// adaptively until each point has converged, 2M is plenty.
+static int  const kMinInnerCount   =kFastMode? 500_k: 2_M;
+//Adaptive repetition: at least 3 outer samples, then more until the mean is
+// known to +-kTargetRelativeCI, or we have spent kPointBudgetNs on the point.
+static double const kTargetRelativeCI=kFastMode? 0.02: 0.005;
+static double const kPointBudgetNs   =kFastMode? 0.5E9: 2E9;
 
 //This is only used for some specialized tests of how many simultaneous
 // prefetchers we can have active.
 static int const kMaxNumHeads=32;
+static_assert(kMaxNumHeads<=kMaxChainImageHeads);
 //static int const kNumHeads=16;
 
 /*
@@ -268,60 +261,254 @@ enum TraversalPattern {
 };
 //.............................................................................
 
+/*
+	The random chains are built in place, in the links themselves, with no
+	vectors of indices to shuffle and then copy out. Two ways:
+	- Within a box, every node first links to itself; Sattolo's variant of
+	  the Fisher-Yates shuffle, run over those links, then leaves them one
+	  random cycle through all the nodes (plain Fisher-Yates would leave
+	  several).
+	- A whole chain (or the order of the boxes) is grown one node at a
+	  time, each new node k spliced in after a random one of the k already
+	  there. Each step leaves a uniformly random cycle if it starts with
+	  one, so the result is distributed just as Sattolo's is, and a chain
+	  can be grown from one depth to the next rather than rebuilt (see
+	  Extend()).
+	
+	The random numbers come from a counter-based generator: draw i of a
+	stream is a hash of (key, i), so it can be had without drawing 0..i-1.
+	That lets a build prefetch the node it will touch a few steps ahead,
+	lets every box of the box patterns have its own stream, and be built
+	on its own thread, and makes a chain grown to some depth exactly the
+	chain built at that depth, whatever the number of threads. (Each test
+	reports its build rate, and on how many threads it was built.)
+*/
+//Set by --chain-seed; the default is what std::mt19937 uses by default,
+// so the patterns still built with one are as they always were.
+static uint64_t g_chainSeed=5489;
+//Set by --chain-images (empty for none); see chainImage.h.
+static string g_chainImageDirectory;
+
+void SetLatencyChainSeed(uint64_t seed){g_chainSeed=seed;}
+void SetLatencyChainImages(string const& directory){g_chainImageDirectory=directory;}
+
+struct ChainRandom{
+	uint64_t key;
+	ChainRandom(uint64_t seed, uint64_t stream):
+	  key( seed^(stream*0xd1b54a32d192ed03ull) ){};
+
+	//Draw counter of the stream, scaled to 0..n-1 (by multiply and shift,
+	// whose bias, at most n/2^64, no latency test will ever see).
+	uint64_t operator()(uint64_t counter, uint64_t n) const{
+		//The SplitMix64 finalizer.
+		auto z=key+counter*0x9e3779b97f4a7c15ull;
+		z=(z^(z>>30))*0xbf58476d1ce4e5b9ull;
+		z=(z^(z>>27))*0x94d049bb133111ebull;
+		z=z^(z>>31);
+		return uint64_t( ((unsigned __int128)z*n)>>64 );
+	}
+};
+static size_t const kShufflePrefetchDistance=16;
+//Streams of g_chainSeed: 0 grows chains (and box orders), 1 is the box
+// pattern shared by every box of kSameRandomInBox, and 2+box the pattern
+// of each box in the others.
+static uint64_t const kGrowStream=0, kSameBoxStream=1, kFirstBoxStream=2;
+
+//In the box patterns, how the nodes within each box are ordered.
+enum InBoxOrder{kInBoxIncreasing, kInBoxSameRandom, kInBoxDiftRandom};
+//.............................................................................
+
 #define CLAMP_NUMNODES()													\
 	if(numNodes>1_M){numNodes=1_M;}
-template <class node_t>
-  struct PerformLatencyStruct{
+//How many chains a pattern lays out side by side.
+static int NumHeads(TraversalPattern traversalPattern){
+	switch(traversalPattern){
+	case kLinearIncreasing2: case kLinearIncreasing4:
+	case kLinearIncreasing8: case kLinearIncreasing16:
+		return 2<<(traversalPattern-kLinearIncreasing2);
+	case kLinearIncreasing2M: case kLinearIncreasing4M:
+	case kLinearIncreasing8M: case kLinearIncreasing16M:
+		return 2<<(traversalPattern-kLinearIncreasing2M);
+	default:
+		return 1;
+	}
+}
 
-	node_t nodes[kMaxNumNodes];
-	size_t depth, numNodes;
+struct PerformLatencyStruct{
+	NodeLayout layout;
+	std::byte* nodes;
+	size_t     depth, numNodes;
 
-	node_t listHeads[kMaxNumHeads];
+	TraversalPattern traversalPattern;
+	size_t     boxBytes;
+	//The nodes actually linked (numNodes can be clamped below this), and
+	// for the box patterns the node each box is left from.
+	size_t     builtNodes=0;
+	vector<size_t> boxLast;
+	//The most threads any part of the build ran on (only the box patterns
+	// build boxes in parallel).
+	size_t     buildThreads=1;
+	//Loaded from a chain image, so without what Extend() needs.
+	bool       fFromImage=false;
+
+	//Where each chain starts (only the multi-chain patterns have more than
+	// one).
+	void*      listHeads[kMaxNumHeads];
+
+	//Links point at the next pointer of the node they lead to, not at its
+	// start, so that following one is a single load whatever the layout.
+	void** Next(size_t ix) const{
+		return reinterpret_cast<void**>(
+		  nodes+ix*layout.nodeBytes+layout.nextOffset);
+	}
+	void Link(size_t from, size_t to){*Next(from)=Next(to);}
 
 	void ConvertIndexVectorToList(vector<uint> indicesT){
-		auto node=nodes;
+		size_t node=0;
 		for(auto j=1; j<indicesT.size(); j++){
 			auto ix=indicesT[j];
-			auto next=&nodes[ix];
-			node->next=next;
-			node=next;
+			Link(node, ix);
+			node=ix;
 		}
 	}
 
-	PerformLatencyStruct(size_t numNodes,
-	  TraversalPattern traversalPattern=kLinearIncreasing,
-	    size_t boxBytes=sizeofPage16K){
-	    
-	    this->depth=numNodes*sizeof(node_t);
-		
+	//Makes the count nodes first, first+stride, ... one random cycle, in
+	// place (see ChainRandom). Returns the node that links back to first.
+	size_t RandomCycle(size_t first, size_t count, size_t stride,
+	  ChainRandom const& random){
+		for(size_t i=0; i<count; i++){
+			Link(first+i*stride, first+i*stride);
+		}
+		//Track which node holds the link to first as the shuffle moves it.
+		auto last=first;
+		for(auto i=count-1; i>0; i--){
+			if(i>kShufflePrefetchDistance){
+				auto k=i-kShufflePrefetchDistance;
+				__builtin_prefetch(Next( first+random(k, k)*stride ), 1);
+			}
+			auto a=first+i*stride, b=first+random(i, i)*stride;
+			swap(*Next(a), *Next(b));
+			if(last==a){last=b;}else if(last==b){last=a;}
+		}
+		return last;
+	}
+
+	//Splices items from..to-1 into the cycle of items 0..from-1 (which is
+	// started, if from is 0), each after a random one of those before it
+	// (see ChainRandom). An item is a node, or a run of nodes (a box),
+	// entered at node entry(k) and left by the link in node exit(k).
+	template<typename EntryFn, typename ExitFn>
+	  void GrowCycle(size_t from, size_t to, EntryFn entry, ExitFn exit){
+		if(from==0 && to>0){
+			Link(exit(0), entry(0));
+			from=1;
+		}
+		ChainRandom random(g_chainSeed, kGrowStream);
+		for(auto k=from; k<to; k++){
+			if(k+kShufflePrefetchDistance<to){
+				auto ahead=k+kShufflePrefetchDistance;
+				__builtin_prefetch(Next( exit(random(ahead, ahead)) ), 1);
+			}
+			auto j=exit( random(k, k) );
+			*Next(exit(k))=*Next(j);
+			Link(j, entry(k));
+		}
+	}
+
+	//The box patterns: boxes of boxNodes nodes, each box's nodes in
+	// inBoxOrder from its first node, then on to the first node of the
+	// next box, the boxes in increasing or random order. Builds boxes
+	// fromBoxes..toBoxes-1 (in parallel; they are independent) and links
+	// them in after those already built.
+	void BoxChain(size_t boxNodes, size_t fromBoxes, size_t toBoxes,
+	  InBoxOrder inBoxOrder, bool fRandomBoxes){
+		boxLast.resize(toBoxes);
+		auto numThreads=run_on_equivalent_cpus(kUsePCore, toBoxes-fromBoxes,
+		  [&](size_t begin, size_t end){
+			for(auto box=fromBoxes+begin; box<fromBoxes+end; box++){
+				auto first=box*boxNodes;
+				auto& last=boxLast[box];
+				switch(inBoxOrder){
+				case kInBoxIncreasing:
+					last=first+boxNodes-1;
+					for(auto i=first; i<last; i++){
+						Link(i, i+1);
+					}
+					break;
+				case kInBoxSameRandom:
+					last=RandomCycle(first, boxNodes, 1,
+					  ChainRandom(g_chainSeed, kSameBoxStream));
+					break;
+				case kInBoxDiftRandom:
+					last=RandomCycle(first, boxNodes, 1,
+					  ChainRandom(g_chainSeed, kFirstBoxStream+box));
+					break;
+				}
+			}
+		});
+		buildThreads=max(buildThreads, numThreads);
+
+		//A box is entered at its first node, and left from boxLast.
+		if(fRandomBoxes){
+			GrowCycle(fromBoxes, toBoxes,
+			  [=](size_t box){return box*boxNodes;},
+			  [&](size_t box){return boxLast[box];});
+		}else{
+			for(auto box=(fromBoxes? fromBoxes-1: 0); box<toBoxes; box++){
+				Link(boxLast[box], (box+1)%toBoxes*boxNodes);
+			}
+		}
+	}
+
+	//The bytes the chain needs: beyond numNodes, the multi-chain patterns
+	// shift chain j along by (j+1)^2 nodes, and the random offsets can point
+	// up to a node past the last.
+	static size_t ArenaBytes(NodeLayout const& layout, size_t numNodes,
+	  TraversalPattern traversalPattern){
+		auto numHeads=NumHeads(traversalPattern);
+		auto slackNodes=2+numHeads*(numHeads+1)*(2*numHeads+1)/6;
+		return (numNodes+slackNodes)*layout.nodeBytes;
+	}
+
+	//Builds the chain in arena, which must hold ArenaBytes() (and be 16KiB
+	// aligned, as the TLB tests assume). Only the links are written; the
+	// rest is whatever an earlier chain left there.
+	PerformLatencyStruct(std::byte* arena, NodeLayout const& layout,
+	  size_t numNodes, TraversalPattern traversalPattern=kLinearIncreasing,
+	    size_t boxBytes=sizeofPage16K):
+	  layout(layout), nodes(arena),
+	  traversalPattern(traversalPattern), boxBytes(boxBytes){
+
+	    this->depth=numNodes*layout.nodeBytes;
+		listHeads[0]=Next(0);
+
+		if( IsExtendable(traversalPattern) ){
+			GrowTo(numNodes);
+			return;
+		}
+
 		//The footprint is all in the construction of the node linkages.
 		switch(traversalPattern){
-		case kLinearIncreasing:
-			for(auto i=0; i<numNodes-1; i++){
-				nodes[i].next=&nodes[i+1];
-			};
-			nodes[numNodes-1].next=&nodes[0];
-			break;
 
 		case kLinearIncreasing2:
 		case kLinearIncreasing4:
 		case kLinearIncreasing8:
 		case kLinearIncreasing16:
 		{
-			auto kNumHeads=2<<(traversalPattern-kLinearIncreasing2);
-			auto nodes=this->nodes;
+			auto kNumHeads=NumHeads(traversalPattern);
+			size_t first=0;
 			numNodes/=kNumHeads;
 			for(auto j=0; j<kNumHeads; j++){
 
 				for(auto i=0; i<numNodes-1; i++){
-					nodes[i].next=&nodes[i+1];
+					Link(first+i, first+i+1);
 				};
-				nodes[numNodes-1].next=&nodes[0];
+				Link(first+numNodes-1, first);
 
-			listHeads[j].next=&nodes[0];
+			listHeads[j]=Next(first);
 			//We add (j+1) squared to shift each chain relative to the others
 			// so that the chain-to-chain distance is not a constant stride.
-			nodes+=numNodes+(j+1)*(j+1);
+			first+=numNodes+(j+1)*(j+1);
 			}
 			}break;
 
@@ -335,8 +522,8 @@ template <class node_t>
 // But it works for the version of Clang I care about right now.
 #define REMAP(ix, step)(												\
 	step>0? ((ix)*step) %numNodes: numNodes- ((ix)*-step) %numNodes)
-			auto kNumHeads=2<<(traversalPattern-kLinearIncreasing2M);
-			auto nodes=this->nodes;
+			auto kNumHeads=NumHeads(traversalPattern);
+			size_t first=0;
 			numNodes/=kNumHeads;
 			int step=1;
 			for(auto j=0; j<kNumHeads; j++){
@@ -344,244 +531,22 @@ template <class node_t>
 				for(auto i=0; i<numNodes-1; i++){
 auto ix =REMAP(i  , step);
 auto ix1=REMAP(i+1, step);
-					nodes[ix].next=&nodes[ix1];
+					Link(first+ix, first+ix1);
 				};
-				nodes[REMAP(numNodes-1, step)].next=&nodes[REMAP(0, step)];
+				Link(first+REMAP(numNodes-1, step), first+REMAP(0, step));
 
-			listHeads[j].next=&nodes[REMAP(0, step)];
+			listHeads[j]=Next(first+REMAP(0, step));
 			//We add (j+1) squared to shift each chain relative to the others
 			// so that the chain-to-chain distance is not a constant stride.
-			nodes+=numNodes+(j+1)*(j+1);
+			first+=numNodes+(j+1)*(j+1);
 			step=-(step+4);
 			}
 			}break;
 
-		case kLinearDecreasing:
-			for(auto i=numNodes-1; i>0; i--){
-				nodes[i].next=&nodes[i-1];
-			};
-			nodes[0].next=&nodes[numNodes-1];
-			break;
 		
-		//.....................................................................
-/*
-			These variants below test for various types of prefetchers by
-			collecting nodes in a "box" and running through the nodes in a box
-			before moving to the next box. If, for example, the size of a box
-			is a page, this will amortize a one-time TLB lookup cost over all
-			the nodes in the page. Using the same versus a different random
-			pattern in each box is something that will be detected and used by
-			some prefetchers.
-			
-			For simplicity (makes the code and analysis simpler, and doesn't
-			change anything important) we impose the following on the code:
-			- various pathological cases (like not enopuh nodes to fill the box)
-			are rejected
-			- the number of nodes is rounded down to the number of boxes.
-			These shouldn't affect any results, but they make the code simpler
-			and thus easier to modify.
-
-			Rather than using the shuffled vector directly, we engage in one
-			degree of indirection, first copying the shuffle vector to an
-			array of indices (called indicesT), giving us a vector that,
-			eventually, after all the copying and construction, looks something
-			like, meaning 0 points to 134 points to 67 ... point to 0.
-			[0 134 67 23 ... 0]
-			We then, in an obvious fashion, translate this to the sequence of
-			nodes.
-			This simplifies the code in various small ways, allowing the
-			structure to stand out without being buried in silly details like
-			how we handle the node propagation from one box to the next.
-			
-			We have three indices.
-			indices [] is the array of shuffled values within a box
-			indicesB[] is the array of boxOffsets
-			indicesT[] is the "total" array, combining shuffles box page with
-					   box offset
-
-			The four versions are written (including some occasionally irrelevant
-			commented out lines, to show the commonality across all versions.
-*/
-		case kSameRandomInBox_IncreasingBox:{
-			auto boxNodes=boxBytes/sizeof(node_t);
-			auto numBoxes=numNodes/boxNodes;
-			assert(boxNodes>0);
-			assert(numBoxes>0);
-			numNodes=numBoxes*boxNodes; //drop numNodes%boxNodes excess nodes
-			vector<uint> indicesT(numNodes, 0);
-
-			//Fill the array of boxOffsets linearly
-			vector<uint> indicesB(numBoxes);
-			std::generate( indicesB.begin(), indicesB.end(),
-			  [=,n=-boxNodes]()mutable{
-				return n+=boxNodes;});
-
-			//Create a vector of indices 0..boxNodes-1, then shuffle 1..boxNodes-1
-			std::mt19937 ran32;
-			std::vector<uint> indices(boxNodes);
-			auto indicesBegin=indices.begin(),
-				 indicesBegin1=indicesBegin+1,
-				 indicesEnd=indices.end();
-			std::generate( indicesBegin, indicesEnd,
-			  [n=0]()mutable{
-				  return n++;});
-
-			std::shuffle(indicesBegin1, indicesEnd, ran32);
-
-			//Fill the indicesT vector.
-			auto indicesT0=&indicesT[0];
-			for(auto i=0; i<numBoxes; i++){
-				//std::shuffle(indicesBegin1, indicesEnd, ran32);
-	
-				auto boxOffset=indicesB[i];
-				for(auto j=0; j<boxNodes; j++){
-					*indicesT0++=indices[j]+boxOffset;
-				}
-			}
-			//Wrap the last node back around to the head of the list.
-			indicesT.push_back(0);
-			ConvertIndexVectorToList(indicesT);
-			}break;
-
-		case kDiftRandomInBox_IncreasingBox:{
-			auto boxNodes=boxBytes/sizeof(node_t);
-			auto numBoxes=numNodes/boxNodes;
-			assert(boxNodes>0);
-			assert(numBoxes>0);
-			numNodes=numBoxes*boxNodes; //drop numNodes%boxNodes excess nodes
-			vector<uint> indicesT(numNodes, 0);
-
-			//Fill the array of boxOffsets linearly
-			vector<uint> indicesB(numBoxes);
-			std::generate( indicesB.begin(), indicesB.end(),
-			  [=,n=-boxNodes]()mutable{
-				return n+=boxNodes;});
-
-			//Create a vector of indices 0..boxNodes-1, then shuffle 1..boxNodes-1
-			std::mt19937 ran32;
-			std::vector<uint> indices(boxNodes);
-			auto indicesBegin=indices.begin(),
-				 indicesBegin1=indicesBegin+1,
-				 indicesEnd=indices.end();
-			std::generate( indicesBegin, indicesEnd,
-			  [n=0]()mutable{
-			    return n++;});
-
-			//std::shuffle(indicesBegin1, indicesEnd, ran32);
-
-			//Fill the indicesT vector.
-			auto indicesT0=&indicesT[0];
-			for(auto i=0; i<numBoxes; i++){
-				std::shuffle(indicesBegin1, indicesEnd, ran32);
-
-				auto boxOffset =indicesB[i];
-				for(auto j=0; j<boxNodes; j++){
-					*indicesT0++=indices[j]+boxOffset;
-				}
-			}
-			//Wrap the last node back around to the head of the list.
-			indicesT.push_back(0);
-			ConvertIndexVectorToList(indicesT);
-			}break;
-
-		case kRandomInBox_RandomBox:{
-			auto boxNodes=boxBytes/sizeof(node_t);
-			auto numBoxes=numNodes/boxNodes;
-			assert(boxNodes>0);
-			assert(numBoxes>0);
-			numNodes=numBoxes*boxNodes; //drop numNodes%boxNodes excess nodes
-			vector<uint> indicesT(numNodes, 0);
-			
-			//Fill the array of boxOffsets linearly
-			vector<uint> indicesB(numBoxes);
-			std::generate( indicesB.begin(), indicesB.end(),
-			  [=,n=-boxNodes]()mutable{
-				return n+=boxNodes;});
-
-			//Create a vector of indices 0..boxNodes-1, then shuffle 1..boxNodes-1
-			std::mt19937 ran32;
-			std::vector<uint> indices(boxNodes);
-			auto indicesBegin=indices.begin(),
-				 indicesBegin1=indicesBegin+1,
-				 indicesEnd=indices.end();
-			std::generate( indicesBegin, indicesEnd,
-			  [n=0]()mutable{
-			    return n++;});
-
-			//std::shuffle(indices.begin(), indices.end(), ran32);
-		
-			//Randomize the box offsets 1..numBoxes-1
-			auto indicesBBegin=indicesB.begin(),
-				 indicesBBegin1=indicesBBegin+1,
-				 indicesBEnd=indicesB.end();
-			std::shuffle(indicesBBegin1, indicesBEnd, ran32);
-
-			//Fill the indicesT vector.
-			auto indicesT0=&indicesT[0];
-			for(auto i=0; i<numBoxes; i++){
-				std::shuffle(indicesBegin1, indicesEnd, ran32);
-
-				auto boxOffset=indicesB[i];
-				for(auto j=0; j<boxNodes; j++){
-					*indicesT0++=indices[j]+boxOffset;
-				}
-			}
-			//Wrap the last node back around to the head of the list.
-			indicesT.push_back(0);
-			ConvertIndexVectorToList(indicesT);
-			CLAMP_NUMNODES();
-			}break;
-
-		case kIncreasingInBox_RandomBox:{
-			auto boxNodes=boxBytes/sizeof(node_t);
-			auto numBoxes=numNodes/boxNodes;
-			assert(boxNodes>0);
-			assert(numBoxes>0);
-			numNodes=numBoxes*boxNodes; //drop numNodes%boxNodes excess nodes
-			vector<uint> indicesT(numNodes, 0);
-			
-			//Fill the array of boxOffsets linearly
-			vector<uint> indicesB(numBoxes);
-			std::generate( indicesB.begin(), indicesB.end(),
-			  [=,n=-boxNodes]()mutable{
-				return n+=boxNodes;});
-
-			//Create a vector of indices 0..boxNodes-1
-			std::mt19937 ran32;
-			std::vector<uint> indices(boxNodes);
-			auto indicesBegin=indices.begin(),
-				 //indicesBegin1=indicesBegin+1,
-				 indicesEnd=indices.end();
-			std::generate( indicesBegin, indicesEnd,
-			  [n=0]()mutable{
-			    return n++;});
-
-			//std::shuffle(indices.begin(), indices.end(), ran32);
-		
-			//Randomize the box offsets 1..numBoxes-1
-			auto indicesBBegin=indicesB.begin(),
-				 indicesBBegin1=indicesBBegin+1,
-				 indicesBEnd=indicesB.end();
-			std::shuffle(indicesBBegin1, indicesBEnd, ran32);
-
-			//Fill the indicesT vector.
-			auto indicesT0=&indicesT[0];
-			for(auto i=0; i<numBoxes; i++){
-				//std::shuffle(indicesBegin1, indicesEnd, ran32);
-
-				auto boxOffset=indicesB[i];
-				for(auto j=0; j<boxNodes; j++){
-					*indicesT0++=indices[j]+boxOffset;
-				}
-			}
-			//Wrap the last node back around to the head of the list.
-			indicesT.push_back(0);
-			ConvertIndexVectorToList(indicesT);
-			CLAMP_NUMNODES();
-			}break;
 /*
 		case kRandomInBox_RandomBox_Dual:{
-			auto boxNodes=boxBytes/sizeof(node_t);
+			auto boxNodes=boxBytes/layout.nodeBytes;
 			auto numBoxes=numNodes/boxNodes;
 			assert(boxNodes>0);
 			assert(numBoxes>0);
@@ -595,7 +560,7 @@ auto ix1=REMAP(i+1, step);
 				return n+=boxNodes;});
 
 			//Create a vector of indices 0..boxNodes-1, then shuffle 1..boxNodes-1
-			std::mt19937 ran32;
+			std::mt19937 ran32(g_chainSeed);
 			std::vector<uint> indices(boxNodes);
 			auto indicesBegin=indices.begin(),
 				 indicesBegin1=indicesBegin+1,
@@ -640,8 +605,8 @@ auto ix1=REMAP(i+1, step);
 
 
 		case kRandomInBox_RandomBox_Even:{
-			auto kScale=64/sizeof(node_t);
-			auto boxNodes=boxBytes/sizeof(node_t);
+			auto kScale=64/layout.nodeBytes;
+			auto boxNodes=boxBytes/layout.nodeBytes;
 			auto numBoxes=numNodes/boxNodes;
 			assert(boxNodes>0);
 			assert(numBoxes>0);
@@ -655,7 +620,7 @@ auto ix1=REMAP(i+1, step);
 				return n+=boxNodes;});
 
 			//Create a vector of indices 0..boxNodes-1, then shuffle 1..boxNodes-1
-			std::mt19937 ran32;
+			std::mt19937 ran32(g_chainSeed);
 			std::vector<uint> indices(boxNodes);
 			auto indicesBegin=indices.begin(),
 				 indicesBegin1=indicesBegin+1,
@@ -719,30 +684,30 @@ numNodes/=kScale; //Since we are only touching even nodes.
 		case kRandomTLBOffset:{
 			//Forces a random offset within a page.
 			//To test linear access of TLBs without stressing cache associativity.
-			std::mt19937 ran32;
-			std::uniform_int_distribution<int> distribution(0,sizeof(node_t)/sizeofPtr);
+			std::mt19937 ran32(g_chainSeed);
+			std::uniform_int_distribution<int> distribution(0,layout.nodeBytes/sizeofPtr);
 
 			auto   i=0;
-			void** node=reinterpret_cast<void**>(&nodes[0]);
+			void** node=Next(0);
 			void** next;
 			for(; i<numNodes-1; i++){
 				//Add a random offset to the base location of the next page.
 				auto offset=distribution(ran32);
-				next=reinterpret_cast<void**>( &nodes[i+1]) +offset;
+				next=Next(i+1) +offset;
 				*node=next;
 				node=next;
 			};
-			*node=&nodes[0];
+			*node=Next(0);
 			}break;
 
 		case kRandomTLBOffsetLineAligned:{
 			//Forces a random offset within a page.
 			//To test linear access of TLBs without stressing cache associativity.
-			std::mt19937 ran32;
-			std::uniform_int_distribution<int> distribution(0,sizeof(node_t)/sizeofPtr);
+			std::mt19937 ran32(g_chainSeed);
+			std::uniform_int_distribution<int> distribution(0,layout.nodeBytes/sizeofPtr);
 
 			auto   i=0;
-			void** node=reinterpret_cast<void**>(&nodes[0]);
+			void** node=Next(0);
 			void** next;
 			for(; i<numNodes-1; i++){
 				//Add a random offset to the base location of the next page.
@@ -752,18 +717,18 @@ numNodes/=kScale; //Since we are only touching even nodes.
 					const auto kMask=(-1L)<<3;
 					offset=offset&kMask;
 //Why are we doing this masking?
-				next=reinterpret_cast<void**>( &nodes[i+1]) +offset;
+				next=Next(i+1) +offset;
 				*node=next;
 				node=next;
 			};
-			*node=&nodes[0];
+			*node=Next(0);
 			}break;
 
 		case kRandomTLBOffsetPermuted:{
 			//Forces a random offset within a page.
 			//To test linear access of TLBs without stressing cache associativity.
-			std::mt19937 ran32;
-			uint kNumOffsets=sizeof(node_t)/sizeofPtr;
+			std::mt19937 ran32(g_chainSeed);
+			uint kNumOffsets=layout.nodeBytes/sizeofPtr;
 			std::vector<uint64_t> offsets(kNumOffsets);
 			std::generate( offsets.begin(), offsets.end(),
 			  [n=0]()mutable{
@@ -771,7 +736,7 @@ numNodes/=kScale; //Since we are only touching even nodes.
 			std::shuffle(offsets.begin(), offsets.end(), ran32);
 
 			auto   i=0;
-			void** node=reinterpret_cast<void**>(&nodes[0]);
+			void** node=Next(0);
 			void** next;
 			for(; i<numNodes-1; i++){
 				//Add a random offset to the base location of the next page.
@@ -781,195 +746,247 @@ numNodes/=kScale; //Since we are only touching even nodes.
 					const auto kMask=(-1)<<3;
 					offset=offset&kMask;
 //Why are we doing this masking?
-				next=reinterpret_cast<void**>( &nodes[i+1]) +offset;
+				next=Next(i+1) +offset;
 				*node=next;
 				node=next;
 			};
-			*node=&nodes[0];
+			*node=Next(0);
 			}break;
 		//.....................................................................
 
-		case kFullRandom:{
-			//Create a shuffle of indices 1..numNodes-1;
-			std::mt19937 ran32;
-			std::vector<uint64_t> indices(numNodes-1);
-			std::generate( indices.begin(), indices.end(),
-			  [n=1]()mutable{
-			  	return n++;});
-			std::shuffle(indices.begin(), indices.end(), ran32);
-
-			uint64_t ix=0, nix=0;
-			//loop over nodes
-			for(auto j=0; j<numNodes-1; j++){
-				nix=indices[j];
-				nodes[ix].next=&nodes[nix];
-				ix =nix;
-			}
-			nodes[ix].next=&nodes[0];
-			CLAMP_NUMNODES();
-			}break;
 
 		default:
 			exit(1);
 		};
 	
-	this->numNodes=numNodes;
+	this->numNodes=builtNodes=numNodes;
 	};
 
-	//.........................................................................
+	//Takes the chain from an image already loaded into arena.
+	PerformLatencyStruct(std::byte* arena, NodeLayout const& layout,
+	  TraversalPattern traversalPattern, size_t boxBytes, ChainImage const& image):
+	  layout(layout), nodes(arena),
+	  traversalPattern(traversalPattern), boxBytes(boxBytes), fFromImage(true){
+		depth     =image.depth;
+		numNodes  =image.numNodes;
+		builtNodes=image.builtNodes;
+		for(auto h=0; h<image.heads.size(); h++){
+			listHeads[h]=image.heads[h];
+		}
+	}
 
-	void TestTraversal(size_t numOps){
-		auto head=this->nodes;
-		while(numOps--){head=head->next;}
-		NO_OPTIMIZE(head==NULL);
+	//The chain, for SaveChainImage().
+	ChainImage Image(void) const{
+		ChainImage image{
+		  vector<void*>(listHeads, listHeads+NumHeads(traversalPattern)),
+		  numNodes, builtNodes, depth};
+		return image;
 	}
 
-	void TestTraversal2(size_t numOps){
-		auto head0=&this->listHeads[0];
-		auto head1=&this->listHeads[1];
-		while(numOps--){
-			head0=head0->next;
-			head1=head1->next;
+	//Patterns whose chain at one depth can be grown into the chain at a
+	// greater one by adding links, rather than rebuilt: the linear ones, and
+	// those built with GrowCycle() (see ChainRandom), whose random choices
+	// for the nodes already there do not depend on how many there will be.
+	static bool IsExtendable(TraversalPattern traversalPattern){
+		switch(traversalPattern){
+		case kLinearIncreasing: case kLinearDecreasing:
+		case kSameRandomInBox_IncreasingBox: case kDiftRandomInBox_IncreasingBox:
+		case kRandomInBox_RandomBox: case kIncreasingInBox_RandomBox:
+		case kFullRandom:
+			return true;
+		default:
+			return false;
 		}
-		NO_OPTIMIZE(head0==NULL);
-		NO_OPTIMIZE(head1==NULL);
 	}
-	void TestTraversal4(size_t numOps){
-		auto head0=&this->listHeads[0];
-		auto head1=&this->listHeads[1];
-		auto head2=&this->listHeads[2];
-		auto head3=&this->listHeads[3];
-		while(numOps--){
-			head0=head0->next;
-			head1=head1->next;
-			head2=head2->next;
-			head3=head3->next;
+
+	//Grows the chain, in place, into exactly the one the constructor would
+	// build for numNodes. Returns false, having changed nothing, if the
+	// pattern cannot be grown, or numNodes is fewer than already built.
+	bool Extend(size_t numNodes){
+		if( !IsExtendable(traversalPattern) || fFromImage || numNodes<builtNodes ){
+			return false;
 		}
-		NO_OPTIMIZE(head0==NULL);
-		NO_OPTIMIZE(head1==NULL);
-		NO_OPTIMIZE(head2==NULL);
-		NO_OPTIMIZE(head3==NULL);
+		this->depth=numNodes*layout.nodeBytes;
+		GrowTo(numNodes);
+		return true;
 	}
-	void TestTraversal8(size_t numOps){
-		auto head0=&this->listHeads[0];
-		auto head1=&this->listHeads[1];
-		auto head2=&this->listHeads[2];
-		auto head3=&this->listHeads[3];
-		auto head4=&this->listHeads[4];
-		auto head5=&this->listHeads[5];
-		auto head6=&this->listHeads[6];
-		auto head7=&this->listHeads[7];
-		while(numOps--){
-			head0=head0->next;
-			head1=head1->next;
-			head2=head2->next;
-			head3=head3->next;
-			head4=head4->next;
-			head5=head5->next;
-			head6=head6->next;
-			head7=head7->next;
+
+	//Links nodes builtNodes..numNodes-1 in after those already linked (all
+	// of them, the first time), for the IsExtendable() patterns.
+	void GrowTo(size_t numNodes){
+		auto from=builtNodes;
+		switch(traversalPattern){
+		case kLinearIncreasing:
+			for(auto i=(from? from-1: 0); i<numNodes-1; i++){
+				Link(i, i+1);
+			};
+			Link(numNodes-1, 0);
+			break;
+
+		case kLinearDecreasing:
+			for(auto i=max(from, size_t(1)); i<numNodes; i++){
+				Link(i, i-1);
+			};
+			Link(0, numNodes-1);
+			break;
+		
+		//.....................................................................
+/*
+			These variants below test for various types of prefetchers by
+			collecting nodes in a "box" and running through the nodes in a box
+			before moving to the next box. If, for example, the size of a box
+			is a page, this will amortize a one-time TLB lookup cost over all
+			the nodes in the page. Using the same versus a different random
+			pattern in each box is something that will be detected and used by
+			some prefetchers.
+			
+			For simplicity (makes the code and analysis simpler, and doesn't
+			change anything important) we impose the following on the code:
+			- various pathological cases (like not enopuh nodes to fill the box)
+			are rejected
+			- the number of nodes is rounded down to the number of boxes.
+			These shouldn't affect any results, but they make the code simpler
+			and thus easier to modify.
+
+			The four versions are all BoxChain(), which writes the links in
+			place: within a box either in order, or a random cycle (see
+			ChainRandom) from the box's first node, the same one in every box
+			or a different one; then on to the first node of the next box, in
+			increasing order or in a random cycle of the boxes.
+			(The commented out _Dual and _Even variants in the constructor
+			still use the older scheme, of a shuffled vector of indices,
+			indicesT, converted into links by ConvertIndexVectorToList().)
+*/
+		case kSameRandomInBox_IncreasingBox:
+		case kDiftRandomInBox_IncreasingBox:
+		case kRandomInBox_RandomBox:
+		case kIncreasingInBox_RandomBox:{
+			auto boxNodes=boxBytes/layout.nodeBytes;
+			auto numBoxes=numNodes/boxNodes;
+			assert(boxNodes>0);
+			assert(numBoxes>0);
+			numNodes=numBoxes*boxNodes; //drop numNodes%boxNodes excess nodes
+			auto inBoxOrder=
+			  traversalPattern==kSameRandomInBox_IncreasingBox? kInBoxSameRandom:
+			  traversalPattern==kIncreasingInBox_RandomBox?     kInBoxIncreasing:
+			                                                    kInBoxDiftRandom;
+			auto fRandomBoxes=
+			  traversalPattern==kRandomInBox_RandomBox ||
+			  traversalPattern==kIncreasingInBox_RandomBox;
+			BoxChain(boxNodes, from/boxNodes, numBoxes, inBoxOrder, fRandomBoxes);
+			}break;
+
+		case kFullRandom:
+			//One random cycle through every node. Inherently serial (each
+			// splice depends on the ones before), but with no index vector
+			// it touches only the nodes, and prefetches those.
+			GrowCycle(from, numNodes,
+			  [](size_t node){return node;}, [](size_t node){return node;});
+			break;
+
+		default:
+			exit(1);
 		}
-		NO_OPTIMIZE(head0==NULL);
-		NO_OPTIMIZE(head1==NULL);
-		NO_OPTIMIZE(head2==NULL);
-		NO_OPTIMIZE(head3==NULL);
-		NO_OPTIMIZE(head4==NULL);
-		NO_OPTIMIZE(head5==NULL);
-		NO_OPTIMIZE(head6==NULL);
-		NO_OPTIMIZE(head7==NULL);
-	}
-	void TestTraversal16(size_t numOps){
-		auto head0=&this->listHeads[0];
-		auto head1=&this->listHeads[1];
-		auto head2=&this->listHeads[2];
-		auto head3=&this->listHeads[3];
-		auto head4=&this->listHeads[4];
-		auto head5=&this->listHeads[5];
-		auto head6=&this->listHeads[6];
-		auto head7=&this->listHeads[7];
-
-		auto head8=&this->listHeads[8];
-		auto head9=&this->listHeads[9];
-		auto head10=&this->listHeads[10];
-		auto head11=&this->listHeads[11];
-		auto head12=&this->listHeads[12];
-		auto head13=&this->listHeads[13];
-		auto head14=&this->listHeads[14];
-		auto head15=&this->listHeads[15];
-		while(numOps--){
-			head0=head0->next;
-			head1=head1->next;
-			head2=head2->next;
-			head3=head3->next;
-			head4=head4->next;
-			head5=head5->next;
-			head6=head6->next;
-			head7=head7->next;
-
-			head8=head8->next;
-			head9=head9->next;
-			head10=head10->next;
-			head11=head11->next;
-			head12=head12->next;
-			head13=head13->next;
-			head14=head14->next;
-			head15=head15->next;
+		builtNodes=numNodes;
+
+		//The random patterns are spread so thinly that a million loads
+		// sample them as well as a full pass would.
+		if(traversalPattern==kRandomInBox_RandomBox
+		 || traversalPattern==kIncreasingInBox_RandomBox
+		 || traversalPattern==kFullRandom){
+			CLAMP_NUMNODES();
 		}
-		NO_OPTIMIZE(head0==NULL);
-		NO_OPTIMIZE(head1==NULL);
-		NO_OPTIMIZE(head2==NULL);
-		NO_OPTIMIZE(head3==NULL);
-		NO_OPTIMIZE(head4==NULL);
-		NO_OPTIMIZE(head5==NULL);
-		NO_OPTIMIZE(head6==NULL);
-		NO_OPTIMIZE(head7==NULL);
-
-		NO_OPTIMIZE(head8==NULL);
-		NO_OPTIMIZE(head9==NULL);
-		NO_OPTIMIZE(head10==NULL);
-		NO_OPTIMIZE(head11==NULL);
-		NO_OPTIMIZE(head12==NULL);
-		NO_OPTIMIZE(head13==NULL);
-		NO_OPTIMIZE(head14==NULL);
-		NO_OPTIMIZE(head15==NULL);
+		this->numNodes=numNodes;
+	}
+};
+//.............................................................................
+
+/*
+	The hot loops. Every one follows links with a single dependent load
+	(p=*p), whatever the layout; what is fixed at compile time is the shape
+	of the loop: how many chains are followed at once, what extra work sits
+	in the dependency chain, and (for the common layouts) where the payload
+	is relative to the pointer. SelectTraversal() picks one at run time,
+	before anything is timed.
+*/
+enum LatencyTraversal{
+	kChase,							//one chain
+	kChase2, kChase4, kChase8, kChase16,	//that many chains at once
+	kChaseAdd, kChaseDiv,			//one chain, with an add (a divide) per link
+	kReduce							//one chain, summing each node's payload
+};
+
+typedef void (*TraversalFn)(PerformLatencyStruct const& pls, size_t numOps);
+
+template <int kNumHeads>
+  static void Chase(PerformLatencyStruct const& pls, size_t numOps){
+	void* heads[kNumHeads];
+	for(auto j=0; j<kNumHeads; j++){heads[j]=pls.listHeads[j];}
+	while(numOps--){
+		[&]<size_t... J>(std::index_sequence<J...>){
+			( (heads[J]=*reinterpret_cast<void**>(heads[J])), ... );
+		}(std::make_index_sequence<kNumHeads>{});
 	}
+	for(auto j=0; j<kNumHeads; j++){NO_OPTIMIZE(heads[j]==NULL);}
+}
 
-	void TestTraversal_Add(size_t numOps){
-		auto head=this->nodes;
-		while(numOps--){
-			head=head->next;
-			auto headX=(uint64_t)head;
-			headX+=kZero;
-			head=(node_t*)headX;
-		}
-		NO_OPTIMIZE(head==NULL);
+static void ChaseAdd(PerformLatencyStruct const& pls, size_t numOps){
+	auto head=pls.listHeads[0];
+	while(numOps--){
+		head=*reinterpret_cast<void**>(head);
+		auto headX=(uint64_t)head;
+		headX+=kZero;
+		head=(void*)headX;
 	}
-	void TestTraversal_Div(size_t numOps){
-		auto head=this->nodes;
-		while(numOps--){
-			head=head->next;
-			auto headX=(uint64_t)head;
-			headX/=kOne;
-			head=(node_t*)headX;
-		}
-		NO_OPTIMIZE(head==NULL);
+	NO_OPTIMIZE(head==NULL);
+}
+static void ChaseDiv(PerformLatencyStruct const& pls, size_t numOps){
+	auto head=pls.listHeads[0];
+	while(numOps--){
+		head=*reinterpret_cast<void**>(head);
+		auto headX=(uint64_t)head;
+		headX/=kOne;
+		head=(void*)headX;
 	}
-	
-	void TestReduction0(size_t numOps){
-		auto head=this->nodes;
-		uint64_t dummy=0;
-		while(numOps--){dummy+=head->payload0[0]; head=head->next;}
-		NO_OPTIMIZE(head==NULL);
-		NO_OPTIMIZE(dummy==1);
+	NO_OPTIMIZE(head==NULL);
+}
+
+//The payload is kPayloadDelta bytes from the pointer; 0 (which would be the
+// pointer itself) means read it from the layout instead.
+template <ptrdiff_t kPayloadDelta>
+  static void Reduce(PerformLatencyStruct const& pls, size_t numOps){
+	auto delta=kPayloadDelta? kPayloadDelta:
+	  ptrdiff_t(pls.layout.payloadOffset)-ptrdiff_t(pls.layout.nextOffset);
+	auto head=pls.listHeads[0];
+	uint64_t dummy=0;
+	while(numOps--){
+		dummy+=*reinterpret_cast<uint64_t*>( static_cast<std::byte*>(head)+delta );
+		head=*reinterpret_cast<void**>(head);
 	}
-	void TestReduction1(size_t numOps){
-		auto head=this->nodes;
-		uint64_t dummy=0;
-		while(numOps--){dummy+=head->payload1[0]; head=head->next;}
-		NO_OPTIMIZE(head==NULL);
-		NO_OPTIMIZE(dummy==1);
+	NO_OPTIMIZE(head==NULL);
+	NO_OPTIMIZE(dummy==1);
+}
+
+static TraversalFn SelectTraversal(LatencyTraversal traversal,
+  NodeLayout const& layout){
+	switch(traversal){
+	case kChase:    return Chase<1>;
+	case kChase2:   return Chase<2>;
+	case kChase4:   return Chase<4>;
+	case kChase8:   return Chase<8>;
+	case kChase16:  return Chase<16>;
+	case kChaseAdd: return ChaseAdd;
+	case kChaseDiv: return ChaseDiv;
+	case kReduce:
+		switch( ptrdiff_t(layout.payloadOffset)-ptrdiff_t(layout.nextOffset) ){
+		case  8: return Reduce<8>;
+		case -8: return Reduce<-8>;
+		default: return Reduce<0>;
+		}
+	default:
+		exit(1);
 	}
-};
+}
 //=============================================================================
 
 /*
@@ -1007,454 +1024,266 @@ Oh well, maybe in C++30.
 A second fun consequence is, given how wild I went with templates (corresponding
 to many many different node size variants!) this file takes a distressingly long
 time to compile...
+
+(So now only the shapes of the traversal loops are templates, a handful of
+them, and the node size, the pointer's place in the node and the payload's
+are a NodeLayout, chosen at run time. Each test table below is data: the
+layout, and the tests to run with it.)
 */
 
-#define PLS PerformLatencyStruct< Node<nodeSizeInB> >
-template <uint nodeSizeInB>
-  using testMemberFn=void (PLS::*) (size_t arrayLength);
-  
-template <uint nodeSizeInB>
-  struct TestData{
-	testMemberFn<nodeSizeInB> fn;
+struct TestData{
+	LatencyTraversal traversal;
 	string			 name;
 	TraversalPattern traversalPattern;
+	//upperNumNodes 0 means as many as fit in kMaxDepthBytes.
 	int			 	 lowerNumNodes, upperNumNodes, boxSizeInB;
 	
-	TestData(testMemberFn<nodeSizeInB> fn, string name,
+	TestData(LatencyTraversal traversal, string name,
 	  TraversalPattern traversalPattern,
-	  int lowerNumNodes=16, uint upperNumNodes=kMaxDepthBytes/nodeSizeInB,
+	  int lowerNumNodes=16, uint upperNumNodes=0,
 //	  uint boxSizeInB=sizeofPage16K):
 	  uint boxSizeInB=15000):
-	    fn(fn),name(name),traversalPattern(traversalPattern),
+	    traversal(traversal),name(name),traversalPattern(traversalPattern),
 	    lowerNumNodes(lowerNumNodes),upperNumNodes(upperNumNodes),
 	    boxSizeInB(boxSizeInB){;};
 };
 
+struct LatencyTests{
+	NodeLayout       layout;
+	vector<TestData> tests;
+	//What backs the arena the chains are built in (see chainArena.h);
+	// default defers to --latency-pages.
+	PageBacking      pages=kDefaultPages;
+};
+
+//The same tests, with the chains in pages.
+static LatencyTests WithPages(LatencyTests lt, PageBacking pages){
+	lt.pages=pages;
+	return lt;
+}
+
 #pragma mark - TEST PARAMETERS
 //-----------------------------------------------------------------------------
 //Small nodes -- baseline and cache tests: kLatency8B_Probe
 #define sz sizeofPtr
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sizeofPtr> > tests1={
+static const LatencyTests tests1={{sz}, {
 /* A quick and dirty version of these tests below was used to probe how well the
 stride prefetcher handled multiple streams, sometimes with varying stride.
 Could probably be cleaned up in multiple ways to reveal more information.
 
-  {&PLSX::TestTraversal2, "Linear IncreasingM 2x", kLinearIncreasing2M,
+  {kChase2, "Linear IncreasingM 2x", kLinearIncreasing2M,
     64},
-  {&PLSX::TestTraversal4, "Linear IncreasingM 4x", kLinearIncreasing4M,
+  {kChase4, "Linear IncreasingM 4x", kLinearIncreasing4M,
     64},
-  {&PLSX::TestTraversal8, "Linear IncreasingM 8x", kLinearIncreasing8M,
+  {kChase8, "Linear IncreasingM 8x", kLinearIncreasing8M,
     64},
-  {&PLSX::TestTraversal16, "Linear IncreasingM 16x", kLinearIncreasing16M,
+  {kChase16, "Linear IncreasingM 16x", kLinearIncreasing16M,
     64},
 
-  {&PLSX::TestTraversal2, "Linear Increasing 2x", kLinearIncreasing2,
+  {kChase2, "Linear Increasing 2x", kLinearIncreasing2,
     64},
-  {&PLSX::TestTraversal4, "Linear Increasing 4x", kLinearIncreasing4,
+  {kChase4, "Linear Increasing 4x", kLinearIncreasing4,
     64},
-  {&PLSX::TestTraversal8, "Linear Increasing 8x", kLinearIncreasing8,
+  {kChase8, "Linear Increasing 8x", kLinearIncreasing8,
     64},
-  {&PLSX::TestTraversal16, "Linear Increasing 16x", kLinearIncreasing16,
+  {kChase16, "Linear Increasing 16x", kLinearIncreasing16,
     64},
 */
-  {&PLSX::TestTraversal, "Linear Increasing", kLinearIncreasing,
+  {kChase, "Linear Increasing", kLinearIncreasing,
     64},
-  {&PLSX::TestTraversal, "Linear Decreasing", kLinearDecreasing,
+  {kChase, "Linear Decreasing", kLinearDecreasing,
     64},
 
 
 
-  {&PLSX::TestTraversal, "SameRandomInBox IncreasingBox", kSameRandomInBox_IncreasingBox,
+  {kChase, "SameRandomInBox IncreasingBox", kSameRandomInBox_IncreasingBox,
     sizeofPage16K/sz},
-  {&PLSX::TestTraversal, "DiftRandomInBox IncreasingBox", kDiftRandomInBox_IncreasingBox,
+  {kChase, "DiftRandomInBox IncreasingBox", kDiftRandomInBox_IncreasingBox,
     sizeofPage16K/sz},
-  {&PLSX::TestTraversal, "DiftRandomInBox RandomBox", kRandomInBox_RandomBox,
+  {kChase, "DiftRandomInBox RandomBox", kRandomInBox_RandomBox,
     sizeofPage16K/sizeofPtr},
 
-  {&PLSX::TestTraversal, "FullRandom", kFullRandom,
+  {kChase, "FullRandom", kFullRandom,
     16}, //kMaxDepthBytes/sz},
 
-  {&PLSX::TestTraversal_Add, "Linear Increasing +Add", kLinearIncreasing,
+  {kChaseAdd, "Linear Increasing +Add", kLinearIncreasing,
      16, kL1DepthTestBytes/sz},
-  {&PLSX::TestTraversal_Div, "Linear Increasing +Div", kLinearIncreasing,
+  {kChaseDiv, "Linear Increasing +Div", kLinearIncreasing,
      16, kL1DepthTestBytes/sz},
-  {&PLSX::TestTraversal_Div, "SameRandomInBox IncreasingBox +Div", kSameRandomInBox_IncreasingBox,
+  {kChaseDiv, "SameRandomInBox IncreasingBox +Div", kSameRandomInBox_IncreasingBox,
      sizeofPage16K/sz, kL1DepthTestBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPtr4
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests4={
-	{&PLSX::TestReduction1, "Test Reduction - Ptr first", kLinearIncreasing,
+static const LatencyTests tests4={{sz, 0, 8}, {
+	{kReduce, "Test Reduction - Ptr first", kLinearIncreasing,
 	    16, kL1DepthTestBytes/sz},
-	{&PLSX::TestReduction0, "Test Reduction - Payload first", kLinearIncreasing,
+}};
+static const LatencyTests tests4P={{sz, 8, 0}, {
+	{kReduce, "Test Reduction - Payload first", kLinearIncreasing,
 	    16, kL1DepthTestBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 //.............................................................................
 //Test linear prefetchers: kLatencyStride_Probe
 
-#define sz 63
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests63P={
-  {&PLSX::TestTraversal, "63B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "63B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests64P={
-  {&PLSX::TestTraversal, "64B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "64B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 65
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests65P={
-  {&PLSX::TestTraversal, "65B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "65B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 120
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests120P={
-  {&PLSX::TestTraversal, "120B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "120B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 121
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests121P={
-  {&PLSX::TestTraversal, "121B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "121B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 127
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests127P={
-  {&PLSX::TestTraversal, "127B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "127B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 128
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests128P={
-  {&PLSX::TestTraversal, "128B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "128B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 136
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests136P={
-  {&PLSX::TestTraversal, "136B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "136B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 256
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests256P={
-  {&PLSX::TestTraversal, "256B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "256B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 257
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests257P={
-  {&PLSX::TestTraversal, "257B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "257B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 272
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests272P={
-  {&PLSX::TestTraversal, "272B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "272B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 288
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests288P={
-  {&PLSX::TestTraversal, "288B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "288B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 320
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests320P={
-  {&PLSX::TestTraversal, "320B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "320B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 384
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests384P={
-  {&PLSX::TestTraversal, "384B Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "384B Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 1984
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests1984P={
-  {&PLSX::TestTraversal, "2kB Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "2kB Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
-
-#define sz 8128
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests8128P={
-  {&PLSX::TestTraversal, "8kB Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "8kB Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
+//The strides to sweep, set by main() from --stride/--strides/--pointer-offset.
+//The defaults are the strides the old (padded to pointer alignment) node
+// types actually ran: 63B and 64B both ran 64B, 65B ran 72B, and so on.
+static vector<size_t> g_latencyStrides={
+	64, 72, 120, 128, 136, 256, 264, 272, 288, 320, 384,
+	31*64, 8*1024-64, 16*1024-3*64, 32*1024-3*64, 64*1024-3*64};
+static size_t g_latencyPointerOffset=0;
+
+void SetLatencyStrides(vector<size_t> const& strides, size_t pointerOffset){
+	g_latencyStrides=strides;
+	g_latencyPointerOffset=pointerOffset;
+}
 
-#define sz 16192
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests16192P={
-  {&PLSX::TestTraversal, "16kB Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "16kB Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
+//Set by --latency-pages; what backs the tests that do not choose.
+static PageBacking g_latencyPages=kDefaultPages;
 
-#define sz 32576
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests32576P={
-  {&PLSX::TestTraversal, "32kB Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "32kB Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
+bool SetLatencyPages(string const& name){
+	return PageBackingFromName(name, g_latencyPages);
+}
 
-#define sz 65152
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests65152P={
-  {&PLSX::TestTraversal, "64kB Increasing",
-    kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "64kB Decreasing",
-    kLinearDecreasing, 16, kMaxDepthBytes/sz},
-};
-#undef sz
-#undef PLSX
+static LatencyTests StrideTests(size_t stride){
+	LatencyTests lt{{stride, g_latencyPointerOffset}, {}};
+	uint upper=(uint)(kMaxDepthBytes/stride);
+	lt.tests.push_back({kChase, to_string(stride)+"B Increasing",
+	  kLinearIncreasing, 16, upper});
+	lt.tests.push_back({kChase, to_string(stride)+"B Decreasing",
+	  kLinearDecreasing, 16, upper});
+	return lt;
+}
 
 //L1 Structure Tests
 //.............................................................................
 //L1 Capacity
 #define sz 8_B
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests8Ca={
-    {&PLSX::TestTraversal, "L1 Data Capacity",
+static const LatencyTests tests8Ca={{sz}, {
+    {kChase, "L1 Data Capacity",
       kFullRandom, -8*1024, 24*1024}
-};
+}};
 #undef sz
-#undef PLSX
 
 //L1 Address Capacity
 #define sz (3*32_B)
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests32Li={
-    {&PLSX::TestTraversal, "L1 Address Capacity",
+static const LatencyTests tests32Li={{sz}, {
+    {kChase, "L1 Address Capacity",
       kFullRandom, -1024, 3*1024}
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz (3*64_B)
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests64Li={
-    {&PLSX::TestTraversal, "L1 Address Capacity",
+static const LatencyTests tests64Li={{sz}, {
+    {kChase, "L1 Address Capacity",
       kFullRandom, -1024, 3*1024}
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz (3*128_B)
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests128Li={
-    {&PLSX::TestTraversal, "L1 Address Capacity",
+static const LatencyTests tests128Li={{sz}, {
+    {kChase, "L1 Address Capacity",
       kFullRandom, -512, 3*512}
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz (3*256_B)
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests256Li={
-    {&PLSX::TestTraversal, "L1 Address Capacity",
+static const LatencyTests tests256Li={{sz}, {
+    {kChase, "L1 Address Capacity",
       kFullRandom, -256, 3*256}
-};
+}};
 #undef sz
-#undef PLSX
 
 //.............................................................................
 //L1 Associativity
 /*
 #define sz 128_kiB
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests128KA={
-	{&PLSX::TestTraversal, "Test Associativity Length",
+static const LatencyTests tests128KA={{sz}, {
+	{kChase, "Test Associativity Length",
 	  kFullRandom, -4, 12}
-};
+}};
 #undef sz
-#undef PLSX
 	
 #define sz 64_kiB
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests64KA={
-	{&PLSX::TestTraversal, "Test Associativity Length",
+static const LatencyTests tests64KA={{sz}, {
+	{kChase, "Test Associativity Length",
 	  kFullRandom, -4, 12}
-};
+}};
 #undef sz
-#undef PLSX
 */
 #define sz 32_kiB
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests32KA={
-	{&PLSX::TestTraversal, "L1 Associativity",
+static const LatencyTests tests32KA={{sz}, {
+	{kChase, "L1 Associativity",
 	  kFullRandom, -4, 12}
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 16_kiB
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests16KA={
-	{&PLSX::TestTraversal, "L1 Associativity",
+static const LatencyTests tests16KA={{sz}, {
+	{kChase, "L1 Associativity",
 	  kFullRandom, -4, 12}
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 8_kiB
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests8KA={
-	{&PLSX::TestTraversal, "L1 Associativity",
+static const LatencyTests tests8KA={{sz}, {
+	{kChase, "L1 Associativity",
 	  kFullRandom, 4, 20}
-};
+}};
 #undef sz
-#undef PLSX
 
 /*
 #define sz 512
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests512C={
-	{&PLSX::TestTraversal, "Test CacheLine Length - box128K",
+static const LatencyTests tests512C={{sz}, {
+	{kChase, "Test CacheLine Length - box128K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "Test CacheLine Length - box64K",
+	{kChase, "Test CacheLine Length - box64K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "Test CacheLine Length - box32K",
+	{kChase, "Test CacheLine Length - box32K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "Test CacheLine Length - box16K",
+	{kChase, "Test CacheLine Length - box16K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-};
+}};
 #undef sz
-#undef PLSX
 */
 
 //.............................................................................
 //L1 Sectoring
 
 #define sectoringTests(traversalPattern, name)								\
-	{&PLSX::TestTraversal, name " box512K",									\
+	{kChase, name " box512K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},\
-	{&PLSX::TestTraversal, name " box256K",									\
+	{kChase, name " box256K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_kiB},\
-	{&PLSX::TestTraversal, name " box128K",									\
+	{kChase, name " box128K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},\
-	{&PLSX::TestTraversal, name " box64K",									\
+	{kChase, name " box64K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},\
-	{&PLSX::TestTraversal, name " box32K",									\
+	{kChase, name " box32K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},\
-	{&PLSX::TestTraversal, name " box16K",									\
+	{kChase, name " box16K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},\
-	{&PLSX::TestTraversal, name " box8K",									\
+	{kChase, name " box8K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 8_kiB},	\
-	{&PLSX::TestTraversal, name " box4K",									\
+	{kChase, name " box4K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 4_kiB}, \
-	{&PLSX::TestTraversal, name " box2K",									\
+	{kChase, name " box2K",									\
 	  traversalPattern, kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},	\
-	{&PLSX::TestTraversal, name " box1K",									\
+	{kChase, name " box1K",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB}, \
-	{&PLSX::TestTraversal, name " box512B",									\
+	{kChase, name " box512B",									\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 
 #define sectoringTestsX(traversalPattern, name, ssz)						\
-	{&PLSX::TestTraversal, name " box"#ssz"B",								\
+	{kChase, name " box"#ssz"B",								\
 	  traversalPattern,	kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, ssz},
 
 #define sectoringTests256(traversalPattern, name)							\
@@ -1491,768 +1320,719 @@ static const vector< TestData<sz> > tests512C={
 
 
 #define sz 8
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests8C={
+static const LatencyTests tests8C={{sz}, {
 	sectoringTests8$(kFullRandom, "full random")
 	sectoringTests8$(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests8$(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests8$(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests8$(kIncreasingInBox_RandomBox, "increasing, random box")
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 16
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests16C={
+static const LatencyTests tests16C={{sz}, {
 	sectoringTests16$(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests16$(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests16$(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests16$(kIncreasingInBox_RandomBox, "increasing, random box")
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 32
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests32C={
+static const LatencyTests tests32C={{sz}, {
 	sectoringTests32$(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests32$(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests32$(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests32$(kIncreasingInBox_RandomBox, "increasing, random box")
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests64C={
+static const LatencyTests tests64C={{sz}, {
 	sectoringTests64$(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests64$(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests64$(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests64$(kIncreasingInBox_RandomBox, "increasing, random box")
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 128
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests128C={
+static const LatencyTests tests128C={{sz}, {
 	sectoringTests128$(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests128$(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests128$(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests128$(kIncreasingInBox_RandomBox, "increasing, random box")
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 256
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests256C={
+static const LatencyTests tests256C={{sz}, {
 	sectoringTests256$(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests256$(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests256$(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests256$(kIncreasingInBox_RandomBox, "increasing, random box")
-};
+}};
 #undef sz
-#undef PLSX
 
 //.............................................................................
 //TLB tests: kLatencyTLB_Probe
 
 #define sz sizeofPage16K
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests16K={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 16K",
+static const LatencyTests tests16K={{sz}, {
+	{kChase, "TLB Linear Increasing 16K",
 	  kLinearIncreasing, 8, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 16K",
+	{kChase, "TLB Linear Decreasing 16K",
 	  kLinearDecreasing, 12, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 16K",
+	{kChase, "TLB Full Random 16K",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage16K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests16K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 16K64",
+static const LatencyTests tests16K64={{sz}, {
+	{kChase, "TLB Linear Increasing 16K64",
 	  kLinearIncreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 16K64",
+	{kChase, "TLB Linear Decreasing 16K64",
 	  kLinearDecreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 16K64",
+	{kChase, "TLB Full Random 16K64",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear w/ random offset 16K64",
+	{kChase, "TLB Linear w/ random offset 16K64",
 	  kRandomTLBOffset, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear w/ random offset[line aligned] 16K64",
+	{kChase, "TLB Linear w/ random offset[line aligned] 16K64",
 	  kRandomTLBOffsetLineAligned, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear w/ random offset[permuted] 16K64",
+	{kChase, "TLB Linear w/ random offset[permuted] 16K64",
 	  kRandomTLBOffsetPermuted, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage8K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests8K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 8K64",
+static const LatencyTests tests8K64={{sz}, {
+	{kChase, "TLB Linear Increasing 8K64",
 	  kLinearIncreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 8K64",
+	{kChase, "TLB Linear Decreasing 8K64",
 	  kLinearDecreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 8K64",
+	{kChase, "TLB Full Random 8K64",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage32K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests32K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 32K64",
+static const LatencyTests tests32K64={{sz}, {
+	{kChase, "TLB Linear Increasing 32K64",
 	  kLinearIncreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 32K64",
+	{kChase, "TLB Linear Decreasing 32K64",
 	  kLinearDecreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 32K64",
+	{kChase, "TLB Full Random 32K64",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage64K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests64K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 64K64",
+static const LatencyTests tests64K64={{sz}, {
+	{kChase, "TLB Linear Increasing 64K64",
 	  kLinearIncreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 64K64",
+	{kChase, "TLB Linear Decreasing 64K64",
 	  kLinearDecreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 64K64",
+	{kChase, "TLB Full Random 64K64",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage128K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests128K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 128K64",
+static const LatencyTests tests128K64={{sz}, {
+	{kChase, "TLB Linear Increasing 128K64",
 	  kLinearIncreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 128K64",
+	{kChase, "TLB Linear Decreasing 128K64",
 	  kLinearDecreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 128K64",
+	{kChase, "TLB Full Random 128K64",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage256K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests256K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 256K64",
+static const LatencyTests tests256K64={{sz}, {
+	{kChase, "TLB Linear Increasing 256K64",
 	  kLinearIncreasing, 8, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 256K64",
+	{kChase, "TLB Linear Decreasing 256K64",
 	  kLinearDecreasing, 8, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 256K64",
+	{kChase, "TLB Full Random 256K64",
 	  kFullRandom, 8, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage512K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests512K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing 512K64",
+static const LatencyTests tests512K64={{sz}, {
+	{kChase, "TLB Linear Increasing 512K64",
 	  kLinearIncreasing, 2, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing 512K64",
+	{kChase, "TLB Linear Decreasing 512K64",
 	  kLinearDecreasing, 2, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random 512K64",
+	{kChase, "TLB Full Random 512K64",
 	  kFullRandom, 2, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 /* Sizes that we not dropped as irrelevant once I figured out the
 overall structure of the system.
 #define sz sizeofPage4K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests4K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing",
+static const LatencyTests tests4K64={{sz}, {
+	{kChase, "TLB Linear Increasing",
 	  kLinearIncreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing",
+	{kChase, "TLB Linear Decreasing",
 	  kLinearDecreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random",
+	{kChase, "TLB Full Random",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofPage12K64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests12K64={
-	{&PLSX::TestTraversal, "TLB Linear Increasing",
+static const LatencyTests tests12K64={{sz}, {
+	{kChase, "TLB Linear Increasing",
 	  kLinearIncreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Linear Decreasing",
+	{kChase, "TLB Linear Decreasing",
 	  kLinearDecreasing, 16, kMaxDepthBytes/sz},
-	{&PLSX::TestTraversal, "TLB Full Random",
+	{kChase, "TLB Full Random",
 	  kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 */
 
 //.............................................................................
 
 #if 00
 #define sz 96
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests96C={
-	{&PLSX::TestTraversal, "random box512K",
+static const LatencyTests tests96C={{sz}, {
+	{kChase, "random box512K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},
-	{&PLSX::TestTraversal, "random box128K",
+	{kChase, "random box128K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "random box64K",
+	{kChase, "random box64K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "random box32K",
+	{kChase, "random box32K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "random box16K",
+	{kChase, "random box16K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "random box15K",
+	{kChase, "random box15K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 15_kiB},
-	{&PLSX::TestTraversal, "random box9K",
+	{kChase, "random box9K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 9_kiB},
-	{&PLSX::TestTraversal, "random box8K",
+	{kChase, "random box8K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 8_kiB},
-	{&PLSX::TestTraversal, "random box2K",
+	{kChase, "random box2K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "random box1K",
+	{kChase, "random box1K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "random box.5K",
+	{kChase, "random box.5K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 
 /*
-	{&PLSX::TestTraversal, "dual box128K",
+	{kChase, "dual box128K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "dual box64K",
+	{kChase, "dual box64K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "dual box32K",
+	{kChase, "dual box32K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "dual box16K",
+	{kChase, "dual box16K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "dual box8K",
+	{kChase, "dual box8K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 8_kiB},
-	{&PLSX::TestTraversal, "dual box2K",
+	{kChase, "dual box2K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "dual box1K",
+	{kChase, "dual box1K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "dual box.5K",
+	{kChase, "dual box.5K",
 	  kRandomInBox_RandomBox_Dual,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 */
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz (3*96)
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests288C={
-	{&PLSX::TestTraversal, "random box 3*128K",
+static const LatencyTests tests288C={{sz}, {
+	{kChase, "random box 3*128K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*128_kiB},
-	{&PLSX::TestTraversal, "random box 3*64K",
+	{kChase, "random box 3*64K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*64_kiB},
-	{&PLSX::TestTraversal, "random box 3*32K",
+	{kChase, "random box 3*32K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*32_kiB},
-	{&PLSX::TestTraversal, "random box 3*16K",
+	{kChase, "random box 3*16K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*16_kiB},
-//	{&PLSX::TestTraversal, "random box 3*15K",
+//	{kChase, "random box 3*15K",
 //	  kRandomInBox_RandomBox,
 //	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*15_kiB},
-//	{&PLSX::TestTraversal, "random box 3*9K",
+//	{kChase, "random box 3*9K",
 //	  kRandomInBox_RandomBox,
 //	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*9_kiB},
-	{&PLSX::TestTraversal, "random box 3*8K",
+	{kChase, "random box 3*8K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*8_kiB},
-	{&PLSX::TestTraversal, "random box 3*2K",
+	{kChase, "random box 3*2K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*2_kiB},
-	{&PLSX::TestTraversal, "random box 3*1K",
+	{kChase, "random box 3*1K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*1_kiB},
-	{&PLSX::TestTraversal, "random box 3*.5K",
+	{kChase, "random box 3*.5K",
 	  kRandomInBox_RandomBox,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*512_B},
 
 /*
-	{&PLSX::TestTraversal, "dual box 3*128K",
+	{kChase, "dual box 3*128K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "dual box 3*64K",
+	{kChase, "dual box 3*64K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*64_kiB},
-	{&PLSX::TestTraversal, "dual box 3*32K",
+	{kChase, "dual box 3*32K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*32_kiB},
-	{&PLSX::TestTraversal, "dual box 3*16K",
+	{kChase, "dual box 3*16K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*16_kiB},
-	{&PLSX::TestTraversal, "dual box 3*8K",
+	{kChase, "dual box 3*8K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*8_kiB},
-	{&PLSX::TestTraversal, "dual box 3*2K",
+	{kChase, "dual box 3*2K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*2_kiB},
-	{&PLSX::TestTraversal, "dual box 3*1K",
+	{kChase, "dual box 3*1K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*1_kiB},
-	{&PLSX::TestTraversal, "dual box 3*.5K",
+	{kChase, "dual box 3*.5K",
 	  kRandomInBox_RandomBox_Dual,
 	    -3*kL1DepthTestBytes/sz, 3*kL1DepthTestBytes/sz, 3*512_B},
 */
-};
+}};
 #undef sz
-#undef PLSX
 #endif //00
 
 #if 0
 #define sz 32
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests32C={
-	{&PLSX::TestTraversal, "random box512K",
+static const LatencyTests tests32C={{sz}, {
+	{kChase, "random box512K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},
-	{&PLSX::TestTraversal, "random box256K",
+	{kChase, "random box256K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_kiB},
-	{&PLSX::TestTraversal, "random box128K",
+	{kChase, "random box128K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "random box32K",
+	{kChase, "random box32K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "random box16K",
+	{kChase, "random box16K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "random box8K",
+	{kChase, "random box8K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 8_kiB},
-	{&PLSX::TestTraversal, "random box4K",
+	{kChase, "random box4K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 4_kiB},
-	{&PLSX::TestTraversal, "random box2K",
+	{kChase, "random box2K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "random box512B",
+	{kChase, "random box512B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
-	{&PLSX::TestTraversal, "random box256B",
+	{kChase, "random box256B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_B},
-	{&PLSX::TestTraversal, "random box128B",
+	{kChase, "random box128B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_B},
-	{&PLSX::TestTraversal, "random box64B",
+	{kChase, "random box64B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_B},
-	{&PLSX::TestTraversal, "random box32B",
+	{kChase, "random box32B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_B},
 #if 0
-	{&PLSX::TestTraversal, "dual box512K",
+	{kChase, "dual box512K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},
-	{&PLSX::TestTraversal, "dual box256K",
+	{kChase, "dual box256K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_kiB},
-	{&PLSX::TestTraversal, "dual box128K",
+	{kChase, "dual box128K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "dual box64K",
+	{kChase, "dual box64K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "dual box32K",
+	{kChase, "dual box32K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "dual box16K",
+	{kChase, "dual box16K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "dual box8K",
+	{kChase, "dual box8K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 8_kiB},
-	{&PLSX::TestTraversal, "dual box2K",
+	{kChase, "dual box2K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "dual box1K",
+	{kChase, "dual box1K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "dual box.5K",
+	{kChase, "dual box.5K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 
-	{&PLSX::TestTraversal, "even box512K",
+	{kChase, "even box512K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},
-	{&PLSX::TestTraversal, "even box256K",
+	{kChase, "even box256K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_kiB},
-	{&PLSX::TestTraversal, "even box128K",
+	{kChase, "even box128K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "even box64K",
+	{kChase, "even box64K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "even box32K",
+	{kChase, "even box32K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "even box16K",
+	{kChase, "even box16K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "even box8K",
+	{kChase, "even box8K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 8_kiB},
-	{&PLSX::TestTraversal, "even box2K",
+	{kChase, "even box2K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "even box1K",
+	{kChase, "even box1K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "even box.5K",
+	{kChase, "even box.5K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 /*
-	{&PLSX::TestTraversal, "random box128K",
+	{kChase, "random box128K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "random box64K",
+	{kChase, "random box64K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "random box32K",
+	{kChase, "random box32K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "random box16K",
+	{kChase, "random box16K",
 	  kRandomInBox_RandomBox,
 	    -kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
 */
 #endif//0
-};
+}};
 #undef sz
-#undef PLSX
 #endif //000
 
 #if 000
 #define sz 16
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests16C={
-/*	{&PLSX::TestTraversal, "dual box512K",
+static const LatencyTests tests16C={{sz}, {
+/*	{kChase, "dual box512K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},
-	{&PLSX::TestTraversal, "dual box256K",
+	{kChase, "dual box256K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_kiB},
-	{&PLSX::TestTraversal, "dual box128K",
+	{kChase, "dual box128K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "dual box64K",
+	{kChase, "dual box64K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "dual box32K",
+	{kChase, "dual box32K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "dual box16K",
+	{kChase, "dual box16K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "dual box2K",
+	{kChase, "dual box2K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "dual box1K",
+	{kChase, "dual box1K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "dual box.5K",
+	{kChase, "dual box.5K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 
-	{&PLSX::TestTraversal, "even box512K",
+	{kChase, "even box512K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},
-	{&PLSX::TestTraversal, "even box256K",
+	{kChase, "even box256K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_kiB},
-	{&PLSX::TestTraversal, "even box128K",
+	{kChase, "even box128K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "even box64K",
+	{kChase, "even box64K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "even box32K",
+	{kChase, "even box32K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "even box16K",
+	{kChase, "even box16K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "even box2K",
+	{kChase, "even box2K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "even box1K",
+	{kChase, "even box1K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "even box.5K",
+	{kChase, "even box.5K",
 	  kRandomInBox_RandomBox_Even,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 */
-	{&PLSX::TestTraversal, "random box512K",
+	{kChase, "random box512K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_kiB},
-	{&PLSX::TestTraversal, "random box256K",
+	{kChase, "random box256K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_kiB},
-	{&PLSX::TestTraversal, "random box128K",
+	{kChase, "random box128K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "random box32K",
+	{kChase, "random box32K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "random box16K",
+	{kChase, "random box16K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
-	{&PLSX::TestTraversal, "random box8K",
+	{kChase, "random box8K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 8_kiB},
-	{&PLSX::TestTraversal, "random box4K",
+	{kChase, "random box4K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 4_kiB},
-	{&PLSX::TestTraversal, "random box2K",
+	{kChase, "random box2K",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "random box512B",
+	{kChase, "random box512B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
-	{&PLSX::TestTraversal, "random box256B",
+	{kChase, "random box256B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 256_B},
-	{&PLSX::TestTraversal, "random box128B",
+	{kChase, "random box128B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_B},
-	{&PLSX::TestTraversal, "random box64B",
+	{kChase, "random box64B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_B},
-	{&PLSX::TestTraversal, "random box32B",
+	{kChase, "random box32B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_B},
-	{&PLSX::TestTraversal, "random box16B",
+	{kChase, "random box16B",
 	  kRandomInBox_RandomBox,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_B},
 
-};
+}};
 #undef sz
-#undef PLSX
 #endif //000
 
 #if 0000
 #define sz 128
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests128C={
+static const LatencyTests tests128C={{sz}, {
 	sectoringTests(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests(kIncreasingInBox_RandomBox, "increasing, random box")
 /*
-	{&PLSX::TestTraversal, "dual box128K",
+	{kChase, "dual box128K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "dual box64K",
+	{kChase, "dual box64K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "dual box32K",
+	{kChase, "dual box32K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "dual box16K",
+	{kChase, "dual box16K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
 
-	{&PLSX::TestTraversal, "dual box2K",
+	{kChase, "dual box2K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "dual box1K",
+	{kChase, "dual box1K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "dual box.5K",
+	{kChase, "dual box.5K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 */
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz 256
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests256C={
+static const LatencyTests tests256C={{sz}, {
 	sectoringTests(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests(kIncreasingInBox_RandomBox, "increasing, random box")
 /*
-	{&PLSX::TestTraversal, "dual box128K",
+	{kChase, "dual box128K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "dual box64K",
+	{kChase, "dual box64K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "dual box32K",
+	{kChase, "dual box32K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "dual box16K",
+	{kChase, "dual box16K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
 
-	{&PLSX::TestTraversal, "dual box2K",
+	{kChase, "dual box2K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "dual box1K",
+	{kChase, "dual box1K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "dual box.5K",
+	{kChase, "dual box.5K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 */
-};
+}};
 #undef sz
-#undef PLSX
 
 #endif //0000
 
 #define sz 512
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests512C={
+static const LatencyTests tests512C={{sz}, {
 	sectoringTests(kSameRandomInBox_IncreasingBox, "same random, increasing box")
 	sectoringTests(kDiftRandomInBox_IncreasingBox, "dift random, increasing box")
 	sectoringTests(kRandomInBox_RandomBox, "dift random, random box")
 	sectoringTests(kIncreasingInBox_RandomBox, "increasing, random box")
 /*
-	{&PLSX::TestTraversal, "dual box128K",
+	{kChase, "dual box128K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 128_kiB},
-	{&PLSX::TestTraversal, "dual box64K",
+	{kChase, "dual box64K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 64_kiB},
-	{&PLSX::TestTraversal, "dual box32K",
+	{kChase, "dual box32K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 32_kiB},
-	{&PLSX::TestTraversal, "dual box16K",
+	{kChase, "dual box16K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 16_kiB},
 
-	{&PLSX::TestTraversal, "dual box2K",
+	{kChase, "dual box2K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 2_kiB},
-	{&PLSX::TestTraversal, "dual box1K",
+	{kChase, "dual box1K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 1_kiB},
-	{&PLSX::TestTraversal, "dual box.5K",
+	{kChase, "dual box.5K",
 	  kRandomInBox_RandomBox_Dual,
 	    kL1DepthTestBytes/sz, kL1DepthTestBytes/sz, 512_B},
 */
-};
+}};
 #undef sz
-#undef PLSX
 
 
 //.............................................................................
 /*
 #define sz sizeofCacheLine64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests64={
-  {&PLSX::TestTraversal, "DiftRandomInBox RandomBox",
+static const LatencyTests tests64={{sz}, {
+  {kChase, "DiftRandomInBox RandomBox",
     kRandomInBox_RandomBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "FullRandom",
+  {kChase, "FullRandom",
     kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 #define sz sizeofCacheLine256
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests256={
-  {&PLSX::TestTraversal, "DiftRandomInBox RandomBox",
+static const LatencyTests tests256={{sz}, {
+  {kChase, "DiftRandomInBox RandomBox",
     kRandomInBox_RandomBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "FullRandom",
+  {kChase, "FullRandom",
     kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 */
 //.............................................................................
 //Primary latency tests
 
 #if 00000
 #define sz sizeofCacheLine64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests128={
-  {&PLSX::TestTraversal, "Linear Increasing",
+static const LatencyTests tests128={{sz}, {
+  {kChase, "Linear Increasing",
     kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "Linear Decreasing",
+  {kChase, "Linear Decreasing",
     kLinearDecreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "SameRandomInBox IncreasingBox",
+  {kChase, "SameRandomInBox IncreasingBox",
     kSameRandomInBox_IncreasingBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "DiftRandomInBox IncreasingBox",
+  {kChase, "DiftRandomInBox IncreasingBox",
     kDiftRandomInBox_IncreasingBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "DiftRandomInBox RandomBox",
+  {kChase, "DiftRandomInBox RandomBox",
     kRandomInBox_RandomBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "FullRandom",
+  {kChase, "FullRandom",
     kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 #endif //00000
 
 #define sz sizeofCacheLine64
-#define PLSX PerformLatencyStruct< Node<sz> >
-static const vector< TestData<sz> > tests64={
-  {&PLSX::TestTraversal, "Linear Increasing",
+static const LatencyTests tests64={{sz}, {
+  {kChase, "Linear Increasing",
     kLinearIncreasing, 16, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "Linear Decreasing",
+  {kChase, "Linear Decreasing",
     kLinearDecreasing, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "SameRandomInBox IncreasingBox",
+  {kChase, "SameRandomInBox IncreasingBox",
     kSameRandomInBox_IncreasingBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "DiftRandomInBox IncreasingBox",
+  {kChase, "DiftRandomInBox IncreasingBox",
     kDiftRandomInBox_IncreasingBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "DiftRandomInBox RandomBox",
+  {kChase, "DiftRandomInBox RandomBox",
     kRandomInBox_RandomBox, sizeofPage16K/sz, kMaxDepthBytes/sz},
-  {&PLSX::TestTraversal, "FullRandom",
+  {kChase, "FullRandom",
     kFullRandom, 16, kMaxDepthBytes/sz},
-};
+}};
 #undef sz
-#undef PLSX
 
 //=============================================================================
 
+//The achieved relative 95% CI, and how many outer samples it took.
+typedef vector< pair<double, uint64_t> > PrecisionVector;
+
 struct LatencyLengthCyclesVector:vector<
-  tuple<size_t, size_t, double, double> >{
+  tuple<size_t, size_t, double, double, double, uint64_t> >{
 	LatencyLengthCyclesVector(
-	  NumNodesVector& nv, DepthVector& dv, CyclesVector& cv){
+	  NumNodesVector& nv, DepthVector& dv, CyclesVector& cv,
+	  PrecisionVector& pv){
 		this->reserve( nv.size() );
 		for(auto i=0; i<nv.size(); i++){
 			this->push_back( tuple(
-			  nv[i].first, dv[i], cv[i].first, cv[i].second) );
+			  nv[i].first, dv[i], cv[i].first, cv[i].second,
+			  pv[i].first, pv[i].second) );
 		}
 	}
 };
@@ -2263,6 +2043,8 @@ inline std::ostream& operator<<(std::ostream& os, LatencyLengthCyclesVector cons
 		auto depth   =get<1>(lcv[i]);
 		auto cycles  =get<2>(lcv[i]);
 		auto ns      =get<3>(lcv[i]);
+		auto ci      =get<4>(lcv[i]);
+		auto samples =get<5>(lcv[i]);
 		os<<fixed<<setprecision(0)
 		  <<setw(12)
 			<<numNodes
@@ -2275,6 +2057,8 @@ inline std::ostream& operator<<(std::ostream& os, LatencyLengthCyclesVector cons
 		  <<setw(8)<<setprecision(1)
 		  	<<ns/numNodes
 		  <<setw(8)<<setprecision(1)<<cycles/ns
+		  <<setw(8)<<setprecision(2)<<100*ci
+		  <<setw(4)<<samples
 		  <<std::endl;;
 		}
 	return os<<std::endl;
@@ -2285,35 +2069,107 @@ static inline pair<double, double> scalePair(pair<double, double> in, int scale)
 	return pair(in.first/scale, in.second/scale);
 }
 
-template <uint nodeSizeInB>
-  static void PerformLatencyProbeReally(
-    const vector< TestData<nodeSizeInB> > testsV){
+//Every chain is built here; see chainArena.h.
+static ChainArena g_chainArena;
+
+static void PerformLatencyProbeReally(LatencyTests const& lt){
+	auto const& layout=lt.layout;
+
+	//Map (if we do not already have it) what the deepest point of any of
+	// the tests needs, once, before timing anything.
+	vector<NumNodesVector> nVs;
+	size_t arenaBytes=0;
+	for(auto& testData:lt.tests){
+		auto upperNumNodes=testData.upperNumNodes? testData.upperNumNodes:
+		  (uint)(kMaxDepthBytes/layout.nodeBytes);
+		nVs.emplace_back(
+		  testData.lowerNumNodes, upperNumNodes, layout.nodeBytes);
+		for(auto& nodes_ic:nVs.back()){
+			arenaBytes=max(arenaBytes, PerformLatencyStruct::ArenaBytes(
+			  layout, nodes_ic.first, testData.traversalPattern));
+		}
+	}
+	auto pages=lt.pages!=kDefaultPages? lt.pages: g_latencyPages;
+	auto arena=g_chainArena.Reserve(arenaBytes, pages);
+	if(pages!=kDefaultPages){
+		cout<<"Chains in "<<PageBackingName(g_chainArena.backing)<<" pages, "
+		  <<g_chainArena.HugePageBytes()/1_MiB<<" of "
+		  <<g_chainArena.bytes/1_MiB<<" MiB in huge pages"<<endl<<endl;
+	}
 
-	for(auto& testData:testsV){
-		NumNodesVector nV(
-		  testData.lowerNumNodes, testData.upperNumNodes, nodeSizeInB);
+	for(auto t=0; t<lt.tests.size(); t++){
+		auto& testData=lt.tests[t];
+		auto& nV=nVs[t];
 		DepthVector  dV;
+		//How fast the chains were built. The depths increase, so where the
+		// pattern allows, one chain is grown through them all, and this is
+		// the cost of building the deepest, once.
+		double buildNs=0, builtNodes=0;
+		size_t buildThreads=1;
+		PerformLatencyStruct* pls=nullptr;
+		auto loadedPoints=0;
 		CyclesVector cyclesV;
+		PrecisionVector precisionV;
+		auto traverse=SelectTraversal(testData.traversal, layout);
 //loop over region sizes
 	for(auto& nodes_ic:nV){
 		auto numNodes=nodes_ic.first;
 		auto ic      =nodes_ic.second;
-		auto pls=new PLS(numNodes,
-		  testData.traversalPattern, testData.boxSizeInB);
+		//With --chain-images, load the chain if it has been saved, and
+		// save it if not.
+		ChainImageKey key{uint64_t(testData.traversalPattern),
+		  layout.nodeBytes, layout.nextOffset, uint64_t(testData.boxSizeInB),
+		  numNodes, g_chainSeed};
+		auto imagePath=g_chainImageDirectory.empty()? string():
+		  ChainImagePath(g_chainImageDirectory, key);
+		ChainImage image;
+
+		auto buildStart=timebase_ns();
+		auto alreadyBuilt=pls? pls->builtNodes: 0;
+		auto fLoaded=!imagePath.empty()
+		  && LoadChainImage(imagePath, key, arena, g_chainArena.bytes, image);
+		if(fLoaded){
+			delete pls;
+			alreadyBuilt=0;
+			pls=new PerformLatencyStruct(arena, layout,
+			  testData.traversalPattern, testData.boxSizeInB, image);
+			loadedPoints++;
+		}else if( !pls || !pls->Extend(numNodes) ){
+			delete pls;
+			alreadyBuilt=0;
+			pls=new PerformLatencyStruct(arena, layout, numNodes,
+			  testData.traversalPattern, testData.boxSizeInB);
+		}
+		buildNs+=timebase_ns()-buildStart;
+		builtNodes+=pls->builtNodes-alreadyBuilt;
+		buildThreads=max(buildThreads, pls->buildThreads);
+		if( !fLoaded && !imagePath.empty() ){
+			SaveChainImage(imagePath, key, arena, g_chainArena.bytes, pls->Image());
+		}
 //cout << pls->numNodes;
 //loop over outer cycle count (averaging) and
 //          inner cycle count (amortize perfmon overhead)
 		CycleAverager cycleAverager(1, kFastMode?1:3);
+		cycleAverager.Adaptive(kTargetRelativeCI, kPointBudgetNs);
 		cyclesV.push_back(scalePair( cycleAverager([=](){
-				std::invoke( testData.fn, pls, pls->numNodes*ic );
+				traverse(*pls, pls->numNodes*ic);
 		}), ic));
+		precisionV.push_back(
+		  pair(cycleAverager.achievedRelativeCI(), cycleAverager.numSamples()) );
 		nodes_ic=pair(pls->numNodes, ic);
 		dV.push_back(pls->depth);
-		delete pls;
 	};
+	delete pls;
 	cout<<testData.name<<endl;
-	LatencyLengthCyclesVector lcv(nV, dV, cyclesV);
+	LatencyLengthCyclesVector lcv(nV, dV, cyclesV, precisionV);
 	cout<<lcv;
+	cout<<fixed<<setprecision(1)<<"built "<<builtNodes/1e6<<"M nodes in "
+	    <<buildNs/1e6<<"ms, "<<builtNodes/buildNs*1e3<<"M nodes/s on "
+	    <<buildThreads<<" threads";
+	if( !g_chainImageDirectory.empty() ){
+		cout<<" ("<<loadedPoints<<" of "<<nV.size()<<" points from chain images)";
+	}
+	cout<<endl<<endl;
 	};
 };
 
@@ -2331,6 +2187,18 @@ for region prefetch, try smaller regions and larger
 1M, 256K, 64k only prefetches to L2?
 */
 
+//These all share one driver, each running a different selection of tests.
+static ProbeRegistration gLatency8B({.name="latency-8b",
+	.perform=[]{PerformLatencyProbe(kLatency8B_Probe);}});
+static ProbeRegistration gL1CacheStructure({.name="l1-cache-structure",
+	.perform=[]{PerformLatencyProbe(kL1CacheStructure_Probe);}});
+static ProbeRegistration gLatencyTLB({.name="latency-tlb",
+	.perform=[]{PerformLatencyProbe(kLatencyTLB_Probe);}});
+static ProbeRegistration gLatencyStride({.name="latency-stride",
+	.perform=[]{PerformLatencyProbe(kLatencyStride_Probe);}});
+static ProbeRegistration gLatencyAll({.name="latency-all",
+	.perform=[]{PerformLatencyProbe(kLatencyAll_Probe);}});
+
 void PerformLatencyProbe(ProbeType probeType){
 
 	auto const
@@ -2341,115 +2209,51 @@ void PerformLatencyProbe(ProbeType probeType){
 	    <<setw(12)<<"numNodes"<<setw(12)<<"depth"
 	    <<setw(12)<<"cycles"
 	    <<setw(10)<<"cyc/node"<<setw(8)<<"ns/node"<<setw(8)<<"cyc/ns"
+	    <<setw(8)<<"+-%"<<setw(4)<<"n"
 	    <<endl;
 
 	if(probeType==kLatency8B_Probe || probeType==kLatencyAll_Probe){
 		//In-cache pointer chasing, and linear prefetching
 		cout<<hLine<<endl
 		  <<"Using 8B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPtr>(tests1);
+		PerformLatencyProbeReally(tests1);
 
 		//Variant pointer chasing, with a payload
 		cout<<hLine<<endl
 		  <<"Using 32B-sized node (to test payload reductions)"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPtr4>(tests4);
+		PerformLatencyProbeReally(tests4);
+		PerformLatencyProbeReally(tests4P);
 
 /* Initial tests used to orient myself, before I was sure of the cache line length
 		cout<<hLine<<endl
 		  <<"Using 512B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<512>(tests512C);
+		PerformLatencyProbeReally(tests512C);
 		cout<<hLine<<endl
 		  <<"Using 256B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<256>(tests256C);
+		PerformLatencyProbeReally(tests256C);
 		cout<<hLine<<endl
 		  <<"Using 128B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<128>(tests128C);
+		PerformLatencyProbeReally(tests128C);
 		cout<<hLine<<endl
 		  <<"Using 64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<64>(tests64C);
+		PerformLatencyProbeReally(tests64C);
 		cout<<hLine<<endl
 		  <<"Using 32B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<32>(tests32C);
+		PerformLatencyProbeReally(tests32C);
 */
 	}
 
 	if(probeType==kLatencyStride_Probe || probeType==kLatencyAll_Probe){
 		//Test stride prefetchers
-		cout<<hLine<<endl
-		  <<"Using 63B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<63>(tests63P);
-
-		cout<<hLine<<endl
-		  <<"Using 64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<64>(tests64P);
-
-		cout<<hLine<<endl
-		  <<"Using 65B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<65>(tests65P);
-
-		cout<<hLine<<endl
-		  <<"Using 120B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<120>(tests120P);
-
-		cout<<hLine<<endl
-		  <<"Using 121B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<121>(tests121P);
-
-		cout<<hLine<<endl
-		  <<"Using 127B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<127>(tests127P);
-
-		cout<<hLine<<endl
-		  <<"Using 128B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<128>(tests128P);
-
-		cout<<hLine<<endl
-		  <<"Using 136B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<136>(tests136P);
-
-		cout<<hLine<<endl
-		  <<"Using 256B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<256>(tests256P);
-
-		cout<<hLine<<endl
-		  <<"Using 257B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<257>(tests257P);
-
-		cout<<hLine<<endl
-		  <<"Using 272B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<272>(tests272P);
-
-		cout<<hLine<<endl
-		  <<"Using 288B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<288>(tests288P);
-
-		cout<<hLine<<endl
-		  <<"Using 320B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<320>(tests320P);
-
-		cout<<hLine<<endl
-		  <<"Using 384B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<384>(tests384P);
-
-		cout<<hLine<<endl
-		  <<"Using 31*64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<1984>(tests1984P);
-
-		cout<<hLine<<endl
-		  <<"Using 8kB-64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<8128>(tests8128P);
-
-		cout<<hLine<<endl
-		  <<"Using 16kB-3*64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<16192>(tests16192P);
-
-		cout<<hLine<<endl
-		  <<"Using 32kB-3*64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<32576>(tests32576P);
-
-		cout<<hLine<<endl
-		  <<"Using 64kB-3*64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<65152>(tests65152P);
+		for(auto stride:g_latencyStrides){
+			cout<<hLine<<endl
+			  <<"Using "<<stride<<"B-sized node";
+			if(g_latencyPointerOffset){
+				cout<<" (pointer at +"<<g_latencyPointerOffset<<"B)";
+			}
+			cout<<endl<<endl;
+			PerformLatencyProbeReally(StrideTests(stride));
+		}
 	}
 
 
@@ -2458,53 +2262,62 @@ void PerformLatencyProbe(ProbeType probeType){
 		//Testing TLB behavior (assuming 4KiB+64 page)
 		cout<<hLine<<endl
 		  <<"Using 4kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage4K64>(tests4K64);
+		PerformLatencyProbeReally(tests4K64);
 
 		//Testing TLB behavior (assuming 12KiB+64 page)
 		cout<<hLine<<endl
 		  <<"Using 12kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage12K64>(tests12K64);
+		PerformLatencyProbeReally(tests12K64);
 
 		//Testing TLB behavior (assuming 32KiB+64 page)
 		cout<<hLine<<endl
 		  <<"Using 32kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage32K64>(tests32K64);
+		PerformLatencyProbeReally(tests32K64);
 */
 
 		//Testing TLB behavior
 		cout<<hLine<<endl
 		  <<"Using 16kiB sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage16K>(tests16K);
+		PerformLatencyProbeReally(tests16K);
+
+		//The same, in each kind of page we can get, to tell what is TLB
+		// (and what huge pages buy) from what is cache
+		for(auto pages:{kBasePages, kTransparentHugePages, kHugePages2M}){
+			if( !PageBackingExists(pages) ){continue;}
+			cout<<hLine<<endl
+			  <<"Using 16kiB sized node, "<<PageBackingName(pages)<<" pages"<<endl<<endl;
+			PerformLatencyProbeReally(WithPages(tests16K, pages));
+		}
 
 		//Testing TLB behavior (using 16kiB+64 )
 		cout<<hLine<<endl
 		  <<"Using 16kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage16K64>(tests16K64);
+		PerformLatencyProbeReally(tests16K64);
 
 		//Testing TLB behavior (assuming 8KiB+64 page)
 		cout<<hLine<<endl
 		  <<"Using 8kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage8K64>(tests8K64);
+		PerformLatencyProbeReally(tests8K64);
 
 		cout<<hLine<<endl
 		  <<"Using 32kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage32K64>(tests32K64);
+		PerformLatencyProbeReally(tests32K64);
 
 		cout<<hLine<<endl
 		  <<"Using 64kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage64K64>(tests64K64);
+		PerformLatencyProbeReally(tests64K64);
 
 		cout<<hLine<<endl
 		  <<"Using 128kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage128K64>(tests128K64);
+		PerformLatencyProbeReally(tests128K64);
 
 		cout<<hLine<<endl
 		  <<"Using 256kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage256K64>(tests256K64);
+		PerformLatencyProbeReally(tests256K64);
 
 		cout<<hLine<<endl
 		  <<"Using 512kiB+64 sized node"<<endl<<endl;
-		PerformLatencyProbeReally<sizeofPage512K64>(tests512K64);
+		PerformLatencyProbeReally(tests512K64);
 	}
 
 	if(0 /*probeType==kL1CacheStructure_Probe || probeType==kLatencyAll_Probe*/){
@@ -2517,57 +2330,57 @@ needs to be a lot more sophisticated.
 		//L1 Capacity Test
 		cout<<hLine<<endl<<"L1 Capacity Tests"<<endl
 		  <<"Using 8B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<8_B>(tests8Ca);
+		PerformLatencyProbeReally(tests8Ca);
 
 		//L1 Line Length Tests
 		cout<<hLine<<endl<<"L1 Line Length Tests"<<endl
 		  <<"Using (3*)32B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<3*32_B>(tests32Li);
+		PerformLatencyProbeReally(tests32Li);
 		cout<<hLine<<endl
 		  <<"Using (3*)64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<3*64_B>(tests64Li);
+		PerformLatencyProbeReally(tests64Li);
 		cout<<hLine<<endl
 		  <<"Using (3*)128B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<3*128_B>(tests128Li);
+		PerformLatencyProbeReally(tests128Li);
 
 		//L1 Associativity Tests
 		cout<<hLine<<endl<<"L1 Associativity Tests"<<endl
 		  <<"Using 32kiB-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<32_kiB>(tests32KA);
+		PerformLatencyProbeReally(tests32KA);
 		cout<<hLine<<endl
 		  <<"Using 16kiB-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<16_kiB>(tests16KA);
+		PerformLatencyProbeReally(tests16KA);
 		cout<<hLine<<endl
 		  <<"Using 8kiB-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<8_kiB>(tests8KA);
+		PerformLatencyProbeReally(tests8KA);
 */
 
 //L1 Sectoring tests
 	cout<<hLine<<endl<<"L1 Sectoring Tests"<<endl
 	  <<"Using 32B-sized node"<<endl<<endl;
-	PerformLatencyProbeReally<32>(tests32C);
+	PerformLatencyProbeReally(tests32C);
 	cout<<hLine<<endl
 	  <<"Using 16B-sized node"<<endl<<endl;
-	PerformLatencyProbeReally<16>(tests16C);
+	PerformLatencyProbeReally(tests16C);
 	cout<<hLine<<endl
 	  <<"Using 8B-sized node"<<endl<<endl;
-	PerformLatencyProbeReally<8>(tests8C);
+	PerformLatencyProbeReally(tests8C);
 
 	cout<<hLine<<endl
 	  <<"Using 64B-sized node"<<endl<<endl;
-	PerformLatencyProbeReally<64>(tests64C);
+	PerformLatencyProbeReally(tests64C);
 	cout<<hLine<<endl
 	  <<"Using 128B-sized node"<<endl<<endl;
-	PerformLatencyProbeReally<128>(tests128C);
+	PerformLatencyProbeReally(tests128C);
 	cout<<hLine<<endl
 	  <<"Using 256B-sized node"<<endl<<endl;
-	PerformLatencyProbeReally<256>(tests256C);
+	PerformLatencyProbeReally(tests256C);
 	}
 	
 	if(/*probeType==kL1CacheStructure_Probe || probeType==kLatencyAll_Probe*/ 1){
 		cout<<hLine<<endl
 		  <<"Using 64B-sized node"<<endl<<endl;
-		PerformLatencyProbeReally<64>(tests64);
+		PerformLatencyProbeReally(tests64);
 	}
 };
 //=============================================================================
@@ -20,13 +20,21 @@
 #include <algorithm>
 #include <numeric>
 #include <assert.h>
+#include <string.h>
 #include <array>
+#include <cmath>
 
+//Nothing from Accelerate is called; it is only included where it exists,
+// so there is nothing to fall back to elsewhere. (memcpy/memmove, which it
+// used to bring in, come from string.h.)
+#if defined(__APPLE__)
 #include <Accelerate/Accelerate.h>
+#endif
 
 #include "General.h"
 #include "Probes.h"
 #include "m1cycles.h"
+#include "counterEvents.h"
 
 //For god knows what reason some of the (nowhere defined...) inline assembly that
 // is accepted by Clang under optimized compile is not accepted under debug
@@ -36,6 +44,8 @@
 
 //=============================================================================
 
+static ProbeRegistration gStream({.name="stream", .perform=PerformStreamProbe});
+
 void PerformStreamProbe(){
 /*
 	Essentially John D. McCalpin's STREAM benchmark, but I removed various
@@ -43,9 +53,9 @@ void PerformStreamProbe(){
 	These results should be comparable to standard STREAM results.
 
 	I include them mainly for the sake of comparison.
-	If you want to run this on anything but an M1, you need to figure out
-	some appropriate timing scheme; I just used cycle count and assumed
-	P core at maximum frequency.
+	Times come from the calibrated timebase (timebase.h), so this runs as is
+	on anything; the GHz column is the frequency each kernel's best run
+	actually achieved, and is flagged if it fell below the peak seen.
 	The probes you probably want to run are the variants of these that
 	generate bandwidth curves for a variety of different access patterns.
 	
@@ -112,62 +122,76 @@ void PerformStreamProbe(){
 
     /*	--- MAIN LOOP --- repeat test cases NTIMES times --- */
     PerformanceCounters pc;
-    double cycles[4][NTIMES];
+    double cycles[4][NTIMES], ns[4][NTIMES];
+    auto kernel=[&](int j, int k, auto const& body){
+		pc=get_counters();
+		body();
+		pc-=get_counters();
+		cycles[j][k]=pc.cycles();
+		ns[j][k]    =pc.realtime_ns;
+		note_core_frequency(pc.cycles(), pc.realtime_ns);
+	};
     
     for(int k=0; k<NTIMES; k++){
     	//Copy
-		pc=get_counters();
-		for(int j=0; j<STREAM_ARRAY_SIZE; j++)
-	    	c[j] = a[j];
-		pc-=get_counters();
-		cycles[0][k]=pc.cycles();
+		kernel(0, k, [&](){
+			for(int j=0; j<STREAM_ARRAY_SIZE; j++)
+		    	c[j] = a[j];
+		});
 
 		//Scale
-		pc=get_counters();
-		for(int j=0; j<STREAM_ARRAY_SIZE; j++)
-		    b[j] = scalar*c[j];
-		pc-=get_counters();
-		cycles[1][k]=pc.cycles();
+		kernel(1, k, [&](){
+			for(int j=0; j<STREAM_ARRAY_SIZE; j++)
+			    b[j] = scalar*c[j];
+		});
 
 		//Add
-		pc=get_counters();
-		for(int j=0; j<STREAM_ARRAY_SIZE; j++)
-		    c[j] = a[j]+b[j];
-		pc-=get_counters();
-		cycles[2][k]=pc.cycles();
+		kernel(2, k, [&](){
+			for(int j=0; j<STREAM_ARRAY_SIZE; j++)
+			    c[j] = a[j]+b[j];
+		});
 	
 		//Triad
-		pc=get_counters();
-		for(int j=0; j<STREAM_ARRAY_SIZE; j++)
-		    a[j] = b[j] + scalar*c[j];
-		pc-=get_counters();
-		cycles[3][k]=pc.cycles();
+		kernel(3, k, [&](){
+			for(int j=0; j<STREAM_ARRAY_SIZE; j++)
+			    a[j] = b[j] + scalar*c[j];
+		});
 	}
 
     /*	--- SUMMARY --- */
 
+	//Times come from the calibrated timebase; the cycle counts only give
+	// cyc/elem, and (with the times) the frequency we actually ran at.
+	double mincycles[4]={FLT_MAX,FLT_MAX,FLT_MAX,FLT_MAX}, ghz[4];
     for(int k=1; k<NTIMES; k++){ // note -- skip first iteration
 		for(int j=0; j<4; j++){
-			avgtime[j]+=cycles[j][k];
-			mintime[j] =min(mintime[j], cycles[j][k]);
-			maxtime[j] =max(maxtime[j], cycles[j][k]);
+			avgtime[j]+=ns[j][k];
+			if(ns[j][k]<mintime[j]){
+				mintime[j]  =ns[j][k];
+				ghz[j]      =cycles[j][k]/ns[j][k];
+			}
+			mincycles[j]=min(mincycles[j], cycles[j][k]);
+			maxtime[j]  =max(maxtime[j], ns[j][k]);
 		}
 	}
 	for(int j=0; j<4; j++){
-		const double cyclesToSec=1/3.2E9;
-		avgtime[j]*=cyclesToSec/(NTIMES-1);
-		maxtime[j]=mintime[j]/STREAM_ARRAY_SIZE;//*=cyclesToSec;
-		mintime[j]*=cyclesToSec;
+		const double nsToSec=1E-9;
+		avgtime[j]*=nsToSec/(NTIMES-1);
+		maxtime[j]*=nsToSec;
+		mintime[j]*=nsToSec;
 	}
 		
     
-    printf("Function    Best Rate GB/s  Avg time     Min time     cyc/elem \n");
+    printf("Function    Best Rate GB/s  Avg time     Min time     cyc/elem     GHz\n");
     for(int j=0; j<4; j++) {
-		printf("%s%12.1f  %11.6f  %11.6f  %11.6f\n", label[j],
+		printf("%s%12.1f  %11.6f  %11.6f  %11.6f  %6.2f%s\n", label[j],
 	       1.0E-09 * bytes[j]/mintime[j],
 	       avgtime[j],
 	       mintime[j],
-	       maxtime[j]);
+	       mincycles[j]/STREAM_ARRAY_SIZE,
+	       ghz[j],
+	       (ghz[j]<kFrequencyDropFraction*peak_core_frequency_ghz())?
+	         "  (below peak frequency)": "");
     }
     printf(HLINE);
 }
@@ -2111,6 +2135,11 @@ void TestST1LD3_B(size_t){
 		testMemberFn 						fn;
 		string								name;
 		double								numLdStOps;
+		//The widest single load or store the test can retire, in bytes:
+		// LDP of Q registers (which compiled loops and memcpy use) moves 32B,
+		// LDP of D registers 16B, and memset-style tests may use DC ZVA,
+		// which zeroes a 64B block.
+		double								widestLdStBytes=32;
 	};
 	struct TestDataBlock{
 		TestData* 		tests;
@@ -2118,12 +2147,11 @@ void TestST1LD3_B(size_t){
 
 		testMemberFn	preflightFn;
 
-		array<int,VARIABLE_COUNTERS_COUNT>
-		          		counterSettings;
-		array<int,VARIABLE_COUNTERS_COUNT+1>
-						printOrdering;
-		array<string,VARIABLE_COUNTERS_COUNT>
-						printStrings;
+		//Counter events to capture, in print order, and their column headings.
+		//These are scheduled onto the counters by CounterSchedule, which will
+		// rerun each test as many times as needed to capture them all.
+		vector<string>	events;
+		vector<string>	headings;
 	};
 	
 	static TestData testsLSULd[], testsLSUSt[], testsLSUStLd[],
@@ -2391,8 +2419,8 @@ PerformBandwidthStruct::TestData PerformBandwidthStruct::testsLoad[]={
 	{&PerformBandwidthStruct::TestReduceSTL, "STL Reduction", 1},
 	{&PerformBandwidthStruct::TestReduce8Wide, "Reduction 8Wide", 1},
 
-	{&PerformBandwidthStruct::TestLDP, "Reduction LDP", 1},
-	{&PerformBandwidthStruct::TestLDNP, "Reduction LDNP", 1},
+	{&PerformBandwidthStruct::TestLDP, "Reduction LDP", 1, 16},
+	{&PerformBandwidthStruct::TestLDNP, "Reduction LDNP", 1, 16},
 	{&PerformBandwidthStruct::TestLDPQ, "Reduction LDPQ", 1},
 	{&PerformBandwidthStruct::TestLDNPQ, "Reduction LDNPQ", 1},
 	{&::PerformBandwidthStruct::TestReducAntiNaive, "AntiNaive Reduction", 1},
@@ -2403,20 +2431,20 @@ PerformBandwidthStruct::TestData PerformBandwidthStruct::testsLoad[]={
 };
 
 PerformBandwidthStruct::TestData PerformBandwidthStruct::testsStore[]={
-	{&PerformBandwidthStruct::TestFill, "Naive Fill", 1},
-	{&PerformBandwidthStruct::TestFill2, "Naive Fill2", 1},
+	{&PerformBandwidthStruct::TestFill, "Naive Fill", 1, 64},
+	{&PerformBandwidthStruct::TestFill2, "Naive Fill2", 1, 64},
 	{&PerformBandwidthStruct::TestFill3, "Naive Fill Partial", .75},
-	{&PerformBandwidthStruct::TestFillSTL,"STL Fill", 1},
+	{&PerformBandwidthStruct::TestFillSTL,"STL Fill", 1, 64},
 
-	{&PerformBandwidthStruct::TestSTP, "STP", 1},
-	{&PerformBandwidthStruct::TestSTNP, "STNP", 1},
+	{&PerformBandwidthStruct::TestSTP, "STP", 1, 16},
+	{&PerformBandwidthStruct::TestSTNP, "STNP", 1, 16},
 	{&PerformBandwidthStruct::TestSTPQ, "STPQ", 1},
 	{&PerformBandwidthStruct::TestSTNPQ, "STNPQ", 1},
 
-	{&PerformBandwidthStruct::TestDCZero,"DC ZVA", 1},
-	{&PerformBandwidthStruct::TestDCZeroWithLoad,"DC ZVA with load", 1},
-	{&PerformBandwidthStruct::TestDCZeroWithStore,"DC ZVA with store", 1},
-	{&PerformBandwidthStruct::TestDCZeroWithStoreAsm,"DC ZVA with store asm", 1},
+	{&PerformBandwidthStruct::TestDCZero,"DC ZVA", 1, 64},
+	{&PerformBandwidthStruct::TestDCZeroWithLoad,"DC ZVA with load", 1, 64},
+	{&PerformBandwidthStruct::TestDCZeroWithStore,"DC ZVA with store", 1, 64},
+	{&PerformBandwidthStruct::TestDCZeroWithStoreAsm,"DC ZVA with store asm", 1, 64},
 };
 
 PerformBandwidthStruct::TestData PerformBandwidthStruct::testsCopy[]={
@@ -2429,7 +2457,7 @@ PerformBandwidthStruct::TestData PerformBandwidthStruct::testsCopy[]={
 	{&PerformBandwidthStruct::TestCopyNaive2, "Naive Copy2", 2},
 	{&PerformBandwidthStruct::TestCopyC, "C Copy", 2},
 	{&PerformBandwidthStruct::TestCopySTL, "STL Copy", 2},
-	{&PerformBandwidthStruct::TestAntiCopyDCZVA,"AntiCopy DC ZVA", 1.5},
+	{&PerformBandwidthStruct::TestAntiCopyDCZVA,"AntiCopy DC ZVA", 1.5, 64},
 //	{&PerformBandwidthStruct::TestAntiCopyDCZVA,"AntiCopy DC ZVA", 2},
 
 	{&PerformBandwidthStruct::TestMoveC8, "C memmove8", 2},
@@ -2447,21 +2475,6 @@ PerformBandwidthStruct::TestData PerformBandwidthStruct::testsOps[]={
 	{&PerformBandwidthStruct::TestFMACOverwrite, "FMAC Overwrite", -4},
 };
 
-/*
-//From /usr/share/kpep/a14.plist
-#define MAP_LDST_UOP 		125		//
-#define LD_UNIT_UOP			166		//
-#define INST_LDST			155		//5
-#define L1D_CACHE_MISS_LD	163
-#define LD_NT_UOP			230
-
-#define ST_UNIT_UOP			167
-#define L1D_CACHE_MISS_ST	162
-#define L1D_CACHE_WRITEBACK 168
-#define ST_NT_UOP			229
-#define ST_MEMORY_ORDER_VIOLATION_NONSPEC 196 //5,4,3
-*/
-
 #define makeTDB(tests)					\
 	static_cast<TestData*>(tests), lengthof(tests)
 
@@ -2469,24 +2482,22 @@ PerformBandwidthStruct::TestDataBlock
   PerformBandwidthStruct::testLSUDataBlocks[]={
 
 	{makeTDB(PerformBandwidthStruct::testsLSULd), nullptr,
-	  {MAP_LDST_UOP, LD_UNIT_UOP, L1D_CACHE_MISS_LD, 0,
-	  0, INST_LDST, 0, 0},
-	  {0, 5, 1, 2, -1, -1,-1,-1,-1},
-	  {"regs", "rets", "uops", "l1Ms", "uopNT", "","",""},
+	  {"MAP_LDST_UOP", "INST_LDST", "LD_UNIT_UOP", "L1D_CACHE_MISS_LD"},
+	  {"regs",         "rets",      "uops",        "l1Ms"},
 	},
 
 	{makeTDB(PerformBandwidthStruct::testsLSUSt), nullptr,
-	  {MAP_LDST_UOP, ST_UNIT_UOP, L1D_CACHE_MISS_ST, ST_NT_UOP,
-	  ST_MEMORY_ORDER_VIOLATION_NONSPEC, INST_LDST, L1D_CACHE_WRITEBACK, 0},
-	  {0, 5, 1, 2, 6, 3, 4, -1,-1},
-	  {"regs", "rets", "uops", "l1Ms", "l1Wbs", "uopNT", "lsViol",""},
+	  {"MAP_LDST_UOP", "INST_LDST", "ST_UNIT_UOP", "L1D_CACHE_MISS_ST",
+	   "L1D_CACHE_WRITEBACK", "ST_NT_UOP", "ST_MEMORY_ORDER_VIOLATION_NONSPEC"},
+	  {"regs",         "rets",      "uops",        "l1Ms",
+	   "l1Wbs",               "uopNT",     "lsViol"},
 	},
 
 	{makeTDB(PerformBandwidthStruct::testsLSUStLd), nullptr,
-	  {MAP_LDST_UOP, LD_UNIT_UOP, ST_UNIT_UOP, 0,
-	  ST_MEMORY_ORDER_VIOLATION_NONSPEC, INST_LDST, 0, 0},
-	  {0, 5, 1, 2, 4, -1,-1,-1,-1},
-	  {"regs", "rets", "uopsL", "uopsS", "lsViol", "","",""},
+	  {"MAP_LDST_UOP", "INST_LDST", "LD_UNIT_UOP", "ST_UNIT_UOP",
+	   "ST_MEMORY_ORDER_VIOLATION_NONSPEC"},
+	  {"regs",         "rets",      "uopsL",       "uopsS",
+	   "lsViol"},
 	},
 
 };
@@ -2495,69 +2506,106 @@ PerformBandwidthStruct::TestDataBlock
   PerformBandwidthStruct::testDataBlocks[]={
 
 	{makeTDB(PerformBandwidthStruct::testsLoad), nullptr,
-	  {MAP_LDST_UOP, LD_UNIT_UOP, L1D_CACHE_MISS_LD, LD_NT_UOP,
-	  0, INST_LDST, 0, 0},
-	  {0, 5, 1, 2, 3, -1,-1,-1,-1},
-	  {"regs", "rets", "uops", "l1Ms", "uopNT", "","",""},
+	  {"MAP_LDST_UOP", "INST_LDST", "LD_UNIT_UOP", "L1D_CACHE_MISS_LD",
+	   "LD_NT_UOP"},
+	  {"regs",         "rets",      "uops",        "l1Ms",
+	   "uopNT"},
 	},
 
 	{makeTDB(PerformBandwidthStruct::testsStore), &PerformBandwidthStruct::PreflightLDPQ,
-	  {MAP_LDST_UOP, ST_UNIT_UOP, L1D_CACHE_MISS_ST, ST_NT_UOP,
-	  ST_MEMORY_ORDER_VIOLATION_NONSPEC, INST_LDST, L1D_CACHE_WRITEBACK, 0},
-	  {0, 5, 1, 2, 6, 3, 4, -1,-1},
-	  {"regs", "rets", "uops", "l1Ms", "l1WB", "uopNT", "lsViol",""},
+	  {"MAP_LDST_UOP", "INST_LDST", "ST_UNIT_UOP", "L1D_CACHE_MISS_ST",
+	   "L1D_CACHE_WRITEBACK", "ST_NT_UOP", "ST_MEMORY_ORDER_VIOLATION_NONSPEC"},
+	  {"regs",         "rets",      "uops",        "l1Ms",
+	   "l1WB",                "uopNT",     "lsViol"},
 	},
 
 	{makeTDB(PerformBandwidthStruct::testsCopy), nullptr,
-//	  {MAP_LDST_UOP, ST_UNIT_UOP, L1D_CACHE_MISS_ST, LD_NT_UOP,
-	  {MAP_LDST_UOP, ST_UNIT_UOP, L1D_CACHE_MISS_ST, ST_NT_UOP,
-	  LD_UNIT_UOP, INST_LDST, L1D_CACHE_WRITEBACK, L1D_CACHE_MISS_LD},
-	  {0, 5, 1, 2, 6, 3, 4, 7,-1},
-	  {"regs", "rets", "uopSt", "l1Ms", "l1WB", "uopNT", "uopLd","l1Ms"},
+	  {"MAP_LDST_UOP", "INST_LDST", "ST_UNIT_UOP", "L1D_CACHE_MISS_ST",
+	   "L1D_CACHE_WRITEBACK", "ST_NT_UOP", "LD_UNIT_UOP", "L1D_CACHE_MISS_LD"},
+	  {"regs",         "rets",      "uopSt",       "l1MsSt",
+	   "l1WB",                "uopNT",     "uopLd",       "l1MsLd"},
 	},
 
 	{makeTDB(PerformBandwidthStruct::testsOps), nullptr,
-	  {0,0,0,0,0,0,0,0}, {-1,-1,-1,-1,-1,-1,-1,-1,-1},
-	  {"","","","","","","",""},
+	  {}, {},
 	},
 
 };
 
 //=============================================================================
 
-//The tuple elements are
-// <0> length of the region in STREAM_TYPEs (ie in UINT64's)
-// <1> scale factor (num load+stores) per operation
-// <2> time in ns
-// <3> performance counter array valus (raw, unscaled by num load/stores)
+typedef vector<ScheduledCounters> ScheduledCountersVector;
+
+//A check that each test did what its TestData says, using the retired
+// load/store instruction count (when the schedule includes it): a test
+// needing numLdStOps loads and stores per element can use no fewer
+// instructions than that many elements' bytes over the widest access it
+// can make, nor more than numLdStOps (one instruction per element).
+// Outside that range it was compiled into something else (or away
+// altogether), and its bandwidth means nothing.
+static char const*  kRetiredLdStEvent="INST_LDST";
+
+//Returns false, with the range in lo and hi, if the load/stores retired
+// per element were outside it; true if they were in it, or not counted.
+static bool LdStRetiredAsBuilt(ScheduledCounters const& counters,
+  CounterSchedule const& schedule, size_t length, double numLdStOps,
+  double widestLdStBytes, double& retired, double& lo, double& hi){
+	if(numLdStOps<=0){return true;}
+	for(auto i=0; i<schedule.events.size(); i++){
+		if(schedule.events[i]->name!=kRetiredLdStEvent){continue;}
+		//Not counted, so nothing to check.
+		if( isnan(counters.events[i]) ){return true;}
+		retired=counters.events[i]/length;
+		lo=numLdStOps*sizeof(STREAM_TYPE)/widestLdStBytes;
+		hi=numLdStOps;
+		return retired>=lo && retired<=hi;
+	}
+	return true;
+}
+
+//The pair elements are
+// first  length of the region in STREAM_TYPEs (ie in UINT64's)
+// second counters and time (raw, unscaled by num load/stores)
+//scale is the number of load+stores per operation.
+//widestLdStBytes is the widest load or store the test can make.
 struct BWLengthCyclesVector{
-	vector< tuple<size_t, double, counters_t> > v;
+	vector< pair<size_t, ScheduledCounters> > v;
 	double  											scale;
-	PerformBandwidthStruct::TestDataBlock& 				tdb;
+	double  											widestLdStBytes;
+	CounterSchedule const& 								schedule;
 
-	BWLengthCyclesVector(LengthsVector& lv, CyclesVectorB& cv, double scale,
-	    PerformBandwidthStruct::TestDataBlock& tdb):
-	    scale(scale), tdb(tdb){
+	BWLengthCyclesVector(LengthsVector& lv, ScheduledCountersVector& cv,
+	    double scale, double widestLdStBytes, CounterSchedule const& schedule):
+	    scale(scale), widestLdStBytes(widestLdStBytes), schedule(schedule){
 		v.reserve( lv.size() );
 		for(auto i=0; i<lv.size(); i++){
-			v.push_back( tuple(
-			  lv[i], cv[i].second, cv[i].first ));
+			v.push_back( pair(lv[i], cv[i]) );
 		}
 	}
 };
 
 inline std::ostream& operator<<(std::ostream& os, BWLengthCyclesVector const& lcv){
+	os<<fixed
+	  <<setw(10)<<"length"<<setw(10)<<"in bytes"
+	  <<setw(8)<<"op/cyc"<<setw( 8)<<"B/cyc"
+	  <<setw(8)<<"GB/sec"<<setw(8)<<"GHz";
+	for(auto& heading:lcv.schedule.headings){
+		os<<setw(8)<<heading;
+	}
+	os<<std::endl;
+
 	auto lcvv=lcv.v;
+	auto numMismatched=0;
 	for(auto i=0; i<lcvv.size(); i++){
 		auto scale     =lcv.scale;
 		if(scale<0){scale=1;}
-		auto& counters =get<2>(lcvv[i]);
-		auto cycles    =counters[0+0];
+		auto& counters =lcvv[i].second;
+		auto cycles    =counters.cycles;
 
-		auto length   =get<0>(lcvv[i]);
+		auto length   =lcvv[i].first;
 		auto lengthInB=length*sizeof(STREAM_TYPE);
 		auto scaledCycles=cycles/scale;
-		auto ns       =get<1>(lcvv[i]);
+		auto ns       =counters.realtime_ns;
 
 		os<<fixed<<setprecision(0)<<setw(10)
 			<<length
@@ -2572,10 +2620,16 @@ inline std::ostream& operator<<(std::ostream& os, BWLengthCyclesVector const& lc
 		  <<setw(8)<<setprecision(2)
 			<<cycles/ns;
 
-		auto p=&lcv.tdb.printOrdering[0];
-		auto idx=*p;
-		while( (idx=*p++) >=0){
-			os<<setw(8)<<	counters[2+idx]/length;
+		for(auto event:counters.events){
+			if( isnan(event) ){os<<setw(8)<<"-"; continue;}
+			os<<setw(8)<<	event/length;
+		}
+		double retired, lo, hi;
+		if( !LdStRetiredAsBuilt(counters, lcv.schedule, length, lcv.scale,
+		  lcv.widestLdStBytes, retired, lo, hi) ){
+			os<<"  <- retired "<<setprecision(3)<<retired
+			  <<" ld/st per element, not "<<lo<<".."<<hi;
+			numMismatched++;
 		}
 		os<<std::endl;
 /*
@@ -2615,6 +2669,11 @@ inline std::ostream& operator<<(std::ostream& os, BWLengthCyclesVector const& lc
 		  <<std::endl;;
 */
 		}
+	if(numMismatched>0){
+		os<<"WARNING: "<<numMismatched<<" of "<<lcvv.size()
+		  <<" lengths did not retire the loads and stores the test needs;"
+		  <<" do not use them"<<std::endl;
+	}
 	return os<<std::endl;
 }
 //=============================================================================
@@ -2627,11 +2686,11 @@ static void PerformBandwidthProbeLSU(void){
 
 //loop over test blocks
 	for(auto& tdb:PerformBandwidthStruct::testLSUDataBlocks){
-		setup_performance_counters(kUsePCore, &tdb.counterSettings[0]);
+		CounterSchedule schedule(tdb.events, tdb.headings);
 
 //loop over tests within a test block
 		for(auto iTest=0; iTest<tdb.numTests; iTest++){
-			CyclesVectorB cycles;
+			ScheduledCountersVector cycles;
 			auto&         testData=tdb.tests[iTest];
 
 //loop over outer cycle count (averaging) and
@@ -2641,11 +2700,11 @@ static void PerformBandwidthProbeLSU(void){
 //			if(scale<0){scale=1;}
 			cycles.push_back( cycleAverager([=](){
 					std::invoke(testData.fn, pbs, arrayLength);
-			}, kCaptureAllCounters));
+			}, schedule));
 
 			cout<<testData.name<<endl;
 			BWLengthCyclesVector lcv(pbs->arrayLengths, cycles,
-			  testData.numLdStOps, tdb);
+			  testData.numLdStOps, testData.widestLdStBytes, schedule);
 			cout<<lcv;
 		}
 	}
@@ -2657,11 +2716,11 @@ static void PerformBandwidthProbeToDRAM(bool fZeros){
 
 //loop over test blocks
 	for(auto& tdb:PerformBandwidthStruct::testDataBlocks){
-		setup_performance_counters(kUsePCore, &tdb.counterSettings[0]);
+		CounterSchedule schedule(tdb.events, tdb.headings);
 
 //loop over tests within a test block
 		for(auto iTest=0; iTest<tdb.numTests; iTest++){
-			CyclesVectorB cycles;
+			ScheduledCountersVector cycles;
 			auto&         testData=tdb.tests[iTest];
 
 			//Run a "cleaner" function before running each test.
@@ -2684,25 +2743,24 @@ static void PerformBandwidthProbeToDRAM(bool fZeros){
 				if(scale>0){scale=1;}else{scale=-scale;}
 				cycles.push_back( cycleAverager([=](){
 						std::invoke(testData.fn, pbs, arrayLength/scale);
-				}, kCaptureAllCounters));
+				}, schedule));
 			}
 			cout<<testData.name<<endl;
 			BWLengthCyclesVector lcv(pbs->arrayLengths, cycles,
-			  testData.numLdStOps, tdb);
+			  testData.numLdStOps, testData.widestLdStBytes, schedule);
 			cout<<lcv;
 		}
 	}
 	delete pbs;
 };
 
+static ProbeRegistration gMemoryBandwidth({
+	.name="memory-bandwidth", .perform=PerformBandwidthProbe});
+
 void PerformBandwidthProbe(){
 	auto const
 	  hLine="----------------------------------------------------------------";
 	cout<<"Bandwidth Tests"<<endl;
-	cout<<fixed
-	    <<setw(10)<<"length"<<setw(10)<<"in bytes"
-	    <<setw(8)<<"op/cyc"<<setw( 8)<<"B/cyc"
-	    <<setw(8)<<"GB/sec"<<setw(8)<<"GHz"<<endl;
 /*
 	cout<<hLine<<endl
 	  <<"LSU/L1 bandwidth tests"<<endl<<endl;
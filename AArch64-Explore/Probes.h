@@ -10,8 +10,15 @@
 
 #include <iostream>
 #include <float.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+using namespace std;
 //.............................................................................
 
+//Selects among the variants of the C probes that share code.
+//(Assembly probes need no enum; see ProbeDefinition below.)
 enum ProbeType{
   kCProbes=0,
 	kStream_Probe=kCProbes,
@@ -25,67 +32,111 @@ enum ProbeType{
 	
 	kL1CacheLineLength_Probe,
 
-	kCurrentCProbe,
+	kHarness_Probe,
 
-  kAssemblyProbes,
-    kROBSize_NOPs_Probe=kAssemblyProbes,
-    kZCL1_Registers_Probe,
-    kZCL2_Stack_Probe,
-    kZCL3_Stride_Probe,
-    kTLB_NumSimultaneousLookups_Probe,
-    kL1D_TestWayPredictor_Probe,
+	kCurrentCProbe
+};
+//=============================================================================
+#pragma mark Probe Registry
+/*
+	Every probe describes itself once, in the file that implements it, by
+	registering a ProbeDefinition:
+		static ProbeRegistration gStream({
+			.name="stream", .perform=PerformStreamProbe});
+	main.cpp then finds it by name (--probe <name>, and --list to see them
+	all), so adding a probe never means editing a central enum or switch.
+	Probes made at run time (see probeScript.h) call RegisterProbe().
+
+	C probes just give the function that runs them. Assembly probes give
+	the AssemblyProbeData that builds them (see assemblyProbe.h) plus what
+	the common driver, PerformAssemblyProbe(), needs to know: the sweep
+	over probeCount, how much data buffer to pass in x1, and which counter
+	events to configure. Fields not given are zero (or empty).
+*/
+
+struct AssemblyProbeData;
+
+struct ProbeDefinition{
+	string name;
+
+	//C probes run themselves...
+	void               (*perform)(void);
+	//...assembly probes are built and run by PerformAssemblyProbe().
+	function<AssemblyProbeData&(void)> construct;
+
+	//Assembly only: probeCount runs lo, lo+stride, ... up to hi.
+	int lo, hi, stride;
+	//Assembly only: the bytes of data buffer the probe expects in x1
+	// (zero-filled, page aligned); 0 for none.
+	size_t dataBytes;
+	//Assembly only: counter events to configure for the sweep, by name (see
+	// counterEvents.h), with their column headings (the names if omitted).
+	//Events the loaded catalogue does not know are skipped; none at all
+	// leaves the default configuration.
+	vector<string> events;
+	vector<string> headings;
+};
+
+//A name registered twice is fatal.
+void RegisterProbe(ProbeDefinition const& definition);
 
-    kCurrentAssemblyProbe
+//Construct one of these (statically) to register a probe.
+struct ProbeRegistration{
+	ProbeRegistration(ProbeDefinition const& definition){
+		RegisterProbe(definition);
+	}
 };
+
+//Returns nullptr if no probe has that name.
+ProbeDefinition const* FindProbe(string const& name);
+
+//For --list.
+void PrintProbes(void);
+//=============================================================================
+
+//Assembly probes' loops can be placed at any instruction offset within a
+// 16KiB page (the largest page size we run on), to separate front end
+// effects (fetch blocks, cache lines, page crossings) from the back end.
+static uint const kCodePlacementBytes=16*1024;
+
 struct ProbeParameters{
-	ProbeType probeType;
+	ProbeDefinition const* probe;
 	void* 	  dataBuffer;
 	uint      probeCount;
+	//Assembly only: where the loop starts, in bytes past a kCodePlacementBytes
+	// boundary; -1 for straight after the register clearing.
+	int       codeOffset;
+	//Assembly only: the exec view's address less the write view's, for
+	// code that places itself by where it will run (see assemblyBuffer.h).
+	ptrdiff_t execOffset=0;
 	
-	ProbeParameters(ProbeType probeType, void* dataBuffer, uint probeCount=0):
-		probeType(probeType), dataBuffer(dataBuffer), probeCount(probeCount){};
+	ProbeParameters(ProbeDefinition const* probe, void* dataBuffer, uint probeCount=0,
+	  int codeOffset=-1):
+		probe(probe), dataBuffer(dataBuffer), probeCount(probeCount),
+		codeOffset(codeOffset){};
 };
 
 struct CProbeData{
 };
 //=============================================================================
 
-void PerformCProbe(ProbeParameters& pp);
-//.............................................................................
-
 void PerformStreamProbe();
 void PerformBandwidthProbe();
 void PerformLatencyProbe(ProbeType probeType);
+//The latency-stride probe's node sizes (strides), and where in each node
+// the next pointer sits; see --stride in main.cpp.
+static size_t const kMaxLatencyStrideBytes=512*1024+64;
+void SetLatencyStrides(vector<size_t> const& strides, size_t pointerOffset);
+//The seed for the latency probes' random chains, and a directory to keep
+// them in (see chainImage.h); --chain-seed and --chain-images in main.cpp.
+void SetLatencyChainSeed(uint64_t seed);
+void SetLatencyChainImages(string const& directory);
+//What backs the latency probes' chains ("default", "base", "thp", "2m",
+// "1g"; see chainArena.h); --latency-pages in main.cpp. False if unknown.
+bool SetLatencyPages(string const& name);
 void PerformCacheProbe();
-
-//=============================================================================
-
-inline void PerformCProbe(ProbeParameters& pp){
-	switch(pp.probeType){
-	case kStream_Probe:
-		PerformStreamProbe();
-		return;
-
-	case kMemoryBandwidth_Probe:
-		PerformBandwidthProbe();
-		return;
-
-	case kLatency8B_Probe:
-	case kL1CacheStructure_Probe:
-	case kLatencyTLB_Probe:
-	case kLatencyStride_Probe:
-	case kLatencyAll_Probe:
-		PerformLatencyProbe(pp.probeType);
-		return;
-
-	case kL1CacheLineLength_Probe:
-		PerformCacheProbe();
-		return;
-
-	default:
-		exit(1);
-	}
-}
+void PerformHarnessProbe();
+void PerformInstructionTableProbe();
 
 //=============================================================================
 
@@ -0,0 +1,436 @@
+//
+//  aarch64Assembler.cpp
+//  AArch64-Explore
+//
+//  Assembly of single instructions from text, through aarch64Encoder.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+#include <initializer_list>
+
+#include "aarch64Assembler.h"
+
+using namespace A64;
+
+//=============================================================================
+#pragma mark Operands
+
+struct Operand{
+	enum Kind{kX, kW, kD, kQ, kV, kImmediate, kMemory, kShift, kTarget};
+	Kind    kind;
+	uint    n=0;			//register number
+	bool    fSP=false;		//kX written as sp
+	string  arrangement;	//kV: "16b", "4s", "2d", ...
+	int64_t value=0;		//kImmediate; kShift, the amount; kTarget, in bytes
+	Mem     memory=mem(xzr);
+	bool    fBare=false;	//kMemory written as just [xn]
+};
+
+static string Trim(string const& s){
+	auto first=s.find_first_not_of(" \t");
+	if(first==string::npos){return "";}
+	auto last=s.find_last_not_of(" \t");
+	return s.substr(first, last-first+1);
+}
+
+//Decimal or 0x hex, optionally negative, optionally after a '#'.
+static bool ParseNumber(string s, int64_t& value){
+	s=Trim(s);
+	if( !s.empty() && s[0]=='#' ){s=Trim( s.substr(1) );}
+	auto fNegative=( !s.empty() && s[0]=='-' );
+	if(fNegative){s=s.substr(1);}
+	if( s.empty() || !isdigit(s[0]) ){return false;}
+	char* end;
+	auto magnitude=strtoull(s.c_str(), &end, 0);
+	if(*end!='\0'){return false;}
+	value=fNegative? -int64_t(magnitude): int64_t(magnitude);
+	return true;
+}
+
+static bool ParseRegister(string const& s, Operand& op){
+	if(s=="sp") {op.kind=Operand::kX; op.n=31; op.fSP=true; return true;}
+	if(s=="xzr"){op.kind=Operand::kX; op.n=31; return true;}
+	if(s=="wzr"){op.kind=Operand::kW; op.n=31; return true;}
+	if( s.size()<2 || !isdigit(s[1]) ){return false;}
+
+	char* end;
+	auto n=strtoul(s.c_str()+1, &end, 10);
+	switch(s[0]){
+	case 'x': op.kind=Operand::kX; break;
+	case 'w': op.kind=Operand::kW; break;
+	case 'd': op.kind=Operand::kD; break;
+	case 'q': op.kind=Operand::kQ; break;
+	case 'v':
+		if(*end!='.'){return false;}
+		op.kind=Operand::kV;
+		op.arrangement=end+1;
+		end+=strlen(end);
+		break;
+	default:
+		return false;
+	}
+	//x31 and w31 are spelled xzr/sp and wzr.
+	auto limit=(op.kind==Operand::kX || op.kind==Operand::kW)? 30: 31;
+	op.n=uint(n);
+	return *end=='\0' && n<=limit;
+}
+
+//[xn]  [xn, #imm]  [xn, xm]  [xn, #imm]!
+static bool ParseMemory(string const& s, Operand& op){
+	auto close=s.find(']');
+	if(close==string::npos){return false;}
+	auto inside=s.substr(1, close-1);
+	auto after =Trim( s.substr(close+1) );
+	auto comma =inside.find(',');
+
+	Operand base;
+	if( !ParseRegister(Trim( inside.substr(0, comma) ), base)
+	  || base.kind!=Operand::kX ){return false;}
+	op.kind=Operand::kMemory;
+	op.memory=mem( XReg{uint8_t(base.n)} );
+	op.fBare=(comma==string::npos);
+
+	if(!op.fBare){
+		auto second=Trim( inside.substr(comma+1) );
+		Operand index;
+		int64_t offset;
+		if( ParseNumber(second, offset) ){
+			op.memory=mem(op.memory.base, offset);
+		}else if( ParseRegister(second, index) && index.kind==Operand::kX
+		  && !index.fSP ){
+			op.memory=mem( op.memory.base, XReg{uint8_t(index.n)} );
+		}else{
+			return false;
+		}
+	}
+	if(after=="!"){
+		if(op.fBare || op.memory.mode!=Mem::kOffset){return false;}
+		op.memory=pre(op.memory.base, op.memory.imm);
+		return true;
+	}
+	return after.empty();
+}
+
+static bool ParseOperand(string const& s, Operand& op){
+	if(s.empty()){return false;}
+	if(s[0]=='['){return ParseMemory(s, op);}
+	if(s[0]=='.'){
+		//.+N or .-N, in bytes.
+		if( s.size()<3 || (s[1]!='+' && s[1]!='-') ){return false;}
+		op.kind=Operand::kTarget;
+		if( !ParseNumber(s.substr(2), op.value) ){return false;}
+		if(s[1]=='-'){op.value=-op.value;}
+		return true;
+	}
+	if( s.compare(0, 4, "lsl ")==0 ){
+		op.kind=Operand::kShift;
+		return ParseNumber(s.substr(4), op.value);
+	}
+	if( ParseNumber(s, op.value) ){
+		op.kind=Operand::kImmediate;
+		return true;
+	}
+	return ParseRegister(s, op);
+}
+
+//Splits at the commas not inside [], and folds a post-index ([xn], #imm)
+// into a single memory operand.
+static bool ParseOperands(string const& s, vector<Operand>& ops){
+	auto depth=0;
+	string current;
+	vector<string> pieces;
+	for(auto c:s){
+		if(c=='['){depth++;}
+		if(c==']'){depth--;}
+		if( c==',' && depth==0 ){
+			pieces.push_back( Trim(current) );
+			current.clear();
+		}else{
+			current+=c;
+		}
+	}
+	pieces.push_back( Trim(current) );
+
+	for(auto& piece:pieces){
+		Operand op;
+		if( !ParseOperand(piece, op) ){return false;}
+		ops.push_back(op);
+	}
+
+	auto count=ops.size();
+	if( count>=2 && ops[count-2].kind==Operand::kMemory && ops[count-2].fBare
+	  && ops[count-1].kind==Operand::kImmediate ){
+		ops[count-2].memory=post(ops[count-2].memory.base, ops[count-1].value);
+		ops.pop_back();
+	}
+	return true;
+}
+//=============================================================================
+#pragma mark Assemble
+
+static bool Matches(vector<Operand> const& ops,
+  initializer_list<Operand::Kind> kinds){
+	if( ops.size()!=kinds.size() ){return false;}
+	auto op=ops.begin();
+	for(auto kind:kinds){
+		if( (op++)->kind!=kind ){return false;}
+	}
+	return true;
+}
+
+//All the vector operands have this arrangement.
+static bool Arranged(vector<Operand> const& ops, char const* arrangement){
+	for(auto& op:ops){
+		if( op.kind==Operand::kV && op.arrangement!=arrangement ){return false;}
+	}
+	return true;
+}
+
+static bool ParseCondition(string const& s, Condition& cond){
+	static char const* const kNames[]={
+		"eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc",
+		"hi", "ls", "ge", "lt", "gt", "le", "al"
+	};
+	for(auto c=0; c<15; c++){
+		if(s==kNames[c]){cond=Condition(c); return true;}
+	}
+	if(s=="cs"){cond=kHS; return true;}
+	if(s=="cc"){cond=kLO; return true;}
+	return false;
+}
+
+bool Assemble(string const& text, Instruction& instruction, string& error){
+	string line;
+	for(auto c:Trim(text)){line+=tolower(c);}
+	auto space=line.find_first_of(" \t");
+	auto mnemonic=line.substr(0, space);
+
+	vector<Operand> ops;
+	if( line=="dsb sy" ){
+		instruction=dsb_sy();
+		return true;
+	}
+	if( space!=string::npos && !ParseOperands(line.substr(space+1), ops) ){
+		error="can't parse the operands of "+line;
+		return false;
+	}
+
+	typedef Operand O;
+	auto X=[&](int k){return XReg{uint8_t(ops[k].n)};};
+	auto W=[&](int k){return WReg{uint8_t(ops[k].n)};};
+	auto D=[&](int k){return DReg{uint8_t(ops[k].n)};};
+	auto Q=[&](int k){return QReg{uint8_t(ops[k].n)};};
+	auto V=[&](int k){return VReg{uint8_t(ops[k].n)};};
+	auto Imm=[&](int k){return ops[k].value;};
+	auto M=[&](int k){return ops[k].memory;};
+	auto& i=instruction;
+
+	//#imm, lsl #12 (as the disassembler prints large add/sub immediates) is
+	// just a bigger immediate to the encoder, which picks the shift itself.
+	auto count=ops.size();
+	if( count>=2 && ops[count-1].kind==O::kShift && ops[count-2].kind==O::kImmediate
+	  && ops[count-1].value==12
+	  && (mnemonic=="add" || mnemonic=="sub" || mnemonic=="subs" || mnemonic=="cmp") ){
+		ops[count-2].value<<=12;
+		ops.pop_back();
+	}
+
+	auto fKnown=true;
+	auto fOK=false;
+	if(mnemonic==".word"){
+		if( (fOK=Matches(ops, {O::kImmediate})
+		  && Imm(0)>=0 && Imm(0)<=0xffffffffll) ){i=Instruction(Imm(0));}
+
+	//System.
+	}else if(mnemonic=="nop"){
+		if( (fOK=ops.empty()) ){i=nop();}
+	}else if(mnemonic=="isb"){
+		if( (fOK=ops.empty()) ){i=isb();}
+	}else if(mnemonic=="ret"){
+		if( (fOK=ops.empty()) ){i=ret();}
+		else if( (fOK=Matches(ops, {O::kX})) ){i=ret(X(0));}
+
+	//Loads and stores.
+	}else if(mnemonic=="ldr" || mnemonic=="str"){
+		auto fLoad=(mnemonic=="ldr");
+		if( (fOK=Matches(ops, {O::kX, O::kMemory})) ){
+			i=fLoad? ldr(X(0), M(1)): str(X(0), M(1));
+		}else if( (fOK=Matches(ops, {O::kW, O::kMemory})) ){
+			i=fLoad? ldr(W(0), M(1)): str(W(0), M(1));
+		}else if( (fOK=Matches(ops, {O::kD, O::kMemory})) ){
+			i=fLoad? ldr(D(0), M(1)): str(D(0), M(1));
+		}else if( (fOK=Matches(ops, {O::kQ, O::kMemory})) ){
+			i=fLoad? ldr(Q(0), M(1)): str(Q(0), M(1));
+		}
+	}else if(mnemonic=="ldrb" || mnemonic=="strb"){
+		if( (fOK=Matches(ops, {O::kW, O::kMemory})) ){
+			i=(mnemonic=="ldrb")? ldrb(W(0), M(1)): strb(W(0), M(1));
+		}
+	}else if(mnemonic=="ldur" || mnemonic=="stur"){
+		auto fLoad=(mnemonic=="ldur");
+		fOK=( ops.size()==2 && ops[1].kind==O::kMemory
+		  && ops[1].memory.mode==Mem::kOffset );
+		if( fOK && Matches(ops, {O::kX, O::kMemory}) ){
+			i=fLoad? ldur(X(0), M(1)): stur(X(0), M(1));
+		}else if( fOK && Matches(ops, {O::kQ, O::kMemory}) ){
+			i=fLoad? ldur(Q(0), M(1)): stur(Q(0), M(1));
+		}else{
+			fOK=false;
+		}
+	}else if(mnemonic=="ldp" || mnemonic=="stp"){
+		auto fLoad=(mnemonic=="ldp");
+		fOK=( ops.size()==3 && ops[2].kind==O::kMemory
+		  && ops[2].memory.mode!=Mem::kRegister );
+		if( fOK && Matches(ops, {O::kX, O::kX, O::kMemory}) ){
+			i=fLoad? ldp(X(0), X(1), M(2)): stp(X(0), X(1), M(2));
+		}else if( fOK && Matches(ops, {O::kD, O::kD, O::kMemory}) ){
+			i=fLoad? ldp(D(0), D(1), M(2)): stp(D(0), D(1), M(2));
+		}else if( fOK && Matches(ops, {O::kQ, O::kQ, O::kMemory}) ){
+			i=fLoad? ldp(Q(0), Q(1), M(2)): stp(Q(0), Q(1), M(2));
+		}else{
+			fOK=false;
+		}
+
+	//Integer.
+	}else if(mnemonic=="add"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kImmediate})) ){
+			i=add(X(0), X(1), Imm(2));
+		}else if( (fOK=Matches(ops, {O::kX, O::kX, O::kX})) ){
+			i=add(X(0), X(1), X(2));
+		}else if( (fOK=Matches(ops, {O::kV, O::kV, O::kV})
+		  && Arranged(ops, "4s")) ){
+			i=add4s(V(0), V(1), V(2));
+		}
+	}else if(mnemonic=="sub"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kImmediate})) ){
+			i=sub(X(0), X(1), Imm(2));
+		}else if( (fOK=Matches(ops, {O::kX, O::kX, O::kX})) ){
+			i=sub(X(0), X(1), X(2));
+		}
+	}else if(mnemonic=="subs"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kImmediate})) ){
+			i=subs(X(0), X(1), Imm(2));
+		}else if( (fOK=Matches(ops, {O::kW, O::kW, O::kImmediate})) ){
+			i=subs(W(0), W(1), Imm(2));
+		}else if( (fOK=Matches(ops, {O::kX, O::kX, O::kX})) ){
+			i=subs(X(0), X(1), X(2));
+		}
+	}else if(mnemonic=="cmp"){
+		if( (fOK=Matches(ops, {O::kX, O::kImmediate})) ){
+			i=cmp(X(0), Imm(1));
+		}else if( (fOK=Matches(ops, {O::kX, O::kX})) ){
+			i=cmp(X(0), X(1));
+		}
+	}else if(mnemonic=="madd"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kX, O::kX})) ){
+			i=madd(X(0), X(1), X(2), X(3));
+		}
+	}else if(mnemonic=="mul" || mnemonic=="udiv" || mnemonic=="sdiv"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kX})) ){
+			i=(mnemonic=="mul")?  mul(X(0), X(1), X(2)):
+			  (mnemonic=="udiv")? udiv(X(0), X(1), X(2)):
+			                      sdiv(X(0), X(1), X(2));
+		}
+	}else if(mnemonic=="mov"){
+		if( (fOK=Matches(ops, {O::kX, O::kX})) ){
+			//To or from sp, mov is an alias of add, not orr.
+			i=(ops[0].fSP || ops[1].fSP)? add(X(0), X(1), 0): mov(X(0), X(1));
+		}else if( (fOK=Matches(ops, {O::kX, O::kImmediate})) ){
+			i=mov(X(0), Imm(1));
+		}else if( (fOK=Matches(ops, {O::kV, O::kV}) && Arranged(ops, "16b")) ){
+			i=mov16b(V(0), V(1));
+		}
+	}else if(mnemonic=="movz" || mnemonic=="movk" || mnemonic=="movn"){
+		int64_t shift=0;
+		if( Matches(ops, {O::kX, O::kImmediate, O::kShift}) ){
+			shift=ops[2].value;
+			ops.pop_back();
+		}
+		if( (fOK=Matches(ops, {O::kX, O::kImmediate})) ){
+			i=(mnemonic=="movz")? movz(X(0), Imm(1), uint(shift)):
+			  (mnemonic=="movk")? movk(X(0), Imm(1), uint(shift)):
+			                      movn(X(0), Imm(1), uint(shift));
+		}
+	}else if(mnemonic=="and" || mnemonic=="orr" || mnemonic=="eor"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kImmediate})) ){
+			auto imm=uint64_t(Imm(2));
+			i=(mnemonic=="and")? and_(X(0), X(1), imm):
+			  (mnemonic=="orr")? orr(X(0), X(1), imm):
+			                     eor(X(0), X(1), imm);
+		}else if( (fOK=Matches(ops, {O::kX, O::kX, O::kX})) ){
+			i=(mnemonic=="and")? and_(X(0), X(1), X(2)):
+			  (mnemonic=="orr")? orr(X(0), X(1), X(2)):
+			                     eor(X(0), X(1), X(2));
+		}else if( (fOK=mnemonic=="orr" && Matches(ops, {O::kV, O::kV, O::kV})
+		  && Arranged(ops, "16b")) ){
+			i=orr16b(V(0), V(1), V(2));
+		}
+	}else if(mnemonic=="bfi"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kImmediate, O::kImmediate})) ){
+			i=bfi(X(0), X(1), uint(Imm(2)), uint(Imm(3)));
+		}
+	}else if(mnemonic=="ror"){
+		if( (fOK=Matches(ops, {O::kX, O::kX, O::kImmediate})) ){
+			i=ror(X(0), X(1), uint(Imm(2)));
+		}
+
+	//FP and SIMD.
+	}else if(mnemonic=="fmov"){
+		if( (fOK=Matches(ops, {O::kD, O::kX})) ){i=fmov(D(0), X(1));}
+	}else if(mnemonic=="fadd"){
+		if( (fOK=Matches(ops, {O::kD, O::kD, O::kD})) ){
+			i=fadd(D(0), D(1), D(2));
+		}else if( (fOK=Matches(ops, {O::kV, O::kV, O::kV})
+		  && Arranged(ops, "2d")) ){
+			i=fadd2d(V(0), V(1), V(2));
+		}
+	}else if(mnemonic=="fmul"){
+		if( (fOK=Matches(ops, {O::kD, O::kD, O::kD})) ){i=fmul(D(0), D(1), D(2));}
+	}else if(mnemonic=="fmadd"){
+		if( (fOK=Matches(ops, {O::kD, O::kD, O::kD, O::kD})) ){
+			i=fmadd(D(0), D(1), D(2), D(3));
+		}
+	}else if(mnemonic=="fmla"){
+		if( (fOK=Matches(ops, {O::kV, O::kV, O::kV}) && Arranged(ops, "2d")) ){
+			i=fmla2d(V(0), V(1), V(2));
+		}
+
+	//Branches, to byte offsets from the branch.
+	}else if(mnemonic=="b" || mnemonic.compare(0, 2, "b.")==0
+	  || mnemonic=="cbz" || mnemonic=="cbnz"){
+		auto target=ops.empty()? nullptr: &ops.back();
+		if( !target || target->kind!=O::kTarget || target->value%4!=0 ){
+			fOK=false;
+		}else if(mnemonic=="b"){
+			if( (fOK=ops.size()==1) ){i=b(target->value/4);}
+		}else if(mnemonic=="cbz" || mnemonic=="cbnz"){
+			if( (fOK=Matches(ops, {O::kX, O::kTarget})) ){
+				i=(mnemonic=="cbz")? cbz(X(0), target->value/4):
+				                     cbnz(X(0), target->value/4);
+			}
+		}else{
+			Condition cond;
+			if( !ParseCondition(mnemonic.substr(2), cond) ){
+				fKnown=false;
+			}else if( (fOK=ops.size()==1) ){
+				i=b_cond(cond, target->value/4);
+			}
+		}
+	}else{
+		fKnown=false;
+	}
+
+	if(!fKnown){
+		error="unknown instruction "+mnemonic;
+		return false;
+	}
+	if(!fOK){
+		error="wrong operands for "+line;
+		return false;
+	}
+	return true;
+}
+//=============================================================================
@@ -0,0 +1,43 @@
+//
+//  aarch64Assembler.h
+//  AArch64-Explore
+//
+//  Assembly of single instructions from text, through aarch64Encoder.h.
+//
+
+#ifndef aarch64Assembler_h
+#define aarch64Assembler_h
+
+#include <string>
+#include "aarch64Encoder.h"
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	Parses one instruction, in the syntax llvm-mc and aarch64Disassembler.h
+	use, and encodes it with aarch64Encoder.h, so it accepts exactly the
+	instruction classes the encoder has (plus the usual aliases: mov, cmp,
+	mul, ...). Anything else can be given as .word 0x........ .
+	For example
+		ldr x2, [x2]        str q0, [x1, #16]     ldp x28, x27, [sp, #-16]
+		ldr x20, [x1], #1   add x3, x1, #32768    movk x4, #0x1234, lsl #16
+		and x1, x1, #0xfffffffffffdffff           fmla v0.2d, v1.2d, v2.2d
+		b.ne .-8            cbz x2, .+12          .word 0xd503201f
+	Branch targets are byte offsets from the branch itself, as the
+	disassembler prints them when it does not know the address.
+
+	Syntax errors (an unknown mnemonic, the wrong kind of operand) are
+	returned. Immediates out of range are caught by the encoder, which
+	exits, naming g_encodingContext if it is set.
+
+	Used by probeScript.cpp to build probes from text at run time.
+*/
+//=============================================================================
+
+//Returns false, with a description in error, if text is not an instruction
+// we know how to assemble.
+bool Assemble(string const& text, Instruction& instruction, string& error);
+//=============================================================================
+
+#endif /* aarch64Assembler_h */
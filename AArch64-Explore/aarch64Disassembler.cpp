@@ -0,0 +1,541 @@
+//
+//  aarch64Disassembler.cpp
+//  AArch64-Explore
+//
+//  Disassembly of generated probes, for auditing what was actually built.
+//
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <iostream>
+#include <iomanip>
+
+#include "aarch64Disassembler.h"
+
+//=============================================================================
+#pragma mark Helpers
+
+static string Format(char const* format, ...){
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	return buffer;
+}
+
+static inline uint Bits(Instruction i, uint hi, uint lo){
+	return (i>>lo)&((1u<<(hi-lo+1))-1);
+}
+
+static inline int64_t SignedBits(Instruction i, uint hi, uint lo){
+	auto width=hi-lo+1;
+	auto value=int64_t(Bits(i, hi, lo));
+	return (value&(int64_t(1)<<(width-1)))? value-(int64_t(1)<<width): value;
+}
+
+//Register 31 is sp in some operand positions and the zero register in others.
+static string GPR(uint n, bool f64, bool fSP=false){
+	if(n==31){
+		if(fSP){return f64? "sp": "wsp";}
+		return f64? "xzr": "wzr";
+	}
+	return Format("%c%u", f64? 'x': 'w', n);
+}
+
+static string Word(Instruction i){
+	return Format(".word 0x%08x", i);
+}
+
+//A branch target: relative, or absolute if we know where we are.
+static string Target(int64_t offsetInstructions, int64_t at){
+	auto bytes=offsetInstructions*4;
+	if(at>=0){return Format("0x%llx", (long long)(at+bytes));}
+	return Format(".%c%lld", bytes<0? '-': '+', (long long)(bytes<0? -bytes: bytes));
+}
+
+static char const* const kConditionNames[16]={
+	"eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc",
+	"hi", "ls", "ge", "lt", "gt", "le", "al", "nv"
+};
+
+//The architecture's DecodeBitMasks(), for the logical immediates.
+static uint64_t DecodeBitmask(uint n, uint immr, uint imms, bool f64){
+	auto combined=(n<<6)|(~imms&0x3f);
+	uint length=0;
+	for(auto bit=6; bit>=0; bit--){
+		if( combined&(1u<<bit) ){length=bit; break;}
+	}
+	auto size =1u<<length;
+	auto mask =(size==64)? ~uint64_t(0): (uint64_t(1)<<size)-1;
+	auto ones =(imms&(size-1))+1;
+	auto run  =(ones==64)? ~uint64_t(0): (uint64_t(1)<<ones)-1;
+	auto r    =immr&(size-1);
+	auto element=(r==0)? run: ((run>>r)|(run<<(size-r)))&mask;
+	uint64_t value=0;
+	for(uint i=0; i<64; i+=size){value|=element<<i;}
+	return f64? value: value&0xffffffff;
+}
+//=============================================================================
+#pragma mark Loads and stores
+
+//The register an ordinary load/store transfers, from size, V and opc.
+//Returns "" for encodings we do not handle (prefetch, ...).
+static string TransferRegister(uint size, bool fVector, uint opc, uint rt,
+  string& suffix, int& scale){
+	suffix="";
+	if(fVector){
+		static char const kNames[]="bhsd";
+		if( size==0 && opc>=2 ){scale=16; return Format("q%u", rt);}
+		if(opc>=2){return "";}
+		scale=1<<size;
+		return Format("%c%u", kNames[size], rt);
+	}
+	scale=1<<size;
+	if(opc<=1){
+		if(size==0){suffix="b";}
+		if(size==1){suffix="h";}
+		return GPR(rt, size==3);
+	}
+	//The sign extending loads.
+	if(size==3){return "";}
+	static char const* const kSigned[3]={"sb", "sh", "sw"};
+	if( size==2 && opc==3 ){return "";}
+	suffix=kSigned[size];
+	return GPR(rt, opc==2);
+}
+
+static string LoadStore(Instruction i){
+	auto size=Bits(i, 31, 30), fVector=Bits(i, 26, 26), opc=Bits(i, 23, 22);
+	auto rn  =Bits(i, 9, 5), rt=Bits(i, 4, 0);
+	string suffix; int scale;
+	auto reg=TransferRegister(size, fVector, opc, rt, suffix, scale);
+	if( reg.empty() ){return Word(i);}
+	auto fLoad=fVector? (opc&1): (opc!=0);
+	auto name =string(fLoad? "ldr": "str");
+	auto base =GPR(rn, true, true);
+
+	if( Bits(i, 24, 24) ){	//unsigned scaled offset
+		auto offset=int64_t(Bits(i, 21, 10))*scale;
+		if(offset==0){return Format("%s%s %s, [%s]", name.c_str(),
+		  suffix.c_str(), reg.c_str(), base.c_str());}
+		return Format("%s%s %s, [%s, #%lld]", name.c_str(), suffix.c_str(),
+		  reg.c_str(), base.c_str(), (long long)offset);
+	}
+	if( Bits(i, 21, 21) ){	//register offset
+		if( Bits(i, 11, 10)!=0b10 ){return Word(i);}
+		auto option=Bits(i, 15, 13), fShift=Bits(i, 12, 12);
+		auto rm    =Bits(i, 20, 16);
+		string amount=fShift? Format(" #%d", __builtin_ctz(scale)): "";
+		string index, extend;
+		switch(option){
+		case 0b011: index=GPR(rm, true);  extend=fShift? ", lsl"+amount: ""; break;
+		case 0b111: index=GPR(rm, true);  extend=", sxtx"+amount; break;
+		case 0b010: index=GPR(rm, false); extend=", uxtw"+amount; break;
+		case 0b110: index=GPR(rm, false); extend=", sxtw"+amount; break;
+		default: return Word(i);
+		}
+		return Format("%s%s %s, [%s, %s%s]", name.c_str(), suffix.c_str(),
+		  reg.c_str(), base.c_str(), index.c_str(), extend.c_str());
+	}
+	auto imm9=SignedBits(i, 20, 12);
+	switch( Bits(i, 11, 10) ){
+	case 0b00:
+		name=fLoad? "ldur": "stur";
+		if(imm9==0){return Format("%s%s %s, [%s]", name.c_str(),
+		  suffix.c_str(), reg.c_str(), base.c_str());}
+		return Format("%s%s %s, [%s, #%lld]", name.c_str(), suffix.c_str(),
+		  reg.c_str(), base.c_str(), (long long)imm9);
+	case 0b01:
+		return Format("%s%s %s, [%s], #%lld", name.c_str(), suffix.c_str(),
+		  reg.c_str(), base.c_str(), (long long)imm9);
+	case 0b11:
+		return Format("%s%s %s, [%s, #%lld]!", name.c_str(), suffix.c_str(),
+		  reg.c_str(), base.c_str(), (long long)imm9);
+	}
+	return Word(i);
+}
+//.............................................................................
+
+static string LoadStorePair(Instruction i){
+	auto opc=Bits(i, 31, 30), fVector=Bits(i, 26, 26), mode=Bits(i, 24, 23);
+	auto fLoad=Bits(i, 22, 22);
+	auto rt2=Bits(i, 14, 10), rn=Bits(i, 9, 5), rt=Bits(i, 4, 0);
+	string a, b; int scale;
+	if(fVector){
+		if(opc==3){return Word(i);}
+		static char const kNames[]="sdq";
+		scale=4<<opc;
+		a=Format("%c%u", kNames[opc], rt);
+		b=Format("%c%u", kNames[opc], rt2);
+	}else{
+		if(opc!=0 && opc!=2){return Word(i);}
+		scale=(opc==2)? 8: 4;
+		a=GPR(rt, opc==2);
+		b=GPR(rt2, opc==2);
+	}
+	auto offset=SignedBits(i, 21, 15)*scale;
+	auto name  =string( (mode==0)? (fLoad? "ldnp": "stnp"): (fLoad? "ldp": "stp") );
+	auto base  =GPR(rn, true, true);
+	switch(mode){
+	case 0b00:
+	case 0b10:
+		if(offset==0){return Format("%s %s, %s, [%s]", name.c_str(),
+		  a.c_str(), b.c_str(), base.c_str());}
+		return Format("%s %s, %s, [%s, #%lld]", name.c_str(), a.c_str(),
+		  b.c_str(), base.c_str(), (long long)offset);
+	case 0b01:
+		return Format("%s %s, %s, [%s], #%lld", name.c_str(), a.c_str(),
+		  b.c_str(), base.c_str(), (long long)offset);
+	case 0b11:
+		return Format("%s %s, %s, [%s, #%lld]!", name.c_str(), a.c_str(),
+		  b.c_str(), base.c_str(), (long long)offset);
+	}
+	return Word(i);
+}
+//=============================================================================
+#pragma mark Integer
+
+static string AddSubImmediate(Instruction i){
+	auto f64=Bits(i, 31, 31), fSub=Bits(i, 30, 30), fFlags=Bits(i, 29, 29);
+	auto shift=Bits(i, 22, 22), imm=Bits(i, 21, 10);
+	auto rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	auto n=GPR(rn, f64, true);
+	string immediate=shift? Format("#%u, lsl #12", imm): Format("#%u", imm);
+	if( fFlags && rd==31 ){
+		return Format("%s %s, %s", fSub? "cmp": "cmn", n.c_str(), immediate.c_str());
+	}
+	if( !fFlags && !fSub && imm==0 && !shift && (rd==31 || rn==31) ){
+		return Format("mov %s, %s", GPR(rd, f64, true).c_str(), n.c_str());
+	}
+	auto name=fSub? (fFlags? "subs": "sub"): (fFlags? "adds": "add");
+	return Format("%s %s, %s, %s", name, GPR(rd, f64, !fFlags).c_str(),
+	  n.c_str(), immediate.c_str());
+}
+
+static char const* const kShiftNames[4]={"lsl", "lsr", "asr", "ror"};
+
+static string ShiftSuffix(Instruction i){
+	auto amount=Bits(i, 15, 10);
+	if(amount==0){return "";}
+	return Format(", %s #%u", kShiftNames[Bits(i, 23, 22)], amount);
+}
+
+static string AddSubRegister(Instruction i){
+	auto f64=Bits(i, 31, 31), fSub=Bits(i, 30, 30), fFlags=Bits(i, 29, 29);
+	auto rm=Bits(i, 20, 16), rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	if( Bits(i, 23, 22)==3 ){return Word(i);}
+	auto m=GPR(rm, f64)+ShiftSuffix(i);
+	if( fFlags && rd==31 ){
+		return Format("%s %s, %s", fSub? "cmp": "cmn", GPR(rn, f64).c_str(), m.c_str());
+	}
+	if( fSub && rn==31 ){
+		return Format("%s %s, %s", fFlags? "negs": "neg", GPR(rd, f64).c_str(), m.c_str());
+	}
+	auto name=fSub? (fFlags? "subs": "sub"): (fFlags? "adds": "add");
+	return Format("%s %s, %s, %s", name, GPR(rd, f64).c_str(),
+	  GPR(rn, f64).c_str(), m.c_str());
+}
+//.............................................................................
+
+static string LogicalImmediate(Instruction i){
+	auto f64=Bits(i, 31, 31), opc=Bits(i, 30, 29), n=Bits(i, 22, 22);
+	auto rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	if( !f64 && n ){return Word(i);}
+	auto value=DecodeBitmask(n, Bits(i, 21, 16), Bits(i, 15, 10), f64);
+	if( opc==3 && rd==31 ){
+		return Format("tst %s, #0x%llx", GPR(rn, f64).c_str(), (unsigned long long)value);
+	}
+	static char const* const kNames[4]={"and", "orr", "eor", "ands"};
+	return Format("%s %s, %s, #0x%llx", kNames[opc], GPR(rd, f64, opc!=3).c_str(),
+	  GPR(rn, f64).c_str(), (unsigned long long)value);
+}
+
+static string LogicalRegister(Instruction i){
+	auto f64=Bits(i, 31, 31), opc=Bits(i, 30, 29), fInvert=Bits(i, 21, 21);
+	auto rm=Bits(i, 20, 16), rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	auto m=GPR(rm, f64)+ShiftSuffix(i);
+	if( opc==1 && rn==31 && Bits(i, 15, 10)==0 ){
+		return Format("%s %s, %s", fInvert? "mvn": "mov", GPR(rd, f64).c_str(), m.c_str());
+	}
+	if( opc==3 && !fInvert && rd==31 ){
+		return Format("tst %s, %s", GPR(rn, f64).c_str(), m.c_str());
+	}
+	static char const* const kNames[2][4]={
+		{"and", "orr", "eor", "ands"}, {"bic", "orn", "eon", "bics"}};
+	return Format("%s %s, %s, %s", kNames[fInvert][opc], GPR(rd, f64).c_str(),
+	  GPR(rn, f64).c_str(), m.c_str());
+}
+//.............................................................................
+
+static string MoveWide(Instruction i){
+	auto f64=Bits(i, 31, 31), opc=Bits(i, 30, 29), hw=Bits(i, 22, 21);
+	auto imm16=(unsigned long long)Bits(i, 20, 5);
+	auto rd   =Bits(i, 4, 0);
+	if( opc==1 || (!f64 && hw>=2) ){return Word(i);}
+	auto d=GPR(rd, f64);
+	if(opc==3){
+		if(hw==0){return Format("movk %s, #0x%llx", d.c_str(), imm16);}
+		return Format("movk %s, #0x%llx, lsl #%u", d.c_str(), imm16, hw*16);
+	}
+	//movz/movn print as the value they make (as mov), except for the
+	// ambiguous zero cases, which keep their names.
+	auto value=imm16<<(hw*16);
+	if(opc==0){value=~value;}
+	if(!f64){value&=0xffffffff;}
+	if( imm16==0 && hw!=0 ){
+		return Format("%s %s, #0, lsl #%u", opc==0? "movn": "movz", d.c_str(), hw*16);
+	}
+	if( f64? int64_t(value)<0: int32_t(value)<0 ){
+		return Format("mov %s, #%lld", d.c_str(),
+		  f64? (long long)int64_t(value): (long long)int32_t(value));
+	}
+	return Format("mov %s, #%llu", d.c_str(), (unsigned long long)value);
+}
+//.............................................................................
+
+static string Bitfield(Instruction i){
+	auto f64=Bits(i, 31, 31), opc=Bits(i, 30, 29), n=Bits(i, 22, 22);
+	auto immr=Bits(i, 21, 16), imms=Bits(i, 15, 10);
+	auto rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	if( opc==3 || n!=f64 ){return Word(i);}
+	uint size=f64? 64: 32;
+	auto d=GPR(rd, f64), s=GPR(rn, f64);
+	auto Alias=[&](char const* name, uint a, uint b){
+		return Format("%s %s, %s, #%u, #%u", name, d.c_str(), s.c_str(), a, b);
+	};
+	switch(opc){
+	case 0:	//sbfm
+		if(imms==size-1){return Format("asr %s, %s, #%u", d.c_str(), s.c_str(), immr);}
+		if(imms<immr){return Alias("sbfiz", size-immr, imms+1);}
+		return Alias("sbfx", immr, imms-immr+1);
+	case 1:	//bfm
+		if(imms<immr){return Alias("bfi", size-immr, imms+1);}
+		return Alias("bfxil", immr, imms-immr+1);
+	case 2:	//ubfm
+		if( imms!=size-1 && imms+1==immr ){
+			return Format("lsl %s, %s, #%u", d.c_str(), s.c_str(), size-1-imms);
+		}
+		if(imms==size-1){return Format("lsr %s, %s, #%u", d.c_str(), s.c_str(), immr);}
+		if(imms<immr){return Alias("ubfiz", size-immr, imms+1);}
+		return Alias("ubfx", immr, imms-immr+1);
+	}
+	return Word(i);
+}
+
+static string Extract(Instruction i){
+	auto f64=Bits(i, 31, 31), rm=Bits(i, 20, 16), imms=Bits(i, 15, 10);
+	auto rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	if(rn==rm){
+		return Format("ror %s, %s, #%u", GPR(rd, f64).c_str(), GPR(rn, f64).c_str(), imms);
+	}
+	return Format("extr %s, %s, %s, #%u", GPR(rd, f64).c_str(),
+	  GPR(rn, f64).c_str(), GPR(rm, f64).c_str(), imms);
+}
+//.............................................................................
+
+static string DataProcessing2(Instruction i){
+	auto f64=Bits(i, 31, 31), rm=Bits(i, 20, 16), rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	char const* name;
+	switch( Bits(i, 15, 10) ){
+	case 0b000010: name="udiv"; break;
+	case 0b000011: name="sdiv"; break;
+	case 0b001000: name="lsl";  break;
+	case 0b001001: name="lsr";  break;
+	case 0b001010: name="asr";  break;
+	case 0b001011: name="ror";  break;
+	default: return Word(i);
+	}
+	return Format("%s %s, %s, %s", name, GPR(rd, f64).c_str(),
+	  GPR(rn, f64).c_str(), GPR(rm, f64).c_str());
+}
+
+static string DataProcessing3(Instruction i){
+	auto f64=Bits(i, 31, 31), rm=Bits(i, 20, 16), ra=Bits(i, 14, 10);
+	auto rn=Bits(i, 9, 5), rd=Bits(i, 4, 0), fSub=Bits(i, 15, 15);
+	if( Bits(i, 23, 21)!=0 ){return Word(i);}
+	auto d=GPR(rd, f64), n=GPR(rn, f64), m=GPR(rm, f64);
+	if(ra==31){
+		return Format("%s %s, %s, %s", fSub? "mneg": "mul", d.c_str(), n.c_str(), m.c_str());
+	}
+	return Format("%s %s, %s, %s, %s", fSub? "msub": "madd", d.c_str(),
+	  n.c_str(), m.c_str(), GPR(ra, f64).c_str());
+}
+//=============================================================================
+#pragma mark FP and SIMD
+
+//s or d from the FP type field; 0 if it is neither.
+static char FPRegisterKind(uint type){
+	return (type==0)? 's': (type==1)? 'd': 0;
+}
+
+static string FPMoveGeneral(Instruction i){
+	auto f64=Bits(i, 31, 31), type=Bits(i, 23, 22), opcode=Bits(i, 18, 16);
+	auto rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	auto kind=FPRegisterKind(type);
+	if( kind==0 || f64!=(type==1) || Bits(i, 20, 19)!=0 ){return Word(i);}
+	if(opcode==0b111){
+		return Format("fmov %c%u, %s", kind, rd, GPR(rn, f64).c_str());
+	}
+	if(opcode==0b110){
+		return Format("fmov %s, %c%u", GPR(rd, f64).c_str(), kind, rn);
+	}
+	return Word(i);
+}
+
+static string FP2Source(Instruction i){
+	auto kind=FPRegisterKind( Bits(i, 23, 22) );
+	auto rm=Bits(i, 20, 16), rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	static char const* const kNames[6]={"fmul", "fdiv", "fadd", "fsub", "fmax", "fmin"};
+	auto opcode=Bits(i, 15, 12);
+	if( kind==0 || opcode>=6 ){return Word(i);}
+	return Format("%s %c%u, %c%u, %c%u", kNames[opcode], kind, rd, kind, rn, kind, rm);
+}
+
+static string FP3Source(Instruction i){
+	auto kind=FPRegisterKind( Bits(i, 23, 22) );
+	auto rm=Bits(i, 20, 16), ra=Bits(i, 14, 10), rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	static char const* const kNames[4]={"fmadd", "fmsub", "fnmadd", "fnmsub"};
+	if(kind==0){return Word(i);}
+	auto name=kNames[ (Bits(i, 21, 21)<<1)|Bits(i, 15, 15) ];
+	return Format("%s %c%u, %c%u, %c%u, %c%u", name, kind, rd, kind, rn,
+	  kind, rm, kind, ra);
+}
+
+static string SIMDThreeSame(Instruction i){
+	auto q=Bits(i, 30, 30), u=Bits(i, 29, 29), size=Bits(i, 23, 22);
+	auto rm=Bits(i, 20, 16), rn=Bits(i, 9, 5), rd=Bits(i, 4, 0);
+	auto Op=[&](char const* name, char const* arrangement){
+		return Format("%s v%u.%s, v%u.%s, v%u.%s", name, rd, arrangement,
+		  rn, arrangement, rm, arrangement);
+	};
+	static char const* const kIntegerArrangements[2][4]={
+		{"8b", "4h", "2s", ""}, {"16b", "8h", "4s", "2d"}};
+	auto bytes=q? "16b": "8b";
+	auto fp   =(size&1)? (q? "2d": ""): (q? "4s": "2s");
+	switch( Bits(i, 15, 11) ){
+	case 0b00011:{	//logical
+		if( u==0 && size==2 && rn==rm ){
+			return Format("mov v%u.%s, v%u.%s", rd, bytes, rn, bytes);
+		}
+		static char const* const kNames[2][4]={
+			{"and", "bic", "orr", "orn"}, {"eor", "bsl", "bit", "bif"}};
+		return Op(kNames[u][size], bytes);
+	}
+	case 0b10000:{
+		auto arrangement=kIntegerArrangements[q][size];
+		if(*arrangement==0){break;}
+		return Op(u? "sub": "add", arrangement);
+	}
+	case 0b11010:
+		if( u==0 && *fp ){return Op((size&2)? "fsub": "fadd", fp);}
+		break;
+	case 0b11001:
+		if( u==0 && *fp ){return Op((size&2)? "fmls": "fmla", fp);}
+		break;
+	case 0b11011:
+		if( u==1 && !(size&2) && *fp ){return Op("fmul", fp);}
+		break;
+	}
+	return Word(i);
+}
+//=============================================================================
+#pragma mark Disassemble
+
+string Disassemble(Instruction i, int64_t at){
+	//System and register branches.
+	switch(i){
+	case 0xd503201f: return "nop";
+	case 0xd5033fdf: return "isb";
+	case 0xd5033f9f: return "dsb sy";
+	case 0xd5033bbf: return "dmb ish";
+	}
+	if( (i&0xfffffc1f)==0xd65f0000 ){
+		auto rn=Bits(i, 9, 5);
+		return (rn==30)? "ret": "ret "+GPR(rn, true);
+	}
+	if( (i&0xfffffc1f)==0xd61f0000 ){return "br " +GPR(Bits(i, 9, 5), true);}
+	if( (i&0xfffffc1f)==0xd63f0000 ){return "blr "+GPR(Bits(i, 9, 5), true);}
+
+	//Immediate branches.
+	if( (i&0x7c000000)==0x14000000 ){
+		return Format("%s %s", Bits(i, 31, 31)? "bl": "b",
+		  Target(SignedBits(i, 25, 0), at).c_str());
+	}
+	if( (i&0xff000010)==0x54000000 ){
+		return Format("b.%s %s", kConditionNames[Bits(i, 3, 0)],
+		  Target(SignedBits(i, 23, 5), at).c_str());
+	}
+	if( (i&0x7e000000)==0x34000000 ){
+		return Format("%s %s, %s", Bits(i, 24, 24)? "cbnz": "cbz",
+		  GPR(Bits(i, 4, 0), Bits(i, 31, 31)).c_str(),
+		  Target(SignedBits(i, 23, 5), at).c_str());
+	}
+
+	//Loads and stores.
+	if( (i&0x3a000000)==0x28000000 ){return LoadStorePair(i);}
+	if( (i&0x3b000000)==0x39000000 ){return LoadStore(i);}
+	if( (i&0x3b000000)==0x38000000 ){return LoadStore(i);}
+
+	//Integer.
+	if( (i&0x1f000000)==0x11000000 ){return AddSubImmediate(i);}
+	if( (i&0x1f200000)==0x0b000000 ){return AddSubRegister(i);}
+	if( (i&0x1f800000)==0x12000000 ){return LogicalImmediate(i);}
+	if( (i&0x1f000000)==0x0a000000 ){return LogicalRegister(i);}
+	if( (i&0x1f800000)==0x12800000 ){return MoveWide(i);}
+	if( (i&0x1f800000)==0x13000000 ){return Bitfield(i);}
+	if( (i&0x1fa00000)==0x13800000 ){return Extract(i);}
+	if( (i&0x5fe00000)==0x1ac00000 ){return DataProcessing2(i);}
+	if( (i&0x1f000000)==0x1b000000 ){return DataProcessing3(i);}
+
+	//FP and SIMD.
+	if( (i&0x7f20fc00)==0x1e200000 ){return FPMoveGeneral(i);}
+	if( (i&0xff200c00)==0x1e200800 ){return FP2Source(i);}
+	if( (i&0xff000000)==0x1f000000 ){return FP3Source(i);}
+	if( (i&0x9f200400)==0x0e200400 ){return SIMDThreeSame(i);}
+
+	return Word(i);
+}
+//=============================================================================
+#pragma mark Listing
+
+//Runs of NOPs longer than this are summarized in a dump.
+static uint const kMinElidedNops=16;
+
+void DumpInstructions(Instruction const* ibuf, uint count,
+  vector<ListingSection> const& sections,
+  uint cacheLineBytes, uint fetchBlockBytes){
+	cout<<"'=' starts a "<<cacheLineBytes<<"B cache line, '-' a "
+	    <<fetchBlockBytes<<"B fetch block (by address, not offset)"<<endl;
+
+	auto section=sections.begin();
+	for(uint o=0; o<count; o++){
+		auto fSectionStart=(o==0);
+		while( section!=sections.end() && section->start<=o ){
+			if(section->start==o){
+				cout<<section->name<<":"<<endl;
+				fSectionStart=true;
+			}
+			section++;
+		}
+		//Long runs of NOPs (padding, or the body of a NOP probe) are
+		// summarized, keeping their first and last lines, up to the next
+		// section.
+		auto sectionEnd=(section!=sections.end())? section->start: count;
+		auto run=0u;
+		while( o+run<sectionEnd && ibuf[o+run]==A64::nop() ){run++;}
+		if( run>kMinElidedNops && !fSectionStart && ibuf[o-1]==A64::nop() ){
+			cout<<"          ... "<<run-1<<" more nops"<<endl;
+			o+=run-2;
+			continue;
+		}
+		auto address=reinterpret_cast<uintptr_t>(ibuf+o);
+		auto marker=(address%cacheLineBytes==0)? '=':
+		  (address%fetchBlockBytes==0)? '-': ' ';
+		auto offset=o*sizeof(Instruction);
+		cout<<marker<<" "<<hex<<setfill('0')
+		    <<setw(6)<<offset<<"  "<<setw(8)<<ibuf[o]
+		    <<dec<<setfill(' ')<<"  "<<Disassemble(ibuf[o], offset)<<endl;
+	}
+}
+//=============================================================================
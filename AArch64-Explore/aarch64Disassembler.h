@@ -0,0 +1,58 @@
+//
+//  aarch64Disassembler.h
+//  AArch64-Explore
+//
+//  Disassembly of generated probes, for auditing what was actually built.
+//
+
+#ifndef aarch64Disassembler_h
+#define aarch64Disassembler_h
+
+#include <string>
+#include <vector>
+#include "aarch64Encoder.h"
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	The inverse of aarch64Encoder.h, for the same instruction classes (loads
+	and stores of all the forms the probes use, integer and logical
+	arithmetic, moves, bitfields, multiply/divide, the FP and SIMD ops,
+	branches and the system hints), printed in the same syntax llvm-mc and
+	objdump use, including the usual aliases (mov, cmp, mul, bfi, ror, ...).
+	Anything else comes out as .word, which is at least honest.
+
+	DumpInstructions() prints a whole buffer with offsets, marking where
+	sections begin and where cache lines and fetch blocks start, which is
+	what matters when a probe is alignment sensitive. main.cpp's --dump
+	uses it to show a probe exactly as the JIT buffer holds it.
+*/
+//=============================================================================
+
+//Branch targets are printed as instruction offsets relative to the branch
+// (".+8"), or, if at is given, as absolute buffer offsets in bytes.
+string Disassemble(Instruction instruction, int64_t at=-1);
+
+//Where each part of a buffer begins, in instructions.
+struct ListingSection{
+	uint        start;
+	char const* name;
+};
+
+//Cache lines are 128B on Apple cores, 64B on most others; fetch blocks are
+// the aligned group the front end fetches per cycle (8 instructions on M1).
+#if defined(__APPLE__)
+static uint const kListingCacheLineBytes=128;
+#else
+static uint const kListingCacheLineBytes=64;
+#endif
+static uint const kListingFetchBlockBytes=32;
+
+void DumpInstructions(Instruction const* ibuf, uint count,
+  vector<ListingSection> const& sections,
+  uint cacheLineBytes=kListingCacheLineBytes,
+  uint fetchBlockBytes=kListingFetchBlockBytes);
+//=============================================================================
+
+#endif /* aarch64Disassembler_h */
@@ -0,0 +1,507 @@
+//
+//  aarch64Encoder.h
+//  AArch64-Explore
+//
+//  Typed, constexpr encoders for the AArch64 instructions the probes use.
+//
+
+#ifndef aarch64Encoder_h
+#define aarch64Encoder_h
+
+#include <cstdint>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+using namespace std;
+
+typedef uint32_t Instruction;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	The assembly probes used to be written as raw words,
+		ibuf[o++] = 0xf9400042; // ldr x2, [x2]
+	with the mnemonic in a comment that nothing checked. Now they are written
+		ibuf[o++] = ldr(x2, mem(x2));
+	Each function here returns one encoded Instruction, so the ibuf[o++] idiom
+	is unchanged, and everything is constexpr and inline so that a builder
+	sweeping thousands of variants compiles down to the same stores of
+	constants (plus a few ORs) as the hex did.
+
+	Operands are typed: XReg, WReg (general, 64 and 32 bit), DReg, QReg
+	(FP/SIMD scalar), VReg (SIMD vector, arrangement given by the function
+	name, as in mov16b()). Register 31 is xzr or sp depending on the
+	instruction, exactly as in the architecture; both names are provided.
+	Memory operands are built with
+		mem(xn)  mem(xn, #imm)  mem(xn, xm)   [xn], [xn, #imm], [xn, xm]
+		pre(xn, #imm)                         [xn, #imm]!
+		post(xn, #imm)                        [xn], #imm
+	and, like an assembler, ldr/str pick the scaled unsigned offset form
+	when they can and the unscaled (ldur/stur) form otherwise.
+
+	Every field is range checked. Out of range in a constant expression is a
+	compile error; at run time it prints what was wrong and exits, which
+	beats silently executing some other instruction.
+
+	Branches take a Label (see the end of the file), which may be bound
+	before (loops) or after (forward branches) the branch is emitted.
+
+	This is not a complete assembler: add instructions here as probes need
+	them, and add a spot check to the static_asserts at the bottom (llvm-mc
+	-triple=aarch64 -show-encoding will tell you the expected word).
+*/
+//=============================================================================
+
+namespace A64{
+
+//When encoding from text (see aarch64Assembler.h), where the text came from,
+// so that an encoding error can say.
+inline char const* g_encodingContext=nullptr;
+
+//Not constexpr, so reaching it in a constant expression is a compile error.
+[[noreturn]] inline void EncodingError(char const* what, int64_t value){
+	printf("AArch64 encoding error: %s (%lld)\n", what, (long long)value);
+	if(g_encodingContext){printf("  in %s\n", g_encodingContext);}
+	exit(1);
+}
+
+constexpr void Check(bool fOK, char const* what, int64_t value){
+	if(!fOK){EncodingError(what, value);}
+}
+
+//Returns value as an unsigned field of width bits, checking it fits.
+constexpr uint32_t Field(int64_t value, uint bits, char const* what){
+	Check(value>=0 && value<(int64_t(1)<<bits), what, value);
+	return uint32_t(value);
+}
+
+//Returns value as a two's complement field of width bits, checking it fits.
+constexpr uint32_t SignedField(int64_t value, uint bits, char const* what){
+	auto limit=int64_t(1)<<(bits-1);
+	Check(value>=-limit && value<limit, what, value);
+	return uint32_t(value)&((uint32_t(1)<<bits)-1);
+}
+
+//Returns value/scale, checking that it divides exactly.
+constexpr int64_t Scaled(int64_t value, int scale, char const* what){
+	Check(value%scale==0, what, value);
+	return value/scale;
+}
+//=============================================================================
+#pragma mark Registers
+
+struct XReg{uint8_t n;};
+struct WReg{uint8_t n;};
+struct DReg{uint8_t n;};
+struct QReg{uint8_t n;};
+struct VReg{uint8_t n;};
+
+inline constexpr XReg
+	x0{0}, x1{1}, x2{2}, x3{3}, x4{4}, x5{5}, x6{6}, x7{7},
+	x8{8}, x9{9}, x10{10}, x11{11}, x12{12}, x13{13}, x14{14}, x15{15},
+	x16{16}, x17{17}, x18{18}, x19{19}, x20{20}, x21{21}, x22{22}, x23{23},
+	x24{24}, x25{25}, x26{26}, x27{27}, x28{28}, x29{29}, x30{30};
+inline constexpr WReg
+	w0{0}, w1{1}, w2{2}, w3{3}, w4{4}, w5{5}, w6{6}, w7{7},
+	w8{8}, w9{9}, w10{10}, w11{11}, w12{12}, w13{13}, w14{14}, w15{15},
+	w16{16}, w17{17}, w18{18}, w19{19}, w20{20}, w21{21}, w22{22}, w23{23},
+	w24{24}, w25{25}, w26{26}, w27{27}, w28{28}, w29{29}, w30{30};
+inline constexpr DReg
+	d0{0}, d1{1}, d2{2}, d3{3}, d4{4}, d5{5}, d6{6}, d7{7},
+	d8{8}, d9{9}, d10{10}, d11{11}, d12{12}, d13{13}, d14{14}, d15{15},
+	d16{16}, d17{17}, d18{18}, d19{19}, d20{20}, d21{21}, d22{22}, d23{23},
+	d24{24}, d25{25}, d26{26}, d27{27}, d28{28}, d29{29}, d30{30}, d31{31};
+inline constexpr QReg
+	q0{0}, q1{1}, q2{2}, q3{3}, q4{4}, q5{5}, q6{6}, q7{7},
+	q8{8}, q9{9}, q10{10}, q11{11}, q12{12}, q13{13}, q14{14}, q15{15},
+	q16{16}, q17{17}, q18{18}, q19{19}, q20{20}, q21{21}, q22{22}, q23{23},
+	q24{24}, q25{25}, q26{26}, q27{27}, q28{28}, q29{29}, q30{30}, q31{31};
+inline constexpr VReg
+	v0{0}, v1{1}, v2{2}, v3{3}, v4{4}, v5{5}, v6{6}, v7{7},
+	v8{8}, v9{9}, v10{10}, v11{11}, v12{12}, v13{13}, v14{14}, v15{15},
+	v16{16}, v17{17}, v18{18}, v19{19}, v20{20}, v21{21}, v22{22}, v23{23},
+	v24{24}, v25{25}, v26{26}, v27{27}, v28{28}, v29{29}, v30{30}, v31{31};
+inline constexpr XReg xzr{31}, sp{31};
+inline constexpr WReg wzr{31};
+
+//For registers chosen in a loop.
+constexpr XReg xreg(int n){return XReg{uint8_t(Field(n, 5, "register"))};}
+constexpr WReg wreg(int n){return WReg{uint8_t(Field(n, 5, "register"))};}
+constexpr DReg dreg(int n){return DReg{uint8_t(Field(n, 5, "register"))};}
+constexpr QReg qreg(int n){return QReg{uint8_t(Field(n, 5, "register"))};}
+constexpr VReg vreg(int n){return VReg{uint8_t(Field(n, 5, "register"))};}
+//=============================================================================
+#pragma mark Memory operands
+
+struct Mem{
+	enum Mode{kOffset, kPreIndex, kPostIndex, kRegister};
+	XReg    base;
+	int64_t imm;
+	XReg    index;
+	Mode    mode;
+};
+
+constexpr Mem mem(XReg base, int64_t imm=0){return Mem{base, imm, xzr, Mem::kOffset};}
+constexpr Mem mem(XReg base, XReg index)   {return Mem{base, 0, index, Mem::kRegister};}
+constexpr Mem pre(XReg base, int64_t imm)  {return Mem{base, imm, xzr, Mem::kPreIndex};}
+constexpr Mem post(XReg base, int64_t imm) {return Mem{base, imm, xzr, Mem::kPostIndex};}
+//=============================================================================
+#pragma mark Loads and stores
+
+//The single register load/store class. size and opc are the architectural
+// fields; scale is the access size in bytes (which for Q is not 1<<size).
+//fUnscaled forces ldur/stur even when the scaled form would fit.
+constexpr Instruction LoadStore(uint size, bool fVector, uint opc, int scale,
+  uint rt, Mem const& m, bool fUnscaled=false){
+	Instruction base=(size<<30)|(0b111<<27)|(uint(fVector)<<26)|(opc<<22)
+	  |(uint(m.base.n)<<5)|rt;
+	switch(m.mode){
+	case Mem::kOffset:
+		if( !fUnscaled && m.imm>=0 && m.imm%scale==0
+		  && m.imm/scale<(1<<12) ){
+			return base|(0b01<<24)|(uint32_t(m.imm/scale)<<10);
+		}
+		return base|(SignedField(m.imm, 9, "unscaled offset")<<12);
+	case Mem::kPreIndex:
+		return base|(SignedField(m.imm, 9, "pre-index offset")<<12)|(0b11<<10);
+	case Mem::kPostIndex:
+		return base|(SignedField(m.imm, 9, "post-index offset")<<12)|(0b01<<10);
+	case Mem::kRegister:
+		//option=011 (LSL), S=0: [xn, xm] with no scaling.
+		return base|(1<<21)|(uint(m.index.n)<<16)|(0b011<<13)|(0b10<<10);
+	}
+	return 0;
+}
+
+constexpr Instruction ldr(XReg rt, Mem const& m){return LoadStore(3, false, 1, 8, rt.n, m);}
+constexpr Instruction str(XReg rt, Mem const& m){return LoadStore(3, false, 0, 8, rt.n, m);}
+constexpr Instruction ldr(WReg rt, Mem const& m){return LoadStore(2, false, 1, 4, rt.n, m);}
+constexpr Instruction str(WReg rt, Mem const& m){return LoadStore(2, false, 0, 4, rt.n, m);}
+constexpr Instruction ldrb(WReg rt, Mem const& m){return LoadStore(0, false, 1, 1, rt.n, m);}
+constexpr Instruction strb(WReg rt, Mem const& m){return LoadStore(0, false, 0, 1, rt.n, m);}
+constexpr Instruction ldr(DReg rt, Mem const& m){return LoadStore(3, true, 1, 8, rt.n, m);}
+constexpr Instruction str(DReg rt, Mem const& m){return LoadStore(3, true, 0, 8, rt.n, m);}
+constexpr Instruction ldr(QReg rt, Mem const& m){return LoadStore(0, true, 3, 16, rt.n, m);}
+constexpr Instruction str(QReg rt, Mem const& m){return LoadStore(0, true, 2, 16, rt.n, m);}
+
+constexpr Instruction ldur(XReg rt, Mem const& m){return LoadStore(3, false, 1, 8, rt.n, m, true);}
+constexpr Instruction stur(XReg rt, Mem const& m){return LoadStore(3, false, 0, 8, rt.n, m, true);}
+constexpr Instruction ldur(QReg rt, Mem const& m){return LoadStore(0, true, 3, 16, rt.n, m, true);}
+constexpr Instruction stur(QReg rt, Mem const& m){return LoadStore(0, true, 2, 16, rt.n, m, true);}
+//.............................................................................
+
+//Load/store pair. opc and fVector pick the register kind; scale as above.
+//There is no register offset form.
+constexpr Instruction LoadStorePair(uint opc, bool fVector, bool fLoad,
+  int scale, uint rt, uint rt2, Mem const& m){
+	uint mode=0;
+	switch(m.mode){
+	case Mem::kPostIndex: mode=0b01; break;
+	case Mem::kOffset:    mode=0b10; break;
+	case Mem::kPreIndex:  mode=0b11; break;
+	case Mem::kRegister:  Check(false, "ldp/stp have no register offset", 0);
+	}
+	auto imm7=SignedField(Scaled(m.imm, scale, "pair offset alignment"), 7,
+	  "pair offset");
+	return (opc<<30)|(0b101<<27)|(uint(fVector)<<26)|(mode<<23)
+	  |(uint(fLoad)<<22)|(imm7<<15)|(rt2<<10)|(uint(m.base.n)<<5)|rt;
+}
+
+constexpr Instruction ldp(XReg a, XReg b, Mem const& m){return LoadStorePair(2, false, true,  8, a.n, b.n, m);}
+constexpr Instruction stp(XReg a, XReg b, Mem const& m){return LoadStorePair(2, false, false, 8, a.n, b.n, m);}
+constexpr Instruction ldp(DReg a, DReg b, Mem const& m){return LoadStorePair(1, true,  true,  8, a.n, b.n, m);}
+constexpr Instruction stp(DReg a, DReg b, Mem const& m){return LoadStorePair(1, true,  false, 8, a.n, b.n, m);}
+constexpr Instruction ldp(QReg a, QReg b, Mem const& m){return LoadStorePair(2, true,  true, 16, a.n, b.n, m);}
+constexpr Instruction stp(QReg a, QReg b, Mem const& m){return LoadStorePair(2, true,  false,16, a.n, b.n, m);}
+//=============================================================================
+#pragma mark Integer arithmetic
+
+//add/sub (immediate). Negative immediates flip add<->sub, and multiples
+// of 4096 use the shifted form, as an assembler would.
+constexpr Instruction AddSubImm(bool f64, bool fSub, bool fSetFlags,
+  uint rd, uint rn, int64_t imm){
+	if(imm<0){fSub=!fSub; imm=-imm;}
+	uint shift=0;
+	if( imm>=(1<<12) && imm%(1<<12)==0 ){shift=1; imm>>=12;}
+	return (uint(f64)<<31)|(uint(fSub)<<30)|(uint(fSetFlags)<<29)
+	  |(0b100010<<23)|(shift<<22)|(Field(imm, 12, "add/sub immediate")<<10)
+	  |(rn<<5)|rd;
+}
+//add/sub (shifted register), with no shift.
+constexpr Instruction AddSubReg(bool f64, bool fSub, bool fSetFlags,
+  uint rd, uint rn, uint rm){
+	return (uint(f64)<<31)|(uint(fSub)<<30)|(uint(fSetFlags)<<29)
+	  |(0b01011<<24)|(rm<<16)|(rn<<5)|rd;
+}
+
+//Register 31 is sp for the immediate forms and xzr for the register forms.
+constexpr Instruction add(XReg d, XReg n, int64_t imm){return AddSubImm(true, false, false, d.n, n.n, imm);}
+constexpr Instruction sub(XReg d, XReg n, int64_t imm){return AddSubImm(true, true,  false, d.n, n.n, imm);}
+constexpr Instruction subs(XReg d, XReg n, int64_t imm){return AddSubImm(true, true, true, d.n, n.n, imm);}
+constexpr Instruction subs(WReg d, WReg n, int64_t imm){return AddSubImm(false, true, true, d.n, n.n, imm);}
+constexpr Instruction add(XReg d, XReg n, XReg m){return AddSubReg(true, false, false, d.n, n.n, m.n);}
+constexpr Instruction sub(XReg d, XReg n, XReg m){return AddSubReg(true, true,  false, d.n, n.n, m.n);}
+constexpr Instruction subs(XReg d, XReg n, XReg m){return AddSubReg(true, true, true, d.n, n.n, m.n);}
+constexpr Instruction cmp(XReg n, XReg m)   {return subs(xzr, n, m);}
+constexpr Instruction cmp(XReg n, int64_t imm){return subs(xzr, n, imm);}
+
+//Multiply and divide.
+constexpr Instruction madd(XReg d, XReg n, XReg m, XReg a){
+	return 0x9b000000|(uint(m.n)<<16)|(uint(a.n)<<10)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction mul(XReg d, XReg n, XReg m){return madd(d, n, m, xzr);}
+constexpr Instruction udiv(XReg d, XReg n, XReg m){
+	return 0x9ac00800|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction sdiv(XReg d, XReg n, XReg m){
+	return 0x9ac00c00|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+//.............................................................................
+
+//Moves. mov(reg, reg) is orr with xzr, so it cannot name sp (use add #0).
+constexpr Instruction orr(XReg d, XReg n, XReg m){
+	return 0xaa000000|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction mov(XReg d, XReg m){return orr(d, xzr, m);}
+
+//Move wide; shift is 0, 16, 32 or 48.
+constexpr Instruction MoveWide(uint opc, uint rd, int64_t imm16, uint shift){
+	Check(shift%16==0 && shift<64, "move wide shift", shift);
+	return (1u<<31)|(opc<<29)|(0b100101<<23)|((shift/16)<<21)
+	  |(Field(imm16, 16, "move wide immediate")<<5)|rd;
+}
+constexpr Instruction movz(XReg d, int64_t imm16, uint shift=0){return MoveWide(0b10, d.n, imm16, shift);}
+constexpr Instruction movk(XReg d, int64_t imm16, uint shift=0){return MoveWide(0b11, d.n, imm16, shift);}
+constexpr Instruction movn(XReg d, int64_t imm16, uint shift=0){return MoveWide(0b00, d.n, imm16, shift);}
+
+//mov (immediate): any value a single movz or movn can make. Anything else
+// needs a movz/movk sequence, which the caller should write out.
+constexpr Instruction mov(XReg d, int64_t value){
+	auto u=uint64_t(value);
+	for(uint shift=0; shift<64; shift+=16){
+		if( (u&~(uint64_t(0xffff)<<shift))==0 ){
+			return movz(d, (u>>shift)&0xffff, shift);
+		}
+		if( (~u&~(uint64_t(0xffff)<<shift))==0 ){
+			return movn(d, (~u>>shift)&0xffff, shift);
+		}
+	}
+	Check(false, "mov immediate needs more than one instruction", value);
+	return 0;
+}
+//.............................................................................
+
+//The logical (immediate) bitmask: a rotated run of ones, replicated in
+// elements of 2..64 bits. Returns N:immr:imms as a 13 bit field.
+constexpr uint32_t BitmaskImmediate(uint64_t imm){
+	Check(imm!=0 && imm!=~uint64_t(0), "bitmask immediate", int64_t(imm));
+	//Smallest element size at which the pattern repeats.
+	uint size=64;
+	while(size>2){
+		auto half=size/2;
+		auto mask=(uint64_t(1)<<half)-1;
+		if( (imm&mask)!=((imm>>half)&mask) ){break;}
+		size=half;
+	}
+	auto mask=(size==64)? ~uint64_t(0): (uint64_t(1)<<size)-1;
+	auto element=imm&mask;
+	uint ones=0;
+	for(auto bits=element; bits; bits&=bits-1){ones++;}
+	auto run=(uint64_t(1)<<ones)-1;
+	//element must be run rotated right by immr.
+	for(uint immr=0; immr<size; immr++){
+		auto rotated=(immr==0)? run: ((run>>immr)|(run<<(size-immr)))&mask;
+		if(rotated==element){
+			uint n   =(size==64);
+			uint imms=((~(size-1)<<1)|(ones-1))&0x3f;
+			return (n<<12)|(immr<<6)|imms;
+		}
+	}
+	Check(false, "bitmask immediate", int64_t(imm));
+	return 0;
+}
+constexpr Instruction and_(XReg d, XReg n, uint64_t imm){
+	return 0x92000000|(BitmaskImmediate(imm)<<10)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction orr(XReg d, XReg n, uint64_t imm){
+	return 0xb2000000|(BitmaskImmediate(imm)<<10)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction eor(XReg d, XReg n, uint64_t imm){
+	return 0xd2000000|(BitmaskImmediate(imm)<<10)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction and_(XReg d, XReg n, XReg m){
+	return 0x8a000000|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction eor(XReg d, XReg n, XReg m){
+	return 0xca000000|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+
+//Bitfield insert: width bits of n into d at lsb.
+constexpr Instruction bfi(XReg d, XReg n, uint lsb, uint width){
+	Check(lsb<64 && width>=1 && lsb+width<=64, "bfi field", lsb);
+	auto immr=(64-lsb)%64;
+	return 0xb3400000|(immr<<16)|((width-1)<<10)|(uint(n.n)<<5)|d.n;
+}
+//Rotate right by an immediate, which is extr d, n, n, #shift.
+constexpr Instruction ror(XReg d, XReg n, uint shift){
+	return 0x93c00000|(uint(n.n)<<16)|(Field(shift, 6, "ror shift")<<10)
+	  |(uint(n.n)<<5)|d.n;
+}
+//=============================================================================
+#pragma mark FP and SIMD
+
+constexpr Instruction fmov(DReg d, XReg n){return 0x9e670000|(uint(n.n)<<5)|d.n;}
+constexpr Instruction fadd(DReg d, DReg n, DReg m){
+	return 0x1e602800|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction fmul(DReg d, DReg n, DReg m){
+	return 0x1e600800|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction fmadd(DReg d, DReg n, DReg m, DReg a){
+	return 0x1f400000|(uint(m.n)<<16)|(uint(a.n)<<10)|(uint(n.n)<<5)|d.n;
+}
+
+//Vector forms carry the arrangement in the name (mov.16b v0, v1 is
+// mov16b(v0, v1)).
+constexpr Instruction orr16b(VReg d, VReg n, VReg m){
+	return 0x4ea01c00|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction mov16b(VReg d, VReg n){return orr16b(d, n, n);}
+constexpr Instruction add4s(VReg d, VReg n, VReg m){
+	return 0x4ea08400|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction fadd2d(VReg d, VReg n, VReg m){
+	return 0x4e60d400|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+constexpr Instruction fmla2d(VReg d, VReg n, VReg m){
+	return 0x4e60cc00|(uint(m.n)<<16)|(uint(n.n)<<5)|d.n;
+}
+//=============================================================================
+#pragma mark System
+
+constexpr Instruction nop(){return 0xd503201f;}
+constexpr Instruction isb(){return 0xd5033fdf;}
+constexpr Instruction dsb_sy(){return 0xd5033f9f;}
+constexpr Instruction ret(XReg n=x30){return 0xd65f0000|(uint(n.n)<<5);}
+//=============================================================================
+#pragma mark Branches and labels
+
+enum Condition{
+	kEQ, kNE, kHS, kLO, kMI, kPL, kVS, kVC,
+	kHI, kLS, kGE, kLT, kGT, kLE, kAL
+};
+
+//Offsets are in instructions, relative to the branch itself.
+constexpr Instruction b_cond(Condition cond, int64_t offset){
+	return 0x54000000|(SignedField(offset, 19, "b.cond offset")<<5)|cond;
+}
+constexpr Instruction b(int64_t offset){
+	return 0x14000000|SignedField(offset, 26, "b offset");
+}
+constexpr Instruction cbz(XReg t, int64_t offset){
+	return 0xb4000000|(SignedField(offset, 19, "cbz offset")<<5)|t.n;
+}
+constexpr Instruction cbnz(XReg t, int64_t offset){
+	return 0xb5000000|(SignedField(offset, 19, "cbnz offset")<<5)|t.n;
+}
+
+//True for anything that can transfer control (b, bl, b.cond, cbz, tbz, br,
+// ret, svc, ...): the branch/exception/system group less the system
+// instructions proper (hints such as nop, barriers, msr/mrs).
+constexpr bool IsBranch(Instruction i){
+	return (i&0x1c000000)==0x14000000 && (i&0xffc00000)!=0xd5000000;
+}
+//.............................................................................
+
+/*
+	A Label is a position in the instruction buffer. Branch to it with the
+	index the branch will occupy; if the label is not yet bound the branch
+	is emitted with a zero offset and patched when bind() is called:
+		Label done;
+		ibuf[o++] = cbz(x2, done, o);		//the RHS sees o before the ++
+		...
+		bind(done, ibuf, o);
+	A backward branch (the common loop case) just binds first.
+*/
+struct Label{
+	int          position=-1;
+	vector<uint> fixups;	//branches waiting for position
+};
+
+//Re-encodes the offset field of the branch at ibuf[at].
+inline void PatchBranch(Instruction* ibuf, uint at, int64_t offset){
+	auto& i=ibuf[at];
+	if( (i&0x7c000000)==0x14000000 ){	//b, bl: imm26
+		i=(i&~0x03ffffffu)|SignedField(offset, 26, "branch offset");
+	}else{								//b.cond, cbz, cbnz: imm19
+		i=(i&~(0x7ffffu<<5))|(SignedField(offset, 19, "branch offset")<<5);
+	}
+}
+
+inline void bind(Label& label, Instruction* ibuf, uint o){
+	label.position=o;
+	for(auto at:label.fixups){
+		PatchBranch(ibuf, at, int64_t(o)-at);
+	}
+	label.fixups.clear();
+}
+
+//The offset to label from position at (zero, and noted, if not yet bound).
+inline int64_t LabelOffset(Label& label, uint at){
+	if(label.position<0){
+		label.fixups.push_back(at);
+		return 0;
+	}
+	return int64_t(label.position)-at;
+}
+
+inline Instruction b_cond(Condition cond, Label& l, uint at){return b_cond(cond, LabelOffset(l, at));}
+inline Instruction b(Label& l, uint at){return b(LabelOffset(l, at));}
+inline Instruction cbz(XReg t, Label& l, uint at){return cbz(t, LabelOffset(l, at));}
+inline Instruction cbnz(XReg t, Label& l, uint at){return cbnz(t, LabelOffset(l, at));}
+//=============================================================================
+#pragma mark Spot checks
+
+//Against the hand encoded words the probes in main.cpp used to be written
+// in (and llvm-mc for the rest).
+static_assert( ldr(x2, mem(x2))              ==0xf9400042 );
+static_assert( str(x1, mem(x2))              ==0xf9000041 );
+static_assert( ldur(x1, mem(x2, -8))         ==0xf85f8041 );
+static_assert( ldr(x1, mem(x2, -8))          ==0xf85f8041 );
+static_assert( ldur(x2, mem(x3, -1))         ==0xf85ff062 );
+static_assert( ldr(x2, mem(x1, 16384))       ==0xf9600022 );
+static_assert( ldr(x2, mem(x1, x4))          ==0xf8646822 );
+static_assert( ldr(x20, post(x1, 1))         ==0xf8401434 );
+static_assert( ldrb(w15, mem(x5, x4))        ==0x386468af );
+static_assert( str(q0, mem(x1))              ==0x3d800020 );
+static_assert( ldr(q0, mem(x2))              ==0x3dc00040 );
+static_assert( stp(x29, x30, pre(sp, -128))  ==0xa9b87bfd );
+static_assert( stp(x28, x27, mem(sp, 16))    ==0xa9016ffc );
+static_assert( ldp(x29, x30, post(sp, 128))  ==0xa8c87bfd );
+static_assert( stp(q0, q1, mem(sp, -80))     ==0xad3d87e0 );
+static_assert( ldp(q0, q1, mem(sp, -80))     ==0xad7d87e0 );
+static_assert( add(x3, x1, 64)               ==0x91010023 );
+static_assert( add(x3, x1, 32768)            ==0x91402023 );
+static_assert( sub(x2, x2, 8)                ==0xd1002042 );
+static_assert( subs(w0, w0, 1)               ==0x71000400 );
+static_assert( cmp(x0, x0)                   ==0xeb00001f );
+static_assert( mov(x2, x1)                   ==0xaa0103e2 );
+static_assert( mov(x10, 1)                   ==0xd280002a );
+static_assert( mov(x5, 32928)                ==0xd2901405 );
+static_assert( udiv(x2, x2, x10)             ==0x9aca0842 );
+static_assert( mul(x2, x2, x10)              ==0x9b0a7c42 );
+static_assert( bfi(x4, x20, 13, 3)           ==0xb3730a84 );
+static_assert( ror(x20, x20, 1)              ==0x93d40694 );
+static_assert( and_(x1, x1, 0xfffffffffffdffff)==0x926ef821 );
+static_assert( fmov(d3, xzr)                 ==0x9e6703e3 );
+static_assert( mov16b(v3, v1)                ==0x4ea11c23 );
+static_assert( nop()                         ==0xd503201f );
+static_assert( ret()                         ==0xd65f03c0 );
+static_assert( b_cond(kNE, -2)               ==0x54ffffc1 );
+static_assert( IsBranch(ret()) && IsBranch(b(1)) && IsBranch(cbz(x2, 1)) );
+static_assert( !IsBranch(nop()) && !IsBranch(isb()) && !IsBranch(mov(x2, 1)) );
+
+}	//namespace A64
+//=============================================================================
+
+#endif /* aarch64Encoder_h */
@@ -0,0 +1,175 @@
+//
+//  assemblyBuffer.cpp
+//  AArch64-Explore
+//
+//  Executable buffers for the assembly probes, with W^X and cache upkeep.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <pthread.h>
+#include <libkern/OSCacheControl.h>
+#endif
+
+#include "assemblyBuffer.h"
+
+//Linux: use the memfd dual mapping if we can; false forces mprotect toggling.
+static auto const kUseDualMapping=true;
+//Beyond this many idle buffers, released ones are unmapped.
+static auto const kMaxPooledBuffers=4;
+
+static vector<CodeBuffer> g_freeBuffers;
+//=============================================================================
+#pragma mark Mapping
+
+#if defined(__APPLE__)
+
+static CodeBuffer MapCodeBuffer(size_t bytes){
+	CodeBuffer buffer;
+	auto p=mmap(NULL, bytes,
+	  PROT_READ | PROT_WRITE | PROT_EXEC,
+	  MAP_ANON | MAP_PRIVATE | MAP_JIT,   -1, 0);
+	if(p==MAP_FAILED){
+		printf("You do not have permission to JIT code.\n"
+		  "Ensure that you are running/debugging as root.\n"
+		  "Ensure that you have removed the hardened runtime from XCode Entitlements!\n");
+		return buffer;
+	}
+	buffer.write=buffer.exec=static_cast<Instruction*>(p);
+	buffer.bytes=bytes;
+	return buffer;
+}
+
+static void UnmapCodeBuffer(CodeBuffer& buffer){
+	munmap(buffer.exec, buffer.bytes);
+}
+
+#else
+
+//One anonymous mapping, RW for now; EndCodeWrite() flips it to RX.
+static CodeBuffer MapToggledBuffer(size_t bytes){
+	CodeBuffer buffer;
+	auto p=mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+	  MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if(p==MAP_FAILED){
+		printf("mmap of code buffer failed: %s\n", strerror(errno));
+		return buffer;
+	}
+	buffer.write=buffer.exec=static_cast<Instruction*>(p);
+	buffer.bytes=bytes;
+	return buffer;
+}
+
+//Two views of one memfd. Returns an invalid buffer if any step fails.
+static CodeBuffer MapDualBuffer(size_t bytes){
+	CodeBuffer buffer;
+	auto fd=memfd_create("AArch64-Explore-code", MFD_CLOEXEC);
+	if(fd<0){return buffer;}
+	if( ftruncate(fd, bytes)!=0 ){close(fd); return buffer;}
+
+	auto w=mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	auto x=mmap(NULL, bytes, PROT_READ | PROT_EXEC,  MAP_SHARED, fd, 0);
+	if( w==MAP_FAILED || x==MAP_FAILED ){
+		if(w!=MAP_FAILED){munmap(w, bytes);}
+		if(x!=MAP_FAILED){munmap(x, bytes);}
+		close(fd);
+		return buffer;
+	}
+	buffer.write=static_cast<Instruction*>(w);
+	buffer.exec =static_cast<Instruction*>(x);
+	buffer.bytes=bytes;
+	buffer.fd   =fd;
+	return buffer;
+}
+
+static CodeBuffer MapCodeBuffer(size_t bytes){
+	if(kUseDualMapping){
+		auto buffer=MapDualBuffer(bytes);
+		if( buffer.IsValid() ){return buffer;}
+		static auto warned=false;
+		if(!warned){
+			printf("memfd dual mapping failed (%s), using mprotect instead\n",
+			  strerror(errno));
+			warned=true;
+		}
+	}
+	return MapToggledBuffer(bytes);
+}
+
+static void UnmapCodeBuffer(CodeBuffer& buffer){
+	munmap(buffer.write, buffer.bytes);
+	if(buffer.exec!=buffer.write){munmap(buffer.exec, buffer.bytes);}
+	if(buffer.fd>=0){close(buffer.fd);}
+}
+
+#endif
+//=============================================================================
+#pragma mark Pool
+
+CodeBuffer AcquireCodeBuffer(size_t bytes){
+	//Round up to whole pages, so any pooled buffer of that size fits.
+	auto pageBytes=size_t( sysconf(_SC_PAGESIZE) );
+	bytes=(bytes+pageBytes-1)/pageBytes*pageBytes;
+
+	for(auto i=g_freeBuffers.begin(); i!=g_freeBuffers.end(); i++){
+		if(i->bytes>=bytes){
+			auto buffer=*i;
+			g_freeBuffers.erase(i);
+			return buffer;
+		}
+	}
+	return MapCodeBuffer(bytes);
+}
+
+void ReleaseCodeBuffer(CodeBuffer& buffer){
+	if( buffer.IsValid() ){
+		if(g_freeBuffers.size()<kMaxPooledBuffers){
+			g_freeBuffers.push_back(buffer);
+		}else{
+			UnmapCodeBuffer(buffer);
+		}
+	}
+	buffer=CodeBuffer();
+}
+//=============================================================================
+#pragma mark Writing
+
+void BeginCodeWrite(CodeBuffer const& buffer){
+#if defined(__APPLE__)
+	/* See https://developer.apple.com/documentation/apple-silicon/porting-just-in-time-compilers-to-apple-silicon
+	   for details of these JIT wrapper calls.
+	*/
+	pthread_jit_write_protect_np(false);
+#else
+	if( buffer.fd<0 && mprotect(buffer.write, buffer.bytes, PROT_READ | PROT_WRITE)!=0 ){
+		printf("mprotect(RW) of code buffer failed: %s\n", strerror(errno));
+		exit(1);
+	}
+#endif
+}
+
+void EndCodeWrite(CodeBuffer const& buffer, size_t endByte, size_t firstByte){
+	auto start=reinterpret_cast<char*>(buffer.exec)+firstByte;
+	auto end  =reinterpret_cast<char*>(buffer.exec)+endByte;
+#if defined(__APPLE__)
+	pthread_jit_write_protect_np(true);
+	sys_icache_invalidate(start, end-start);
+#else
+	if( buffer.fd<0 && mprotect(buffer.exec, buffer.bytes, PROT_READ | PROT_EXEC)!=0 ){
+		printf("mprotect(RX) of code buffer failed: %s\n", strerror(errno));
+		exit(1);
+	}
+	//Cleans the D-cache to the point of unification and invalidates the
+	// I-cache over the range. Both views map the same physical pages, so
+	// maintenance by the exec view's addresses covers what was written
+	// through the write view.
+	__builtin___clear_cache(start, end);
+#endif
+}
+//=============================================================================
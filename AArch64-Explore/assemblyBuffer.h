@@ -7,20 +7,66 @@
 
 #ifndef assemblyBuffer_h
 #define assemblyBuffer_h
-#include <sys/mman.h>
+
+#include <cstddef>
+#include "aarch64Encoder.h"
 
 //=============================================================================
 #pragma mark Introduction
 /*
-	Some magic code from Dougall to create a buffer with macOS permission that
-	allow us to build int it assembly functions and then execute them.
- */
-
-inline void* CreateAssemblyBuffer(){
-	return mmap(NULL, 0x400000,
-	  PROT_READ | PROT_WRITE | PROT_EXEC,
-	  MAP_ANON | MAP_PRIVATE | MAP_JIT,   -1, 0);
-}
+	Buffers we can build assembly functions in, and then execute.
+
+	No sane OS lets one page be writable and executable at the same time
+	any more (W^X), so every buffer has a write view and an exec view, and
+	building a probe is bracketed by BeginCodeWrite()/EndCodeWrite():
+	- On macOS (Dougall's original magic) a MAP_JIT mapping, where the two
+	  views are the same address and pthread_jit_write_protect_np() flips
+	  the calling thread between writing and executing.
+	- On Linux, by default, a memfd mapped twice, once RW and once RX, so
+	  nothing ever needs to change protection. If memfd_create() is refused
+	  (old kernels, some sandboxes) we fall back to one mapping that is
+	  mprotect()ed RW to build and RX to run.
+	EndCodeWrite() also does the I/D cache maintenance (sys_icache_invalidate
+	on macOS, __builtin___clear_cache elsewhere) that makes the new code
+	visible to instruction fetch; forget it and on real hardware you
+	execute whatever stale instructions were there before.
+
+	Nothing here is specific to running on real hardware, so the Linux path
+	should work under qemu-aarch64 user mode on an x86 host too, but it has
+	not been tried there. To try it, build with CMakeLists.txt and an
+	aarch64 cross toolchain, then run e.g.
+	  qemu-aarch64 -L /usr/aarch64-linux-gnu ./AArch64-Explore --probe <name>
+	(qemu has no PMU, so the counts will be missing, but the code buffer
+	is built, made executable and run.)
+
+	Buffers are pooled: ReleaseCodeBuffer() hands a buffer back for the next
+	AcquireCodeBuffer() rather than unmapping it, so code that builds a new
+	buffer per sweep point does not pay for 4MiB of mmap()s and page faults
+	every time.
+*/
+//=============================================================================
+
+static size_t const kCodeBufferBytes=0x400000;
+
+struct CodeBuffer{
+	Instruction* write=nullptr;	//where to build
+	Instruction* exec =nullptr;	//where to call (may be the same address)
+	size_t       bytes=0;
+	int          fd   =-1;		//the memfd, for dual mapped buffers
+
+	bool IsValid() const{return write!=nullptr;}
+	size_t Capacity() const{return bytes/sizeof(Instruction);}
+};
+
+//Returns an invalid buffer (and prints why) if we cannot get one.
+CodeBuffer AcquireCodeBuffer(size_t bytes=kCodeBufferBytes);
+void       ReleaseCodeBuffer(CodeBuffer& buffer);
+
+//Bracket every modification of a buffer's contents. EndCodeWrite() makes
+// the buffer executable, and bytes [firstByte, endByte) coherent with the
+// I-cache; pass firstByte when only the end of the code was rewritten.
+void BeginCodeWrite(CodeBuffer const& buffer);
+void EndCodeWrite(CodeBuffer const& buffer, size_t endByte, size_t firstByte=0);
 
 //=============================================================================
 
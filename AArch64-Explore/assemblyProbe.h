@@ -0,0 +1,94 @@
+//
+//  assemblyProbe.h
+//  AArch64-Explore
+//
+//  The interface every assembly probe implements.
+//
+
+#ifndef assemblyProbe_h
+#define assemblyProbe_h
+
+#include "m1cycles.h"
+#include "counterEvents.h"
+#include "aarch64Encoder.h"
+#include "assemblyBuffer.h"
+#include "Probes.h"
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	An assembly probe is a subclass of AssemblyProbeData that writes its body
+	(written with aarch64Encoder.h) and, optionally, prints its results its
+	own way. Everything else (the prologue, the loop around the body, the
+	sweep over probeCount, the counters) is done by PerformAssemblyProbe()
+	in main.cpp, driven by the probe's ProbeDefinition (see Probes.h).
+
+	So a new probe is one subclass plus one registration, in one file:
+		struct MyProbe_APD:AssemblyProbeData{
+			virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+		};
+		static ProbeRegistration gMyProbe({
+			.name="my-probe", .construct=ConstructProbe<MyProbe_APD>,
+			.lo=0, .hi=400, .stride=1});
+	The existing probes are in ProbeAssembly.cpp.
+*/
+//=============================================================================
+
+struct AssemblyProbeData{
+	//The distribution of the outer samples for the probeCount being printed.
+	CounterStatistics stats;
+	//The probe's registered events, as placed on the counters for this sweep
+	// (nullptr if it registered none, and the default configuration is in
+	// use). Only events in passes[0] are counted.
+	CounterSchedule const* schedule=nullptr;
+
+	//Set by BuildAssemblyProbe_Wrapper() at each build: the instructions
+	// in the loop (body and loop-back), and those run once per call outside
+	// it (prologue, register clearing, epilogue; not placement padding).
+	uint loopInstructions=0, callInstructions=0;
+	//Clear this if the body branches, so that the instructions retired per
+	// trip need not be the instructions built.
+	bool fStraightLine=true;
+	//Set by MeasureAssemblyProbe() at each point: the instructions the
+	// retired counter should show per trip around the loop, and whether
+	// (straight line bodies only) it showed something else.
+	double expectedRetireds=0;
+	bool   fRetiredMismatch=false;
+
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)=0;
+	//Optional. If the body for pp.probeCount is the body for fromCount
+	// followed by more instructions (typically more copies of the probe),
+	// emit just those at ibuf (just past the fromCount body) and return how
+	// many; a sweep then extends the code it has rather than rebuilding it.
+	//Any state outside the instruction stream (the data buffer, say) must
+	// be extended to match. Return -1, having written nothing, if this
+	// cannot be done.
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp){
+		return -1;
+	}
+	virtual void print(int probeCount, PerformanceCounters& min, PerformanceCounters& mean, PerformanceCounters& max);
+	virtual ~AssemblyProbeData(){}
+};
+
+//For ProbeDefinition::construct: one instance per probe, made on first use.
+template<typename APD>
+  AssemblyProbeData& ConstructProbe(void){
+	static APD apd;
+	return apd;
+}
+//.............................................................................
+
+//One point of PerformAssemblyProbe()'s sweep, for probes that drive
+// themselves (see ProbeInstructionTable.cpp): builds apd for pp.probeCount
+// in code, runs it until the outer samples converge (leaving them in
+// apd.stats), and returns the minimum, per trip around the loop.
+//Checks the retired instructions against what was built, setting
+// apd.expectedRetireds and apd.fRetiredMismatch; a probe that retired
+// less than its loop-back alone never ran, which is fatal. If the retired
+// counter is not counting (see retired_counter_live()), nothing is
+// checked, and there is a warning, once.
+PerformanceCounters MeasureAssemblyProbe(
+  ProbeParameters& pp, AssemblyProbeData& apd, CodeBuffer& code);
+//=============================================================================
+
+#endif /* assemblyProbe_h */
@@ -0,0 +1,217 @@
+//
+//  chainArena.cpp
+//  AArch64-Explore
+//
+//  One mapping for the latency probes' pointer chains, reused across points.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <fstream>
+
+#include "General.h"
+#include "m1cycles.h"
+#include "corePlacement.h"
+#include "chainArena.h"
+
+//The TLB tests assume nodes start on a 16KiB boundary, whatever the
+// page size we are running on.
+static size_t const kArenaAlignBytes=16_kiB;
+
+#if defined(__linux__)
+//Older headers lack the huge page size flags.
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#endif
+//=============================================================================
+
+static char const* const kPageBackingNames[]={"default", "base", "thp", "2m", "1g"};
+
+char const* PageBackingName(PageBacking pages){
+	return kPageBackingNames[pages];
+}
+
+bool PageBackingFromName(string const& name, PageBacking& pages){
+	for(int i=kDefaultPages; i<=kHugePages1G; i++){
+		if(name==kPageBackingNames[i]){
+			pages=(PageBacking)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PageBackingExists(PageBacking pages){
+#if defined(__linux__)
+	return true;
+#else
+	return pages==kDefaultPages || pages==kBasePages;
+#endif
+}
+//.............................................................................
+
+//The alignment (and so the granule of size) of an arena so backed.
+static size_t ArenaAlignBytes(PageBacking pages){
+	switch(pages){
+		case kTransparentHugePages:
+		case kHugePages2M: return 2_MiB;
+		case kHugePages1G: return 1024_MiB;
+		default:           return kArenaAlignBytes;
+	}
+}
+//=============================================================================
+
+//Touches (writes) the first byte of every page, so that the kernel supplies
+// them all now, split over one thread per equivalent core. Says, the first
+// time, how many threads that was.
+static void PrefaultPages(std::byte* base, size_t bytes){
+	auto const pageBytes=(size_t)sysconf(_SC_PAGESIZE);
+	auto numThreads=run_on_equivalent_cpus(kUsePCore, bytes/pageBytes,
+	  [=](size_t begin, size_t end){
+		auto page=reinterpret_cast<volatile std::byte*>(base);
+		for(auto i=begin; i<end; i++){
+			page[i*pageBytes]=std::byte(0);
+		}
+	});
+	static auto reported=false;
+	if(!reported){
+		printf("Chain arena prefaulted on %zu threads\n", numThreads);
+		reported=true;
+	}
+}
+//.............................................................................
+
+//Maps bytes (a multiple of the huge page size) of explicit huge pages,
+// or returns nullptr if there are not that many reserved.
+static void* MapHugeTLB(size_t bytes, PageBacking pages){
+#if defined(__linux__)
+	auto sizeFlag=pages==kHugePages1G? MAP_HUGE_1GB: MAP_HUGE_2MB;
+	auto p=mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+	  MAP_ANON | MAP_PRIVATE | MAP_HUGETLB | sizeFlag, -1, 0);
+	if(p!=MAP_FAILED){return p;}
+	printf("mmap of %zu bytes of %s huge pages failed: %s\n"
+	  " (reserve more in /sys/kernel/mm/hugepages/hugepages-%zukB/nr_hugepages);"
+	  " using default pages\n",
+	  bytes, PageBackingName(pages), strerror(errno), (size_t)(ArenaAlignBytes(pages)/1_kiB));
+#endif
+	return nullptr;
+}
+
+//Maps bytes of ordinary anonymous memory, aligned to alignBytes, and
+// advises the kernel as to huge pages before anything is touched.
+static void* MapAligned(size_t bytes, size_t alignBytes, PageBacking pages){
+	//Map one unit extra so that the start can be moved up to the
+	// alignment; then give back the ends.
+	auto mapBytes=bytes+alignBytes;
+	auto p=mmap(NULL, mapBytes, PROT_READ | PROT_WRITE,
+	  MAP_ANON | MAP_PRIVATE, -1, 0);
+	if(p==MAP_FAILED){
+		printf("mmap of %zu byte chain arena failed: %s\n",
+		  mapBytes, strerror(errno));
+		exit(1);
+	}
+	auto mapStart=reinterpret_cast<uintptr_t>(p);
+	auto start=(mapStart+alignBytes-1)/alignBytes*alignBytes;
+	if(start>mapStart){munmap(p, start-mapStart);}
+	auto lead=start-mapStart;
+	if(alignBytes>lead){
+		munmap(reinterpret_cast<void*>(start+bytes), alignBytes-lead);
+	}
+	p=reinterpret_cast<void*>(start);
+
+#if defined(__linux__)
+	if(pages==kTransparentHugePages || pages==kBasePages){
+		auto advice=pages==kTransparentHugePages? MADV_HUGEPAGE: MADV_NOHUGEPAGE;
+		if(madvise(p, bytes, advice)!=0){
+			printf("madvise(%s) of chain arena failed: %s\n",
+			  PageBackingName(pages), strerror(errno));
+		}
+	}
+#endif
+	return p;
+}
+//.............................................................................
+
+std::byte* ChainArena::Reserve(size_t bytes, PageBacking pages){
+	if(bytes<=this->bytes && pages==requested){return base;}
+	Release();
+
+	if( !PageBackingExists(pages) ){
+		printf("No %s pages on this OS; using default pages\n", PageBackingName(pages));
+	}
+	auto effective=PageBackingExists(pages)? pages: kDefaultPages;
+
+	void* p=nullptr;
+	if(effective==kHugePages2M || effective==kHugePages1G){
+		auto hugeBytes=ArenaAlignBytes(effective);
+		auto mapBytes=(bytes+hugeBytes-1)/hugeBytes*hugeBytes;
+		p=MapHugeTLB(mapBytes, effective);
+		if(p){
+			bytes=mapBytes;
+		}else{
+			effective=kDefaultPages;
+		}
+	}
+	if(!p){
+		//Round up to whole aligned units.
+		auto alignBytes=ArenaAlignBytes(effective);
+		bytes=(bytes+alignBytes-1)/alignBytes*alignBytes;
+		p=MapAligned(bytes, alignBytes, effective);
+	}
+
+	base=static_cast<std::byte*>(p);
+	this->bytes=bytes;
+	requested=pages;
+	backing=effective;
+	PrefaultPages(base, bytes);
+	return base;
+}
+
+void ChainArena::Release(void){
+	if(base){munmap(base, bytes);}
+	base=nullptr;
+	bytes=0;
+	requested=backing=kDefaultPages;
+}
+
+size_t ChainArena::HugePageBytes(void) const{
+	if(!base){return 0;}
+	if(backing==kHugePages2M || backing==kHugePages1G){return bytes;}
+#if defined(__linux__)
+	//The mapping is listed as "start-end perms ...", followed by its
+	// fields, one of which is AnonHugePages; a mapping can be split (eg
+	// by madvise) or merged, so add up every one overlapping the arena.
+	auto const arenaStart=reinterpret_cast<uintptr_t>(base);
+	auto const arenaEnd  =arenaStart+bytes;
+	std::ifstream smaps("/proc/self/smaps");
+	string line;
+	size_t hugeBytes=0;
+	auto fInArena=false;
+	while( getline(smaps, line) ){
+		unsigned long start, end;
+		if(sscanf(line.c_str(), "%lx-%lx ", &start, &end)==2){
+			fInArena=start<arenaEnd && end>arenaStart;
+			continue;
+		}
+		size_t kiB;
+		if( fInArena && sscanf(line.c_str(), "AnonHugePages: %zu kB", &kiB)==1 ){
+			hugeBytes+=kiB*(size_t)1_kiB;
+		}
+	}
+	return hugeBytes;
+#else
+	return 0;
+#endif
+}
+//=============================================================================
@@ -0,0 +1,86 @@
+//
+//  chainArena.h
+//  AArch64-Explore
+//
+//  One mapping for the latency probes' pointer chains, reused across points.
+//
+
+#ifndef chainArena_h
+#define chainArena_h
+
+#include <cstddef>
+#include <string>
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	A latency test measures the same chain pattern at dozens of depths, up to
+	kMaxDepthBytes (1500MiB). Allocating (and so zeroing, and page faulting)
+	a fresh buffer for each of those points spent more time than the
+	measurements; a full latency-all run took minutes just in the kernel.
+
+	So the chains are built in a ChainArena: one anonymous mapping, made as
+	large as the deepest point of a test needs and then reused, unchanged,
+	for every depth and pattern after it. Only the links are rewritten. It
+	grows (a new mapping) only when a later test needs more than it has, and
+	is never given back until exit.
+
+	Every page of a new mapping is touched before it is used, by one thread
+	per equivalent_cpus() core (see corePlacement.h), so the page faults
+	happen in parallel, and outside the timed region even for the first
+	point.
+
+	What backs the arena is chosen per test (LatencyTests::pages, or
+	--latency-pages for all of them), so that TLB effects can be told from
+	cache effects, and what huge pages buy a pointer chase measured
+	directly, rather than inferred from node sizes around 16KiB:
+	- default: whatever the kernel does for anonymous memory (on Linux,
+	  transparent huge pages or not, as its policy says);
+	- base pages, never huge (MADV_NOHUGEPAGE);
+	- transparent huge pages, asked for with MADV_HUGEPAGE (and the arena
+	  2MiB aligned), but granted only as the kernel can; HugePageBytes()
+	  says how much was;
+	- explicit 2MiB or 1GiB huge pages (MAP_HUGETLB), from the pool
+	  reserved in /sys/kernel/mm/hugepages/.
+	Only default and base pages exist on macOS. A backing that is not
+	available (or, for MAP_HUGETLB, not reserved) falls back to default
+	pages, saying so; backing is what the arena actually got.
+*/
+//=============================================================================
+
+enum PageBacking{
+	kDefaultPages,
+	kBasePages,
+	kTransparentHugePages,
+	kHugePages2M,
+	kHugePages1G
+};
+
+//For --latency-pages: "default", "base", "thp", "2m", "1g".
+char const* PageBackingName(PageBacking pages);
+bool        PageBackingFromName(string const& name, PageBacking& pages);
+//Whether this OS has such pages at all (not whether any are free).
+bool        PageBackingExists(PageBacking pages);
+
+struct ChainArena{
+	std::byte*  base =nullptr;
+	size_t      bytes=0;
+	PageBacking requested=kDefaultPages, backing=kDefaultPages;
+
+	//Returns at least bytes of page aligned, prefaulted memory, at base,
+	// backed as asked (remapping if it is not already). Its contents are
+	// whatever the last user left there. Failure to map at all is fatal.
+	std::byte* Reserve(size_t bytes, PageBacking pages=kDefaultPages);
+	void       Release(void);
+	//How much of the arena is in huge pages (0 if unknown, eg on macOS).
+	size_t     HugePageBytes(void) const;
+
+	ChainArena(){}
+	ChainArena(ChainArena const&)=delete;
+	ChainArena& operator=(ChainArena const&)=delete;
+	~ChainArena(){Release();}
+};
+//=============================================================================
+
+#endif /* chainArena_h */
@@ -0,0 +1,177 @@
+//
+//  chainImage.cpp
+//  AArch64-Explore
+//
+//  Latency probe chains saved to disk, and mapped back in.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chainImage.h"
+
+static char const kChainImageMagic[8]={'A','X','C','H','A','I','N','\0'};
+static uint32_t const kChainImageVersion=1;
+
+struct ChainImageHeader{
+	char          magic[8];
+	uint32_t      version;
+	uint32_t      numHeads;
+	ChainImageKey key;
+	uint64_t      numNodes, builtNodes, depth;
+	//The links in each chain; the offsets follow, chain after chain.
+	uint64_t      headLengths[kMaxChainImageHeads];
+};
+
+//Relocating links, a few ahead.
+static size_t const kRelocatePrefetchDistance=16;
+//Saving, offsets are written this many at a time.
+static size_t const kSaveChunkOffsets=64*1024;
+//=============================================================================
+
+string ChainImagePath(string const& directory, ChainImageKey const& key){
+	char name[256];
+	snprintf(name, sizeof(name),
+	  "chain-p%llu-%lluB+%llu-box%llu-n%llu-seed%llu.chain",
+	  (unsigned long long)key.pattern,
+	  (unsigned long long)key.nodeBytes, (unsigned long long)key.nextOffset,
+	  (unsigned long long)key.boxBytes,  (unsigned long long)key.numNodes,
+	  (unsigned long long)key.seed);
+	return directory+"/"+name;
+}
+//.............................................................................
+
+bool LoadChainImage(string const& path, ChainImageKey const& key,
+  std::byte* arena, size_t arenaBytes, ChainImage& image){
+	auto fd=open(path.c_str(), O_RDONLY);
+	if(fd<0){return false;}
+	struct stat st;
+	if( fstat(fd, &st)!=0 || st.st_size<(off_t)sizeof(ChainImageHeader) ){
+		printf("Chain image %s is truncated; rebuilding it\n", path.c_str());
+		close(fd);
+		return false;
+	}
+	auto fileBytes=(size_t)st.st_size;
+	auto p=mmap(NULL, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(p==MAP_FAILED){
+		printf("mmap of chain image %s failed: %s\n", path.c_str(), strerror(errno));
+		return false;
+	}
+	auto header=static_cast<ChainImageHeader const*>(p);
+	auto offsets=reinterpret_cast<uint64_t const*>(header+1);
+
+	//Check it all before writing anything.
+	auto fValid=memcmp(header->magic, kChainImageMagic, sizeof(kChainImageMagic))==0
+	  && header->version==kChainImageVersion
+	  && memcmp(&header->key, &key, sizeof(key))==0
+	  && header->numHeads>0 && header->numHeads<=kMaxChainImageHeads;
+	uint64_t numOffsets=0;
+	for(uint32_t h=0; fValid && h<header->numHeads; h++){
+		fValid=header->headLengths[h]>0;
+		numOffsets+=header->headLengths[h];
+	}
+	fValid=fValid
+	  && numOffsets<=(fileBytes-sizeof(ChainImageHeader))/sizeof(uint64_t);
+	for(uint64_t i=0; fValid && i<numOffsets; i++){
+		fValid=offsets[i]+sizeof(void*)<=arenaBytes;
+	}
+	if(!fValid){
+		printf("Chain image %s is not for this chain; rebuilding it\n", path.c_str());
+		munmap(p, fileBytes);
+		return false;
+	}
+
+	image.heads.clear();
+	for(uint32_t h=0; h<header->numHeads; h++){
+		auto length=header->headLengths[h];
+		for(uint64_t i=0; i<length; i++){
+			if(i+kRelocatePrefetchDistance<length){
+				__builtin_prefetch(arena+offsets[i+kRelocatePrefetchDistance], 1);
+			}
+			auto next=(i+1<length)? offsets[i+1]: offsets[0];
+			*reinterpret_cast<void**>(arena+offsets[i])=arena+next;
+		}
+		image.heads.push_back(arena+offsets[0]);
+		offsets+=length;
+	}
+	image.numNodes  =header->numNodes;
+	image.builtNodes=header->builtNodes;
+	image.depth     =header->depth;
+	munmap(p, fileBytes);
+	return true;
+}
+//.............................................................................
+
+bool SaveChainImage(string const& path, ChainImageKey const& key,
+  std::byte* arena, size_t arenaBytes, ChainImage const& image){
+	ChainImageHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kChainImageMagic, sizeof(kChainImageMagic));
+	header.version   =kChainImageVersion;
+	header.numHeads  =(uint32_t)image.heads.size();
+	header.key       =key;
+	header.numNodes  =image.numNodes;
+	header.builtNodes=image.builtNodes;
+	header.depth     =image.depth;
+
+	//Write it all under another name, so no reader sees half an image; the
+	// header goes last, once the chain lengths are known.
+	auto tmpPath=path+".tmp";
+	auto file=fopen(tmpPath.c_str(), "wb");
+	auto fWritten=file!=NULL
+	  && fseek(file, sizeof(header), SEEK_SET)==0;
+
+	//A chain that leaves the arena, or never comes back to its head (more
+	// links than the arena could hold), is not saved.
+	auto const maxLinks=arenaBytes/sizeof(void*);
+	auto inArena=[=](void** link){
+		auto offset=reinterpret_cast<std::byte*>(link)-arena;
+		return offset>=0 && offset+sizeof(void*)<=arenaBytes;
+	};
+	auto fCycles=true;
+	vector<uint64_t> offsets;
+	offsets.reserve(kSaveChunkOffsets);
+	for(uint32_t h=0; fWritten && fCycles && h<header.numHeads; h++){
+		auto head=static_cast<void**>(image.heads[h]);
+		auto link=head;
+		uint64_t length=0;
+		do{
+			if( !inArena(link) ){break;}
+			offsets.push_back( reinterpret_cast<std::byte*>(link)-arena );
+			if(offsets.size()==kSaveChunkOffsets){
+				fWritten=fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file)
+				  ==offsets.size();
+				offsets.clear();
+			}
+			link=static_cast<void**>(*link);
+			length++;
+		}while(fWritten && link!=head && length<=maxLinks);
+		fCycles=link==head;
+		header.headLengths[h]=length;
+	}
+	fWritten=fWritten && fCycles
+	  && fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file)==offsets.size()
+	  && fseek(file, 0, SEEK_SET)==0
+	  && fwrite(&header, sizeof(header), 1, file)==1;
+	fWritten=(file==NULL || fclose(file)==0) && fWritten;
+
+	if(!fCycles){
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	if( !fWritten || rename(tmpPath.c_str(), path.c_str())!=0 ){
+		printf("Could not write chain image %s: %s; not saving it\n",
+		  path.c_str(), strerror(errno));
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+//=============================================================================
@@ -0,0 +1,81 @@
+//
+//  chainImage.h
+//  AArch64-Explore
+//
+//  Latency probe chains saved to disk, and mapped back in.
+//
+
+#ifndef chainImage_h
+#define chainImage_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	The latency probes' random chains are deterministic given the seed
+	(--chain-seed), but only for one version of the code that builds them.
+	A chain image pins one down. The access pattern is then byte identical
+	across runs, code changes and machines, and building it is skipped.
+
+	An image is a header saying what the chain was built from (its
+	ChainImageKey: pattern, node layout, box size, node count and seed)
+	followed by each of its chains in traversal order, as the byte offset
+	of every link from the start of the arena. Loading maps the file and
+	writes each link as the arena's address plus the offset of the link
+	after it, wherever the arena now is. So any pattern can be saved, even
+	one whose links are not at a fixed place in each node (the TLB offset
+	patterns). Integers are stored in host order (little endian on
+	everything we run on).
+
+	With --chain-images <dir>, each point of a latency test uses the image
+	for its key in dir if there is one. Otherwise it builds the chain and
+	saves an image. Images are named for their keys, so one directory can
+	hold any number of tests and seeds, and be copied from machine to
+	machine.
+*/
+//=============================================================================
+
+static int const kMaxChainImageHeads=32;
+
+//Everything a chain is built from. An image is used only for exactly the
+// key it was saved with.
+struct ChainImageKey{
+	uint64_t pattern;			//the TraversalPattern
+	uint64_t nodeBytes, nextOffset;
+	uint64_t boxBytes;
+	uint64_t numNodes;			//as asked for
+	uint64_t seed;
+};
+
+//A chain as loaded (or to be saved): its heads (links into the arena),
+// and what the probe reports about it.
+struct ChainImage{
+	vector<void*> heads;
+	uint64_t      numNodes;		//to traverse per pass (can be clamped)
+	uint64_t      builtNodes;	//linked
+	uint64_t      depth;		//in bytes
+};
+
+string ChainImagePath(string const& directory, ChainImageKey const& key);
+
+//Returns false if there is no image at path, or it is not for key, or
+// does not fit in arenaBytes (saying so, in the last two cases).
+//Otherwise fills in image, with its links relocated to arena.
+bool LoadChainImage(string const& path, ChainImageKey const& key,
+  std::byte* arena, size_t arenaBytes, ChainImage& image);
+
+//Walks each of image's chains from its head back round to it and saves
+// them. Returns false, saving nothing, if a chain does not come back
+// round (some patterns, with small nodes, are not cycles), or if the file
+// cannot be written (saying so); images are only a cache, so the chain
+// just built is used either way.
+bool SaveChainImage(string const& path, ChainImageKey const& key,
+  std::byte* arena, size_t arenaBytes, ChainImage const& image);
+//=============================================================================
+
+#endif /* chainImage_h */
@@ -0,0 +1,297 @@
+//
+//  corePlacement.cpp
+//  AArch64-Explore
+//
+//  Keeping the measurement thread on one (big or little) core.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+#include <pthread.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "corePlacement.h"
+
+static int  g_selectedCpu=-1;	//from select_cpu()
+static bool g_fUsePCore  =true;
+
+void select_cpu(int cpu){
+	g_selectedCpu=cpu;
+}
+//=============================================================================
+#pragma mark macOS
+
+#if defined(__APPLE__)
+
+vector<CpuInfo> const& cpu_topology(void){
+	static vector<CpuInfo> const empty;
+	return empty;
+}
+
+void print_cpu_topology(void){
+	printf("CPU topology is not available on macOS; using QoS classes\n");
+}
+
+void place_on_core(bool fUsePCore){
+	if(g_selectedCpu>=0){
+		printf("macOS cannot pin to a specific cpu; ignoring --cpu %d\n",
+		  g_selectedCpu);
+		g_selectedCpu=-1;
+	}
+	g_fUsePCore=fUsePCore;
+	reassert_core_placement();
+}
+
+vector<int> equivalent_cpus(bool fUsePCore){
+	//perflevel0 is the fastest kind of core, perflevel1 the next.
+	int count=0;
+	auto size=sizeof(count);
+	if( sysctlbyname(fUsePCore? "hw.perflevel0.logicalcpu": "hw.perflevel1.logicalcpu",
+	  &count, &size, NULL, 0)!=0 || count<1 ){
+		count=1;
+	}
+	return vector<int>(count, -1);
+}
+
+void place_helper_thread(int cpu){}
+
+//QoS is only a hint, but re-asserting it before each sample is the best
+// we can do to stay on a P (or E) core.
+void reassert_core_placement(void){
+	pthread_set_qos_class_self_np(
+	  g_fUsePCore? QOS_CLASS_USER_INTERACTIVE: QOS_CLASS_BACKGROUND, 0);
+}
+
+bool core_placement_held(void){
+	return true;
+}
+//=============================================================================
+#pragma mark Linux
+
+#elif defined(__linux__)
+
+static int g_placedCpu=-1;		//where we pinned ourselves
+
+//The cpus the process was allowed when it started. Pinning narrows our own
+// affinity to one cpu, so it is read once, before the first pin, and every
+// later choice (another kind of core, the cpus to spread work over) is made
+// from it.
+static cpu_set_t const& AllowedCpus(void){
+	static cpu_set_t allowed;
+	static auto fInitialized=false;
+	if(!fInitialized){
+		CPU_ZERO(&allowed);
+		sched_getaffinity(0, sizeof(allowed), &allowed);
+		fInitialized=true;
+	}
+	return allowed;
+}
+
+//Returns fallback if the file is missing or unreadable.
+static long ReadSysfsLong(string const& path, long fallback){
+	auto file=fopen(path.c_str(), "r");
+	if(file==NULL){return fallback;}
+	long value;
+	if( fscanf(file, "%ld", &value)!=1 ){value=fallback;}
+	fclose(file);
+	return value;
+}
+
+//The lowest cpu in a list like "0-3,8".
+static int ReadSysfsFirstCpu(string const& path){
+	auto file=fopen(path.c_str(), "r");
+	if(file==NULL){return -1;}
+	int value;
+	if( fscanf(file, "%d", &value)!=1 ){value=-1;}
+	fclose(file);
+	return value;
+}
+//.............................................................................
+
+vector<CpuInfo> const& cpu_topology(void){
+	static vector<CpuInfo> topology;
+	static auto fInitialized=false;
+	if(fInitialized){return topology;}
+	fInitialized=true;
+
+	auto numCpus=sysconf(_SC_NPROCESSORS_CONF);
+	for(auto cpu=0; cpu<numCpus; cpu++){
+		auto base="/sys/devices/system/cpu/cpu"+to_string(cpu)+"/";
+		//cpu0 usually has no "online" file; it cannot be taken offline.
+		if( ReadSysfsLong(base+"online", 1)==0 ){continue;}
+
+		CpuInfo info;
+		info.cpu       =cpu;
+		info.capacity  =ReadSysfsLong(base+"cpu_capacity", 0);
+		info.maxFreqKHz=ReadSysfsLong(base+"cpufreq/cpuinfo_max_freq", 0);
+		info.clusterId =ReadSysfsLong(base+"topology/cluster_id", -1);
+		info.packageId =ReadSysfsLong(base+"topology/physical_package_id", 0);
+		info.l2Group   =-1;
+		for(auto index=0; index<8; index++){
+			auto cache=base+"cache/index"+to_string(index)+"/";
+			auto level=ReadSysfsLong(cache+"level", -1);
+			if(level<0){break;}
+			if(level==2){
+				info.l2Group=ReadSysfsFirstCpu(cache+"shared_cpu_list");
+				break;
+			}
+		}
+		topology.push_back(info);
+	}
+	return topology;
+}
+//.............................................................................
+
+void print_cpu_topology(void){
+	cout<<setw(6)<<"cpu"<<setw(10)<<"capacity"<<setw(10)<<"maxMHz"
+	    <<setw(9)<<"cluster"<<setw(9)<<"package"<<setw(9)<<"L2 with"<<endl;
+	for(auto& info:cpu_topology()){
+		cout<<setw(6)<<info.cpu<<setw(10)<<info.capacity
+		    <<setw(10)<<info.maxFreqKHz/1000
+		    <<setw(9)<<info.clusterId<<setw(9)<<info.packageId
+		    <<setw(9)<<info.l2Group<<endl;
+	}
+}
+//.............................................................................
+
+//Biggest (or smallest) core we are allowed to run on, ranking on capacity
+// then max frequency. Among equals, prefer not to be cpu0.
+static int ChooseCpu(bool fUsePCore){
+	auto& allowed=AllowedCpus();
+
+	CpuInfo const* best=nullptr;
+	auto rank=[](CpuInfo const& info){
+		return pair(info.capacity, info.maxFreqKHz);
+	};
+	for(auto& info:cpu_topology()){
+		if( !CPU_ISSET(info.cpu, &allowed) ){continue;}
+		if(best==nullptr){best=&info; continue;}
+		auto r=rank(info), b=rank(*best);
+		auto fBetter=fUsePCore? r>b: r<b;
+		if( fBetter || (r==b && best->cpu==0) ){best=&info;}
+	}
+	return best? best->cpu: -1;
+}
+//.............................................................................
+
+vector<int> equivalent_cpus(bool fUsePCore){
+	if(g_selectedCpu>=0){return {g_selectedCpu};}
+	auto best=ChooseCpu(fUsePCore);
+	if(best<0){return {-1};}
+
+	CpuInfo const* bestInfo=nullptr;
+	for(auto& info:cpu_topology()){
+		if(info.cpu==best){bestInfo=&info;}
+	}
+	auto& allowed=AllowedCpus();
+
+	vector<int> cpus;
+	for(auto& info:cpu_topology()){
+		if( !CPU_ISSET(info.cpu, &allowed) ){continue;}
+		if( info.capacity!=bestInfo->capacity
+		  || info.maxFreqKHz!=bestInfo->maxFreqKHz ){continue;}
+		if(info.cpu!=0){cpus.push_back(info.cpu);}
+	}
+	//cpu0 takes more than its share of interrupts; use it only if there
+	// is nothing else.
+	if( cpus.empty() ){cpus.push_back(best);}
+	return cpus;
+}
+//.............................................................................
+
+static bool PinToCpu(int cpu){
+	AllowedCpus();	//before we narrow it
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set)==0;
+}
+
+void place_on_core(bool fUsePCore){
+	g_fUsePCore=fUsePCore;
+	auto cpu=(g_selectedCpu>=0)? g_selectedCpu: ChooseCpu(fUsePCore);
+	if(cpu<0){
+		printf("No cpu found to pin to; running unpinned\n");
+		return;
+	}
+	if( !PinToCpu(cpu) ){
+		printf("sched_setaffinity(%d) failed; running unpinned\n", cpu);
+		return;
+	}
+
+	//Only report when placement changes; this is called for every
+	// counter (re)configuration.
+	if(cpu!=g_placedCpu){
+		for(auto& info:cpu_topology()){
+			if(info.cpu!=cpu){continue;}
+			printf("Pinned to cpu %d (capacity %d, %ld MHz, cluster %d)\n",
+			  cpu, info.capacity, info.maxFreqKHz/1000, info.clusterId);
+		}
+	}
+	g_placedCpu=cpu;
+}
+
+void place_helper_thread(int cpu){
+	if(cpu>=0){PinToCpu(cpu);}
+}
+
+//Affinity is a hard constraint, so this should never find us elsewhere;
+// but hotplug or cgroup changes can override it, so check, and re-pin.
+void reassert_core_placement(void){
+	if(g_placedCpu<0){return;}
+	if( sched_getcpu()!=g_placedCpu ){
+		static auto warned=false;
+		if(!warned){
+			printf("Found on cpu %d rather than %d; re-pinning\n",
+			  sched_getcpu(), g_placedCpu);
+			warned=true;
+		}
+		PinToCpu(g_placedCpu);
+	}
+}
+
+bool core_placement_held(void){
+	return g_placedCpu<0 || sched_getcpu()==g_placedCpu;
+}
+//=============================================================================
+
+#else
+vector<CpuInfo> const& cpu_topology(void){
+	static vector<CpuInfo> const empty;
+	return empty;
+}
+void print_cpu_topology(void){}
+void place_on_core(bool fUsePCore){g_fUsePCore=fUsePCore;}
+vector<int> equivalent_cpus(bool fUsePCore){return {-1};}
+void place_helper_thread(int cpu){}
+void reassert_core_placement(void){}
+bool core_placement_held(void){return true;}
+#endif
+//.............................................................................
+
+size_t run_on_equivalent_cpus(bool fUsePCore, size_t count,
+  function<void(size_t begin, size_t end)> const& work){
+	auto const cpus=equivalent_cpus(fUsePCore);
+	auto const numThreads=min(cpus.size(), max(count, size_t(1)));
+	vector<thread> threads;
+	for(size_t t=0; t<numThreads; t++){
+		threads.emplace_back([&, t]{
+			place_helper_thread(cpus[t]);
+			work(t*count/numThreads, (t+1)*count/numThreads);
+		});
+	}
+	for(auto& thread:threads){thread.join();}
+	return numThreads;
+}
+//=============================================================================
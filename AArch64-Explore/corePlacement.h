@@ -0,0 +1,86 @@
+//
+//  corePlacement.h
+//  AArch64-Explore
+//
+//  Keeping the measurement thread on one (big or little) core.
+//
+
+#ifndef corePlacement_h
+#define corePlacement_h
+
+#include <vector>
+#include <functional>
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	Measurements only mean something if we know what core they ran on.
+
+	On macOS all we can do is ask, via QoS class: USER_INTERACTIVE gets us a
+	P core (almost always), BACKGROUND an E core. It is only a hint, so we
+	re-assert it before every sample.
+
+	On Linux we can do much better. We read the topology from sysfs
+	(cpu_capacity, which the kernel derives from the DT/ACPI for big.LITTLE,
+	cpufreq max frequency as a fallback, cluster and package ids, and which
+	cpus share an L2), pick a big or little core from among those the
+	affinity mask we started with allows, and pin to it with
+	sched_setaffinity. We avoid cpu0
+	when there is a choice, since it usually takes more than its share of
+	interrupts. Or the user names a cpu explicitly (--cpu in main.cpp).
+	Before and after every sample we verify that we are still where we were
+	put; the averaging loops discard samples where we were not.
+*/
+//=============================================================================
+
+struct CpuInfo{
+	int      cpu;
+	int      capacity;		//1024 for the biggest core; 0 if unknown
+	long     maxFreqKHz;	//0 if unknown
+	int      clusterId;		//-1 if unknown
+	int      packageId;
+	int      l2Group;		//lowest cpu sharing our L2; -1 if unknown
+};
+
+//Empty on macOS.
+vector<CpuInfo> const& cpu_topology(void);
+void print_cpu_topology(void);
+
+//Pin to a specific cpu id; overrides the fUsePCore choice made by
+// place_on_core(). Call before setup_performance_counters().
+void select_cpu(int cpu);
+
+//Move to a big (fUsePCore) or little core, or to the select_cpu() choice.
+//Called from setup_performance_counters().
+void place_on_core(bool fUsePCore);
+
+//Every cpu place_on_core(fUsePCore) could equally have chosen (the allowed
+// cpus of the best rank, leaving out cpu0 if there are others), for
+// spreading independent measurements over them; just the select_cpu()
+// choice if there is one.
+//On macOS, where cpus cannot be named, one -1 per P (or E) core.
+vector<int> equivalent_cpus(bool fUsePCore);
+
+//For helper threads spreading work over equivalent_cpus() (not the
+// measurement thread): pin the calling thread to cpu. Does nothing for -1,
+// or on macOS, where threads inherit our QoS class anyway.
+void place_helper_thread(int cpu);
+
+//Splits 0..count-1 into one contiguous share per equivalent_cpus(fUsePCore)
+// core, and runs work(begin, end) for each share on its own (placed)
+// thread; returns, when they have all finished, how many threads that was.
+// For setup (building data structures), never for anything being measured.
+size_t run_on_equivalent_cpus(bool fUsePCore, size_t count,
+  function<void(size_t begin, size_t end)> const& work);
+
+//Called by the averaging loops before each sample to put us back where
+// place_on_core() put us, should we have been moved.
+void reassert_core_placement(void);
+
+//Called after each sample: are we still on the core we were placed on?
+//(Always true on macOS, where we cannot tell.)
+bool core_placement_held(void);
+//=============================================================================
+
+#endif /* corePlacement_h */
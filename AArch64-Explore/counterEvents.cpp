@@ -0,0 +1,592 @@
+//
+//  counterEvents.cpp
+//  AArch64-Explore
+//
+//  Named counter events, and scheduling a list of them onto the counters.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cfloat>
+#include <cmath>
+#include <cassert>
+#include <numeric>
+#include <bit>
+#include <cctype>
+#include <deque>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+#if defined(__APPLE__)
+#include <CoreFoundation/CoreFoundation.h>
+#endif
+
+#include "General.h"
+#include "counterEvents.h"
+
+//=============================================================================
+#pragma mark Built-in Catalogue
+
+//Used until (unless) LoadCounterEvents() is called.
+#define ANY_COUNTER 0xFF
+#define COUNTER(i)  (1u<<(i))
+
+#if defined(__APPLE__)
+//From /usr/share/kpep/a14.plist (event codes) and experiment (counter
+// restrictions). Only the restrictions we have actually run into are
+// recorded; load the plist for the full story.
+static vector<CounterEvent> const kBuiltinEvents={
+	{"INST_A64",            0x8c, ANY_COUNTER,
+	  "A64 instructions decoded (speculative, before cracking/fusion)"},
+	{"INST_BRANCH",         0x8d, ANY_COUNTER,
+	  "Branch instructions retired"},
+	{"SYNC_DC_LOAD_MISS",   0xbf, ANY_COUNTER,
+	  "Retired loads that missed in L1D"},
+	{"SYNC_DC_STORE_MISS",  0xc0, ANY_COUNTER,
+	  "Retired stores that missed in L1D"},
+	{"SYNC_DTLB_MISS",      0xc1, ANY_COUNTER,
+	  "Retired loads/stores that missed in the DTLB"},
+	{"SYNC_ST_HIT_YNGR_LD", 0xc4, ANY_COUNTER,
+	  "Retired stores that hit a younger, already executed, load"},
+	{"SYNC_BR_ANY_MISP",    0xcb, ANY_COUNTER,
+	  "Retired mispredicted branches"},
+	{"FED_IC_MISS_DEM",     0xd3, ANY_COUNTER,
+	  "Demand instruction fetches that missed in L1I"},
+	{"FED_ITLB_MISS",       0xd4, ANY_COUNTER,
+	  "Instruction fetches that missed in the ITLB"},
+
+	{"MAP_LDST_UOP",        125,  ANY_COUNTER,
+	  "Load/store uops mapped (register file writes)"},
+	{"INST_LDST",           155,  COUNTER(5),
+	  "Load/store instructions retired"},
+	{"L1D_CACHE_MISS_ST",   162,  ANY_COUNTER,
+	  "Stores that missed in L1D"},
+	{"L1D_CACHE_MISS_LD",   163,  ANY_COUNTER,
+	  "Loads that missed in L1D"},
+	{"LD_UNIT_UOP",         166,  ANY_COUNTER,
+	  "Uops executed by the load units"},
+	{"ST_UNIT_UOP",         167,  ANY_COUNTER,
+	  "Uops executed by the store units"},
+	{"L1D_CACHE_WRITEBACK", 168,  ANY_COUNTER,
+	  "Dirty lines written back from L1D"},
+	{"ST_MEMORY_ORDER_VIOLATION_NONSPEC", 196,
+	  COUNTER(3)|COUNTER(4)|COUNTER(5),
+	  "Retired load/store memory order violations"},
+	{"ST_NT_UOP",           229,  ANY_COUNTER,
+	  "Non-temporal store uops"},
+	{"LD_NT_UOP",           230,  ANY_COUNTER,
+	  "Non-temporal load uops"},
+};
+#elif defined(__aarch64__)
+//The ARMv8 PMUv3 common architectural events; every core has these.
+//(Linux exposes only six or so general counters on most cores, but leaves
+// the actual scheduling to the kernel.)
+static vector<CounterEvent> const kBuiltinEvents={
+	{"L1I_CACHE_REFILL",  0x01, ANY_COUNTER, "L1I refills"},
+	{"L1I_TLB_REFILL",    0x02, ANY_COUNTER, "L1 ITLB refills"},
+	{"L1D_CACHE_REFILL",  0x03, ANY_COUNTER, "L1D refills"},
+	{"L1D_CACHE",         0x04, ANY_COUNTER, "L1D accesses"},
+	{"L1D_TLB_REFILL",    0x05, ANY_COUNTER, "L1 DTLB refills"},
+	{"LD_RETIRED",        0x06, ANY_COUNTER, "Loads retired"},
+	{"ST_RETIRED",        0x07, ANY_COUNTER, "Stores retired"},
+	{"BR_MIS_PRED",       0x10, ANY_COUNTER, "Mispredicted branches"},
+	{"BR_PRED",           0x12, ANY_COUNTER, "Predictable branches"},
+	{"MEM_ACCESS",        0x13, ANY_COUNTER, "Data memory accesses"},
+	{"L1D_CACHE_WB",      0x15, ANY_COUNTER, "L1D write-backs"},
+	{"L2D_CACHE",         0x16, ANY_COUNTER, "L2 accesses"},
+	{"L2D_CACHE_REFILL",  0x17, ANY_COUNTER, "L2 refills"},
+	{"INST_SPEC",         0x1b, ANY_COUNTER, "Instructions speculatively executed"},
+	{"STALL_FRONTEND",    0x23, ANY_COUNTER, "Cycles with no uop issued, frontend"},
+	{"STALL_BACKEND",     0x24, ANY_COUNTER, "Cycles with no uop issued, backend"},
+	{"LD_SPEC",           0x70, ANY_COUNTER, "Loads speculatively executed"},
+	{"ST_SPEC",           0x71, ANY_COUNTER, "Stores speculatively executed"},
+};
+#else
+//No raw codes we can guess at; load a pmu-events JSON file.
+static vector<CounterEvent> const kBuiltinEvents={};
+#endif
+
+#undef ANY_COUNTER
+#undef COUNTER
+//=============================================================================
+#pragma mark Catalogue
+
+//A deque so that CounterEvent pointers stay valid as the catalogue grows.
+struct EventCatalogue{
+	deque<CounterEvent>                 events;
+	unordered_map<string, CounterEvent const*> byName;	//names and aliases
+	string                              source;
+
+	void Add(CounterEvent const& event){
+		events.push_back(event);
+		byName[event.name]=&events.back();
+	}
+	void AddAlias(string const& alias, string const& name){
+		auto it=byName.find(name);
+		if( it!=byName.end() && byName.find(alias)==byName.end() ){
+			byName[alias]=it->second;
+		}
+	}
+};
+
+static EventCatalogue& Catalogue(void){
+	static EventCatalogue catalogue;
+	static auto fInitialized=false;
+	if(!fInitialized){
+		for(auto& event:kBuiltinEvents){
+			catalogue.Add(event);
+		}
+		catalogue.source="built-in";
+		fInitialized=true;
+	}
+	return catalogue;
+}
+//.............................................................................
+
+CounterEvent const* FindCounterEvent(string const& name){
+	auto& byName=Catalogue().byName;
+	auto it=byName.find(name);
+	return (it==byName.end())? nullptr: it->second;
+}
+//.............................................................................
+
+void PrintCounterEvents(void){
+	auto& catalogue=Catalogue();
+	vector<CounterEvent const*> sorted;
+	for(auto& event:catalogue.events){sorted.push_back(&event);}
+	std::sort(sorted.begin(), sorted.end(), [](auto a, auto b){
+		return a->name<b->name;
+	});
+
+	cout<<"Counter events ("<<catalogue.source<<")"<<endl;
+	for(auto event:sorted){
+		cout<<left<<setw(36)<<event->name<<right
+		    <<setw(6)<<event->code
+		    <<"  0x"<<hex<<setw(2)<<setfill('0')<<(int)event->counterMask
+		    <<dec<<setfill(' ')
+		    <<"  "<<event->description<<endl;
+	}
+}
+//=============================================================================
+#pragma mark Loading kpep plists
+
+//The kpep databases look like
+// system/cpu/events/<NAME>/{number, counters_mask, description, fixed_counter}
+// system/cpu/aliases/<ALIAS>=<NAME>
+//counters_mask covers all ten counters, the first two of which are fixed.
+#define kNumFixedCounters (COUNTERS_COUNT-VARIABLE_COUNTERS_COUNT)
+
+#if defined(__APPLE__)
+static CFTypeRef DictionaryValue(CFTypeRef dict, char const* key, CFTypeID type){
+	if( dict==NULL || CFGetTypeID(dict)!=CFDictionaryGetTypeID() ){return NULL;}
+	auto cfKey=CFStringCreateWithCString(NULL, key, kCFStringEncodingUTF8);
+	auto value=CFDictionaryGetValue(static_cast<CFDictionaryRef>(dict), cfKey);
+	CFRelease(cfKey);
+	return ( value && CFGetTypeID(value)==type )? value: NULL;
+}
+
+static string StringFromCF(CFTypeRef value){
+	if( value==NULL || CFGetTypeID(value)!=CFStringGetTypeID() ){return "";}
+	char buffer[1024];
+	if( !CFStringGetCString(static_cast<CFStringRef>(value),
+	  buffer, sizeof(buffer), kCFStringEncodingUTF8) ){return "";}
+	return buffer;
+}
+
+static bool IntFromCF(CFTypeRef value, int64_t& result){
+	if( value==NULL || CFGetTypeID(value)!=CFNumberGetTypeID() ){return false;}
+	return CFNumberGetValue(static_cast<CFNumberRef>(value),
+	  kCFNumberSInt64Type, &result);
+}
+
+static bool LoadKpepPlist(vector<char> const& bytes, EventCatalogue& catalogue){
+	auto data=CFDataCreate(NULL,
+	  reinterpret_cast<UInt8 const*>(bytes.data()), bytes.size());
+	auto plist=CFPropertyListCreateWithData(NULL, data,
+	  kCFPropertyListImmutable, NULL, NULL);
+	CFRelease(data);
+	if(plist==NULL){
+		printf("not a property list\n");
+		return false;
+	}
+
+	auto cpu   =DictionaryValue(
+	  DictionaryValue(plist, "system", CFDictionaryGetTypeID()),
+	  "cpu", CFDictionaryGetTypeID());
+	auto events=DictionaryValue(cpu, "events", CFDictionaryGetTypeID());
+	if(events==NULL){
+		printf("no system/cpu/events dictionary\n");
+		CFRelease(plist);
+		return false;
+	}
+
+	auto count=CFDictionaryGetCount(static_cast<CFDictionaryRef>(events));
+	vector<void const*> keys(count), values(count);
+	CFDictionaryGetKeysAndValues(static_cast<CFDictionaryRef>(events),
+	  keys.data(), values.data());
+	for(auto i=0; i<count; i++){
+		int64_t number, mask;
+		if( !IntFromCF(DictionaryValue(values[i], "number",
+		  CFNumberGetTypeID()), number) ){continue;}
+		//Fixed counter events (cycles, retired) are always captured anyway.
+		if( DictionaryValue(values[i], "fixed_counter", CFNumberGetTypeID()) ){
+			continue;
+		}
+		if( !IntFromCF(DictionaryValue(values[i], "counters_mask",
+		  CFNumberGetTypeID()), mask) ){mask=0xFFFF;}
+
+		catalogue.Add(CounterEvent{
+		  StringFromCF(keys[i]), static_cast<int>(number),
+		  static_cast<uint8_t>(mask>>kNumFixedCounters),
+		  StringFromCF(DictionaryValue(values[i], "description",
+		    CFStringGetTypeID())) });
+	}
+
+	auto aliases=DictionaryValue(cpu, "aliases", CFDictionaryGetTypeID());
+	if(aliases){
+		count=CFDictionaryGetCount(static_cast<CFDictionaryRef>(aliases));
+		keys.resize(count); values.resize(count);
+		CFDictionaryGetKeysAndValues(static_cast<CFDictionaryRef>(aliases),
+		  keys.data(), values.data());
+		for(auto i=0; i<count; i++){
+			catalogue.AddAlias(StringFromCF(keys[i]), StringFromCF(values[i]));
+		}
+	}
+
+	auto name=StringFromCF(DictionaryValue(plist, "name", CFStringGetTypeID()));
+	if( !name.empty() ){catalogue.source+=" ("+name+")";}
+	CFRelease(plist);
+	return true;
+}
+#else
+static bool LoadKpepPlist(vector<char> const&, EventCatalogue&){
+	printf("kpep plists can only be read on macOS\n");
+	return false;
+}
+#endif
+//=============================================================================
+#pragma mark Loading pmu-events JSON
+
+/*
+	The Linux pmu-events tables are a JSON array of flat objects, eg
+		{
+			"EventCode": "0x04",
+			"EventName": "L1D_CACHE",
+			"BriefDescription": "Level 1 data cache access",
+			"Counter": "0,1,2,3"
+		},
+	Every value is a string, so a very small parser suffices; anything it
+	does not understand is skipped.
+	Entries that only name an "ArchStdEvent" (no EventCode) are resolved
+	against whatever catalogue was already loaded (eg the built-in ARMv8
+	architectural events); otherwise they are dropped.
+*/
+struct JSONReader{
+	char const* p;
+	char const* end;
+
+	void SkipSpace(){
+		while( p<end && isspace(*p) ){p++;}
+	}
+	bool Expect(char c){
+		SkipSpace();
+		if( p<end && *p==c ){p++; return true;}
+		return false;
+	}
+	bool ReadString(string& result){
+		result.clear();
+		if( !Expect('"') ){return false;}
+		while( p<end && *p!='"' ){
+			if( *p=='\\' && p+1<end ){p++;}
+			result.push_back(*p++);
+		}
+		return Expect('"');
+	}
+	//Numbers, true/false/null, nested arrays and objects: skipped as text.
+	bool SkipValue(){
+		SkipSpace();
+		if(p>=end){return false;}
+		if(*p=='"'){string s; return ReadString(s);}
+		if(*p=='{' || *p=='['){
+			auto depth=0;
+			string s;
+			do{
+				if(*p=='"'){ReadString(s); continue;}
+				if(*p=='{' || *p=='['){depth++;}
+				if(*p=='}' || *p==']'){depth--;}
+				p++;
+			}while( p<end && depth>0 );
+			return depth==0;
+		}
+		while( p<end && *p!=',' && *p!='}' && *p!=']' ){p++;}
+		return true;
+	}
+	bool ReadObject(unordered_map<string, string>& fields){
+		fields.clear();
+		if( !Expect('{') ){return false;}
+		if( Expect('}') ){return true;}
+		do{
+			string key, value;
+			if( !ReadString(key) || !Expect(':') ){return false;}
+			SkipSpace();
+			if( p<end && *p=='"' ){
+				if( !ReadString(value) ){return false;}
+				fields[key]=value;
+			}else if( !SkipValue() ){
+				return false;
+			}
+		}while( Expect(',') );
+		return Expect('}');
+	}
+};
+
+static bool LoadPmuEventsJSON(vector<char> const& bytes,
+  EventCatalogue& catalogue, EventCatalogue const& previous){
+	JSONReader reader{bytes.data(), bytes.data()+bytes.size()};
+	if( !reader.Expect('[') ){
+		printf("expected a JSON array of events\n");
+		return false;
+	}
+	unordered_map<string, string> fields;
+	do{
+		reader.SkipSpace();
+		if( reader.p<reader.end && *reader.p==']' ){break;}
+		if( !reader.ReadObject(fields) ){
+			printf("malformed JSON near offset %ld\n",
+			  static_cast<long>(reader.p-bytes.data()) );
+			return false;
+		}
+		auto name=fields["EventName"];
+		auto code=fields["EventCode"];
+		auto description=fields["BriefDescription"];
+		if( name.empty() ){name=fields["ArchStdEvent"];}
+		if( name.empty() ){continue;}
+		//Events on fixed counters are captured anyway.
+		if( fields["Counter"].find("Fixed")!=string::npos ){continue;}
+
+		//A list of counter numbers, eg "0,1,2,3" or "10". A list naming
+		// only counters we do not have leaves the mask 0, and the event
+		// cannot be scheduled; one with no numbers at all is ignored.
+		uint8_t mask=0xFF;
+		auto fCounters=false;
+		uint8_t counterMask=0;
+		istringstream counters(fields["Counter"]);
+		string counter;
+		while( getline(counters, counter, ',') ){
+			char* numberEnd;
+			auto n=strtol(counter.c_str(), &numberEnd, 10);
+			if(numberEnd==counter.c_str()){continue;}
+			fCounters=true;
+			if( n>=0 && n<VARIABLE_COUNTERS_COUNT ){counterMask|=1u<<n;}
+		}
+		if(fCounters){mask=counterMask;}
+
+		if( code.empty() ){
+			auto it=previous.byName.find(name);
+			if( it==previous.byName.end() ){continue;}
+			code=to_string(it->second->code);
+			if( description.empty() ){description=it->second->description;}
+		}
+		catalogue.Add(CounterEvent{
+		  name, static_cast<int>(strtol(code.c_str(), NULL, 0)), mask,
+		  description});
+	}while( reader.Expect(',') );
+	return true;
+}
+//=============================================================================
+
+bool LoadCounterEvents(string const& path){
+	auto file=fopen(path.c_str(), "rb");
+	if(file==NULL){
+		printf("Cannot open counter events file %s\n", path.c_str());
+		return false;
+	}
+	vector<char> bytes;
+	char buffer[64*1024];
+	size_t n;
+	while( (n=fread(buffer, 1, sizeof(buffer), file))>0 ){
+		bytes.insert(bytes.end(), buffer, buffer+n);
+	}
+	fclose(file);
+
+	auto& previous=Catalogue();
+	EventCatalogue catalogue;
+	catalogue.source=path;
+	printf("Loading counter events from %s: ", path.c_str());
+	auto fOK=false;
+	if( path.ends_with(".plist") ){
+		fOK=LoadKpepPlist(bytes, catalogue);
+	}else if( path.ends_with(".json") ){
+		fOK=LoadPmuEventsJSON(bytes, catalogue, previous);
+	}else{
+		printf("expected a .plist or .json file\n");
+	}
+	if(!fOK){return false;}
+	printf("%zu events\n", catalogue.events.size());
+
+	//Move in place; existing CounterEvent pointers into the old catalogue
+	// die here, which is fine as long as we load before building schedules.
+	previous.events.swap(catalogue.events);
+	previous.byName.swap(catalogue.byName);
+	previous.source=catalogue.source;
+	return true;
+}
+//=============================================================================
+#pragma mark Scheduling
+
+typedef array<int, VARIABLE_COUNTERS_COUNT> CounterOwners;	//event index or -1
+
+//Kuhn's augmenting path: place event e on some counter of this pass, moving
+// already placed events to other counters if that frees one up.
+static bool Augment(int e, CounterOwners& owners,
+  array<bool, VARIABLE_COUNTERS_COUNT>& visited,
+  vector<CounterEvent const*> const& events){
+	for(auto c=0; c<VARIABLE_COUNTERS_COUNT; c++){
+		if( !(events[e]->counterMask & (1u<<c)) || visited[c] ){continue;}
+		visited[c]=true;
+		if( owners[c]<0 || Augment(owners[c], owners, visited, events) ){
+			owners[c]=e;
+			return true;
+		}
+	}
+	return false;
+}
+//.............................................................................
+
+CounterSchedule::CounterSchedule(vector<string> const& eventNames,
+  vector<string> const& headings){
+	for(auto i=0; i<eventNames.size(); i++){
+		auto event=FindCounterEvent(eventNames[i]);
+		if(event==nullptr){
+			printf("Unknown counter event %s\n", eventNames[i].c_str());
+			exit(1);
+		}
+		if(event->counterMask==0){
+			printf("Counter event %s cannot be counted by any of the "
+			  "configurable counters\n", eventNames[i].c_str());
+			exit(1);
+		}
+		events.push_back(event);
+		this->headings.push_back( i<headings.size()? headings[i]: eventNames[i] );
+	}
+
+	//Most constrained events first, otherwise in the order requested.
+	vector<int> order(events.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b){
+		return std::popcount(events[a]->counterMask)
+		      <std::popcount(events[b]->counterMask);
+	});
+
+	vector<CounterOwners> passOwners;
+	for(auto e:order){
+		array<bool, VARIABLE_COUNTERS_COUNT> visited;
+		auto fPlaced=false;
+		for(auto& owners:passOwners){
+			visited.fill(false);
+			if( Augment(e, owners, visited, events) ){
+				fPlaced=true;
+				break;
+			}
+		}
+		if(!fPlaced){
+			CounterOwners owners;
+			owners.fill(-1);
+			visited.fill(false);
+			//An empty pass has every counter free, so this fails only for an
+			// event with no allowed counter, which the constructor rejected.
+			auto fPlacedAlone=Augment(e, owners, visited, events);
+			assert(fPlacedAlone);
+			(void)fPlacedAlone;
+			passOwners.push_back(owners);
+		}
+	}
+	//Even with no events we still want one pass for the fixed counters.
+	if( passOwners.empty() ){
+		CounterOwners owners;
+		owners.fill(-1);
+		passOwners.push_back(owners);
+	}
+
+	placements.resize( events.size() );
+	for(auto p=0; p<passOwners.size(); p++){
+		Pass pass;
+		for(auto c=0; c<VARIABLE_COUNTERS_COUNT; c++){
+			auto e=passOwners[p][c];
+			pass.eventsArray[c]=(e<0)? 0: events[e]->code;
+			if(e>=0){placements[e]=Placement{p, c};}
+		}
+		passes.push_back(pass);
+	}
+}
+//=============================================================================
+#pragma mark Running a Schedule
+
+ScheduledCounters CycleAverager::operator()(std::function<void(void)> probe,
+  CounterSchedule const& schedule){
+	vector< pair<counters_t, double> > passResults;
+	//Whether each pass's counters were all set up (see below).
+	vector< array<bool, VARIABLE_COUNTERS_COUNT> > passLive;
+	//On the core the caller set the counters up on. A pass the counters are
+	// already set up for (every point after the first, for a schedule of
+	// one pass) is not set up again.
+	auto fUsePCore=configured_on_pcore();
+	for(auto& pass:schedule.passes){
+		if( !counters_configured_for(fUsePCore, &pass.eventsArray[0]) ){
+			setup_performance_counters(fUsePCore, &pass.eventsArray[0]);
+		}
+		passResults.push_back( (*this)(probe, kCaptureAllCounters) );
+		array<bool, VARIABLE_COUNTERS_COUNT> live;
+		for(auto c=0; c<VARIABLE_COUNTERS_COUNT; c++){live[c]=configurable_counter_live(c);}
+		passLive.push_back(live);
+	}
+
+	//The fixed counters and time were measured on every pass; combine them
+	// the same way we combined the samples within a pass.
+	ScheduledCounters result{0, 0, 0};
+	switch(this->averagingMethod){
+		case kMin: result={DBL_MAX, DBL_MAX, DBL_MAX}; break;
+		default:   break;
+	}
+	for(auto& [counters, ns]:passResults){
+		switch(this->averagingMethod){
+		//A median over two or three passes is no better than their mean.
+		case kMedian:
+		case kMean:
+			result.cycles     +=counters[0]/passResults.size();
+			result.retireds   +=counters[1]/passResults.size();
+			result.realtime_ns+=ns         /passResults.size();
+			break;
+		case kMin:
+			result.cycles     =std::min(result.cycles,      counters[0]);
+			result.retireds   =std::min(result.retireds,    counters[1]);
+			result.realtime_ns=std::min(result.realtime_ns, ns);
+			break;
+		case kMax:
+			result.cycles     =std::max(result.cycles,      counters[0]);
+			result.retireds   =std::max(result.retireds,    counters[1]);
+			result.realtime_ns=std::max(result.realtime_ns, ns);
+			break;
+		}
+	}
+
+	//Each event was measured on exactly one pass; NaN if its counter could
+	// not be set up there.
+	for(auto i=0; i<schedule.placements.size(); i++){
+		auto& placement=schedule.placements[i];
+		if( !passLive[placement.pass][placement.counter] ){
+			static set<string> reported;
+			if( reported.insert(schedule.events[i]->name).second ){
+				printf("Not counting %s: its counter could not be set up\n",
+				  schedule.events[i]->name.c_str());
+			}
+			result.events.push_back(NAN);
+			continue;
+		}
+		result.events.push_back(
+		  passResults[placement.pass].first[2+placement.counter] );
+	}
+	return result;
+}
+//=============================================================================
@@ -0,0 +1,99 @@
+//
+//  counterEvents.h
+//  AArch64-Explore
+//
+//  Named counter events, and scheduling a list of them onto the counters.
+//
+
+#ifndef counterEvents_h
+#define counterEvents_h
+
+#include <string>
+#include <vector>
+#include <array>
+
+#include "m1cycles.h"
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	Rather than hand-editing the counter configuration for each experiment,
+	a probe can simply name the events it cares about:
+		CounterSchedule schedule({"MAP_LDST_UOP", "INST_LDST", "LD_UNIT_UOP"},
+		                         {"regs",         "rets",      "uops"});
+		auto result=CycleAverager()(probe, schedule);
+		//result.events[0] is MAP_LDST_UOP, [1] INST_LDST, [2] LD_UNIT_UOP
+
+	The schedule assigns each event to one of the eight configurable counters,
+	honoring the restriction that some events can only be counted by some
+	counters. When the events do not all fit at once they are split into
+	several passes; CycleAverager reruns the probe once per pass and merges
+	the results back into a single list, in the order the events were
+	requested, so that printing code can just walk events and headings
+	in parallel.
+
+	Assignment is done event by event, most constrained first, as a
+	bipartite matching (events to counters) within each pass, reshuffling
+	already placed events along an augmenting path when that makes room.
+	A new pass is only opened when an event cannot be fitted into any
+	existing pass.
+
+	The event names, codes and counter restrictions come from a catalogue.
+	A small built-in catalogue (A14/M1 on macOS, the ARMv8 architectural
+	events on Linux/AArch64) is used unless LoadCounterEvents() is given
+	an event database, which is either
+	- a kpep plist, as found in /usr/share/kpep/ (eg as1.plist, as4.plist),
+	  for whatever Apple core we are running on, or
+	- a JSON event table in the format of the Linux kernel's
+	  tools/perf/pmu-events/arch/ directories.
+	so that the same binary can measure any of these cores, given the
+	right file. (main.cpp exposes this as --events <file>.)
+*/
+//=============================================================================
+
+struct CounterEvent{
+	string      name;
+	int         code;
+	//Bit i set means configurable counter i (ie valuesC()[i]) can count this.
+	uint8_t     counterMask;
+	string      description;
+};
+
+//Replaces the catalogue with the contents of a .plist (kpep) or .json
+// (Linux pmu-events) file. On failure prints why, leaves the catalogue
+// unchanged, and returns false.
+bool LoadCounterEvents(string const& path);
+
+//Returns nullptr if the name (or alias) is not known.
+CounterEvent const* FindCounterEvent(string const& name);
+
+void PrintCounterEvents(void);
+//.............................................................................
+
+struct CounterSchedule{
+	struct Pass{
+		//Ready to hand to setup_performance_counters(); 0 means unused.
+		array<int, VARIABLE_COUNTERS_COUNT> eventsArray;
+	};
+	struct Placement{
+		int pass;
+		int counter;	//configurable counter, ie index into valuesC()
+	};
+
+	//All three of these are in the order the events were requested.
+	vector<CounterEvent const*> events;
+	vector<string>              headings;
+	vector<Placement>           placements;
+
+	vector<Pass>                passes;
+
+	//headings may be shorter than eventNames (or empty), in which case the
+	// event name is used as the heading.
+	//Unknown event names, and events no configurable counter can count
+	// (a counterMask of 0), are fatal.
+	CounterSchedule(vector<string> const& eventNames,
+	  vector<string> const& headings={});
+};
+//=============================================================================
+
+#endif /* counterEvents_h */
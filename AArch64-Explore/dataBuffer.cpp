@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <cassert>
+#include <new>
 #include "dataBuffer.h"
 //=============================================================================
 
@@ -18,14 +19,14 @@ void* AllocateDataBuffer(size_t size, DataBufferType type){
 	if(size==0) size=kDefaultDataBufferSize;
 	
 	//Note the apparently weird () below force the new to zero the array.
-	char* byteArray=new char[size](); //reinterpret_cast<char*>( calloc( size, sizeof(char) ));
+	//Small buffers (probes register what they need) would not otherwise be
+	// page aligned, so ask for that explicitly.
+	u_int64_t const k16kPageMask=(1<<14)-1;
+	char* byteArray=new(std::align_val_t(k16kPageMask+1)) char[size](); //reinterpret_cast<char*>( calloc( size, sizeof(char) ));
 	if(byteArray==NULL){printf("AllocateDataBuffer failed."); exit(1);}
 	//Note that we never free[] this storge...
 	
 	//Check that the buffer is page aligned.
-	// It should be, but if the memory allocator is changed, add some code here to force
-	// alignment.
-	u_int64_t const k16kPageMask=(1<<14)-1;
 	assert( (reinterpret_cast<u_int64_t>(byteArray)&k16kPageMask) ==0 );
 	
 	switch(type){
@@ -0,0 +1,237 @@
+//
+//  kneeDetection.cpp
+//  AArch64-Explore
+//
+//  Finding the knees (resource limits) in a probeCount sweep.
+//
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <set>
+
+#include "m1cycles.h"	//(and so statistics.h)
+#include "kneeDetection.h"
+
+//Points in the coarse sweep, and the most SearchForKnees() measures in all.
+static int const kCoarsePoints=16;
+static int const kMaxSearchPoints=48;
+//Hinge positions are tried at this many steps between measured points.
+static int const kGridSubdivisions=4;
+//What each hinge costs in the BIC that chooses how many there are: the
+// usual charge for a change point, log n for its slope and two for its
+// position (we chose the best of hundreds of places).
+static double const kHingeBICCost=3;
+static int const kMaxRefinePasses=8;
+//=============================================================================
+#pragma mark Segmented regression
+
+//Least squares fit of y=a+b*x+sum_j c_j*max(0, x-t_j). Returns the sum of
+// squared residuals, and in beta (if given) a, b, c_0, c_1, ...
+//DBL_MAX if the hinges leave the system singular.
+static double FitHinges(vector<SweepPoint> const& points,
+  vector<double> const& hinges, vector<double>* beta=nullptr){
+	auto p=hinges.size()+2;
+	auto Basis=[&](SweepPoint const& point, size_t i){
+		if(i==0){return 1.0;}
+		if(i==1){return point.x;}
+		return max(0.0, point.x-hinges[i-2]);
+	};
+
+	//The normal equations, [A|r], solved by Gaussian elimination with
+	// partial pivoting. p is tiny, so this is all cheap.
+	vector<vector<double>> a( p, vector<double>(p+1, 0) );
+	for(auto& point:points){
+		for(auto i=0; i<p; i++){
+			auto fi=Basis(point, i);
+			for(auto j=0; j<p; j++){a[i][j]+=fi*Basis(point, j);}
+			a[i][p]+=fi*point.y;
+		}
+	}
+	for(auto col=0; col<p; col++){
+		auto pivot=col;
+		for(auto row=col+1; row<p; row++){
+			if( fabs(a[row][col])>fabs(a[pivot][col]) ){pivot=row;}
+		}
+		if( fabs(a[pivot][col])<1e-12*(1+fabs(a[0][0])) ){return DBL_MAX;}
+		swap(a[col], a[pivot]);
+		for(auto row=0; row<p; row++){
+			if(row==col){continue;}
+			auto f=a[row][col]/a[col][col];
+			for(auto j=col; j<=p; j++){a[row][j]-=f*a[col][j];}
+		}
+	}
+	vector<double> coefficients(p);
+	for(auto i=0; i<p; i++){coefficients[i]=a[i][p]/a[i][i];}
+
+	double sse=0;
+	for(auto& point:points){
+		auto fit=0.0;
+		for(auto i=0; i<p; i++){fit+=coefficients[i]*Basis(point, i);}
+		sse+=(point.y-fit)*(point.y-fit);
+	}
+	if(beta){*beta=coefficients;}
+	return sse;
+}
+//.............................................................................
+
+//Moves each hinge in turn to wherever fits best with the others held,
+// until none moves. Returns the sum of squared residuals.
+static double RefineHinges(vector<SweepPoint> const& points,
+  vector<double> const& candidates, vector<double>& hinges){
+	auto sse=FitHinges(points, hinges);
+	for(auto pass=0; pass<kMaxRefinePasses; pass++){
+		auto fMoved=false;
+		for(auto j=0; j<hinges.size(); j++){
+			for(auto t:candidates){
+				if( find(hinges.begin(), hinges.end(), t)!=hinges.end() ){continue;}
+				auto trial=hinges;
+				trial[j]=t;
+				auto trialSSE=FitHinges(points, trial);
+				if(trialSSE<sse){sse=trialSSE; hinges=trial; fMoved=true;}
+			}
+		}
+		if(!fMoved){break;}
+	}
+	return sse;
+}
+//.............................................................................
+
+vector<Knee> FindKnees(vector<SweepPoint> points, int maxKnees){
+	sort(points.begin(), points.end(), [](auto& a, auto& b){return a.x<b.x;});
+	auto n=(int)points.size();
+	vector<Knee> knees;
+	if(n<6){return knees;}
+
+	//Candidate hinge positions: from the second point to the third last, so
+	// neither segment is fitted by fewer than two points beyond the hinge.
+	vector<double> candidates;
+	for(auto i=1; i<n-3; i++){
+		for(auto s=0; s<kGridSubdivisions; s++){
+			candidates.push_back( points[i].x
+			  +(points[i+1].x-points[i].x)*s/kGridSubdivisions );
+		}
+	}
+	candidates.push_back(points[n-3].x);
+
+	//The best fit with k hinges, for each k: each new hinge where it helps
+	// most, then all of them moved to where they fit best together (one
+	// hinge of an S shape sits badly until the other joins it).
+	//Data without noise fit exactly; floor the error so the BIC is finite.
+	auto sseFloor=0.0;
+	for(auto& point:points){sseFloor+=1e-12*point.y*point.y;}
+	auto BIC=[&](double sse, int k){
+		return n*log( max(sse, sseFloor+DBL_MIN)/n )+kHingeBICCost*k*log(n);
+	};
+	vector<double> hinges, bestHinges;
+	auto sse=FitHinges(points, hinges);
+	auto bestBIC=BIC(sse, 0);
+	for(auto k=1; k<=maxKnees && n-(2+2*k)>0; k++){
+		auto bestT=0.0, bestSSE=DBL_MAX;
+		for(auto t:candidates){
+			if( find(hinges.begin(), hinges.end(), t)!=hinges.end() ){continue;}
+			auto trial=hinges;
+			trial.push_back(t);
+			auto trialSSE=FitHinges(points, trial);
+			if(trialSSE<bestSSE){bestSSE=trialSSE; bestT=t;}
+		}
+		if(bestSSE==DBL_MAX){break;}
+		hinges.push_back(bestT);
+		sse=RefineHinges(points, candidates, hinges);
+		if( BIC(sse, k)<bestBIC ){
+			bestBIC=BIC(sse, k);
+			bestHinges=hinges;
+		}
+	}
+	hinges=bestHinges;
+	if( hinges.empty() ){return knees;}
+	sort( hinges.begin(), hinges.end() );
+
+	vector<double> beta;
+	sse=FitHinges(points, hinges, &beta);
+	auto dof=n-(2+2*(int)hinges.size());
+	auto t95=StudentT95( max(dof, 1) );
+	auto sseLimit=sse*( 1+t95*t95/max(dof, 1) );
+
+	auto slope=beta[1];
+	for(auto j=0; j<hinges.size(); j++){
+		Knee knee;
+		knee.x=hinges[j];
+		knee.slopeBefore=slope;
+		slope+=beta[2+j];
+		knee.slopeAfter=slope;
+
+		//Move this hinge, holding the others, and see where the fit stays
+		// within the interval.
+		knee.xLow=knee.xHigh=knee.x;
+		for(auto t:candidates){
+			auto trial=hinges;
+			trial[j]=t;
+			if( FitHinges(points, trial)<=sseLimit ){
+				knee.xLow =min(knee.xLow, t);
+				knee.xHigh=max(knee.xHigh, t);
+			}
+		}
+		knees.push_back(knee);
+	}
+	return knees;
+}
+//=============================================================================
+#pragma mark Coarse to fine
+
+vector<SweepPoint> SearchForKnees(int lo, int hi, int stride,
+  function<double(int)> const& measure, int maxKnees){
+	vector<SweepPoint> series;
+	set<int> measured;
+	auto Measure=[&](int x){
+		if( !measured.insert(x).second ){return;}
+		series.push_back( SweepPoint{double(x), measure(x)} );
+	};
+	//Snaps x down onto the lo, lo+stride, ... grid.
+	auto Snap=[&](double x){
+		return lo+int( (x-lo)/stride )*stride;
+	};
+
+	auto steps=(hi-lo)/stride;
+	auto coarseSteps=max( 1, (steps+kCoarsePoints-2)/(kCoarsePoints-1) );
+	for(auto x=lo; x<=hi; x+=coarseSteps*stride){Measure(x);}
+	Measure( Snap(hi) );
+
+	while( measured.size()<kMaxSearchPoints ){
+		//The midpoints of the wide gaps within each knee's interval, from
+		// the measured point below it to the one above it.
+		set<int> midpoints;
+		for(auto& knee:FindKnees(series, maxKnees)){
+			auto from=measured.lower_bound( int(ceil(knee.xLow)) );
+			if( from!=measured.begin() ){from--;}
+			auto to=measured.upper_bound( int(floor(knee.xHigh)) );
+			for(auto a=from; a!=to && next(a)!=measured.end(); a++){
+				auto b=*next(a);
+				if(b-*a>stride){midpoints.insert( Snap( (*a+b)/2.0 ) );}
+			}
+		}
+		if( midpoints.empty() ){break;}
+		for(auto x:midpoints){
+			if( measured.size()>=kMaxSearchPoints ){break;}
+			Measure(x);
+		}
+	}
+	return series;
+}
+//=============================================================================
+
+void PrintKnees(vector<Knee> const& knees){
+	if( knees.empty() ){
+		cout<<"No knee: one straight line fits"<<endl;
+		return;
+	}
+	for(auto& knee:knees){
+		cout<<fixed<<setprecision(1)
+		    <<"Knee at "<<knee.x<<" (95% "<<knee.xLow<<".."<<knee.xHigh<<")"
+		    <<setprecision(3)
+		    <<", slope "<<knee.slopeBefore<<" -> "<<knee.slopeAfter<<endl;
+	}
+}
+//=============================================================================
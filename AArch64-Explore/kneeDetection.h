@@ -0,0 +1,69 @@
+//
+//  kneeDetection.h
+//  AArch64-Explore
+//
+//  Finding the knees (resource limits) in a probeCount sweep.
+//
+
+#ifndef kneeDetection_h
+#define kneeDetection_h
+
+#include <vector>
+#include <functional>
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	Most of the assembly probes are looking for the point at which adding
+	one more copy of the probe starts to cost something: cycles are flat
+	(everything is hidden in the shadow of some delay) until a resource runs
+	out (ROB entries, load queue entries, ...), then climb linearly. Reading
+	that knee off a plot is easy for one sweep and tedious for fifty.
+
+	FindKnees() fits the sweep with a continuous piecewise linear function,
+	ie segmented regression,
+		y = a + b*x + sum_j c_j*max(0, x-t_j)
+	for 0, 1, ... maxKnees hinges t_j (each new one where it most reduces
+	the squared error, then all of them moved to where they fit best
+	together), and keeps the number of hinges with the best BIC, charging
+	each hinge 3 log n. For each knee it reports the slopes on either side
+	and a 95% interval for its position: the positions that, with the other
+	hinges held where they are, fit not significantly worse than the best
+	one.
+
+	SearchForKnees() uses that to spend measurements where they matter: a
+	coarse sweep, then repeatedly the midpoints of the gaps between measured
+	points inside each knee's interval, until the interval spans no gap
+	wider than stride (or we run out of budget). A ROB-size class sweep of
+	180 points becomes a few dozen.
+
+	Hinge positions are searched on a grid of quarter steps between measured
+	points, so they can fall between them.
+*/
+//=============================================================================
+
+struct SweepPoint{
+	double x, y;
+};
+
+struct Knee{
+	double x;				//best estimate of the position
+	double xLow, xHigh;		//95% interval for the position
+	double slopeBefore, slopeAfter;
+};
+
+//Knees (at most maxKnees) in order of x; empty if a straight line fits
+// as well as the data allow. Points need not be sorted.
+vector<Knee> FindKnees(vector<SweepPoint> points, int maxKnees=2);
+
+//Measures measure(x) for a coarse sweep of lo..hi, then refines around
+// the knees (x always lo plus a multiple of stride). Returns every point
+// measured, in the order measured.
+vector<SweepPoint> SearchForKnees(int lo, int hi, int stride,
+  function<double(int)> const& measure, int maxKnees=2);
+
+void PrintKnees(vector<Knee> const& knees);
+//=============================================================================
+
+#endif /* kneeDetection_h */
@@ -0,0 +1,355 @@
+//
+//  linuxcycles.cpp
+//  AArch64-Explore
+//
+//  Linux counterpart of m1cycles.cpp.
+//
+//.............................................................................
+#pragma mark Introduction
+/*
+	This provides the same setup_performance_counters()/get_counters() API as
+	the kperf code in m1cycles.cpp, but built on perf_event_open, so that
+	CycleAverager, PerformAssemblyProbe and the probes need no changes of
+	their own for Linux. There is no Linux build file yet (only the Xcode
+	project), and the tree has not been built or run on Linux/AArch64.
+
+	We open a single perf event group:
+	- the group leader counts cycles,
+	- the second member counts retired instructions,
+	- up to eight further members count the configurable events.
+	The whole group is read with one read() (PERF_FORMAT_GROUP), which gives
+	us a consistent snapshot, and the values are scattered into the same
+	[0] cycles, [1] retired, [2..9] configurable layout that the kperf code
+	uses.
+
+	The configurable events in eventsArray are passed through as
+	PERF_TYPE_RAW configs. On Asahi Linux (apple_m1 PMU) these are the same
+	numbers as the kpep event numbers, so the existing counterSettings work
+	as-is; on other AArch64 cores they are ARMv8 PMU event numbers.
+	A zero entry means "leave this counter unused" (it reads as 0).
+
+	Counting is restricted to user mode (exclude_kernel/exclude_hv), which
+	also means we can run without root as long as
+	/proc/sys/kernel/perf_event_paranoid is <=2.
+
+	A read() of the group is a syscall, costing on the order of a microsecond,
+	which is why inner counts have to be so large to amortize it. Where the
+	kernel allows it we instead read the counters directly from user mode:
+	each event's perf mmap control page tells us which hardware counter the
+	event currently lives in, and we read that counter with rdpmc (x86) or
+	mrs PMEVCNTR<n>_EL0/PMCCNTR_EL0 (AArch64), wrapped in the control page's
+	seqlock so that we retry if the kernel moved things underneath us.
+	That costs tens of cycles per snapshot.
+	On AArch64 this requires Linux 6.2+ and
+	  sysctl kernel.perf_user_access=1
+	If user access is not granted we silently fall back to read().
+	If any one event is off the PMU at the moment of a snapshot, the whole
+	snapshot comes from a single group read(), so that all the counts in it
+	were taken at the same time.
+*/
+//.............................................................................
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cassert>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "m1cycles.h"
+
+//=============================================================================
+
+#define CONFIG_COUNT    8
+
+//Set false to always take the read() syscall path.
+static auto const kUseUserspaceCounterReads=true;
+
+//One slot per entry of PerformanceCounters::valuesA.
+struct CounterSlot{
+	uint32_t type;		//PERF_TYPE_xxx
+	uint64_t config;	//0 with type PERF_TYPE_RAW means unused
+};
+static CounterSlot g_slots[COUNTERS_COUNT];
+//Whether each slot's event is in the open group.
+static bool g_slotOpen[COUNTERS_COUNT];
+
+//Position within the group read -> index into valuesA, and its fd.
+static int g_groupSlot[COUNTERS_COUNT];
+static int g_groupFD  [COUNTERS_COUNT];
+static int g_groupCount=0;
+static int g_leaderFD=-1;
+
+//The mmap'd control page of each group member (user-space read path).
+static perf_event_mmap_page* g_groupPage[COUNTERS_COUNT];
+static bool g_fUserspaceReads=false;
+
+uint64_t  g_countersA[COUNTERS_COUNT];
+
+static void default_configure_perf(void);
+static bool open_perf_group(void);
+static void close_perf_group(void);
+static bool map_perf_pages(void);
+static inline bool read_perf_page(perf_event_mmap_page* page, uint64_t& count);
+//=============================================================================
+
+static long perf_event_open(perf_event_attr* attr,
+  pid_t pid, int cpu, int groupFD, unsigned long flags){
+	return syscall(__NR_perf_event_open, attr, pid, cpu, groupFD, flags);
+}
+//-----------------------------------------------------------------------------
+
+//This is the external call for counter setup/initialization.
+void setup_performance_counters(bool fUsePCore, int const* eventsArray){
+	note_counter_configuration(fUsePCore, eventsArray);
+
+	//Step (1) Pin to a big (or little) core, and calibrate the clock there.
+	place_on_core(fUsePCore);
+	calibrate_timebase();
+
+	//Step (2) Decide what each counter counts.
+	close_perf_group();
+	//The fixed counters are always cycles and retired instructions.
+	g_slots[0]={PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+	g_slots[1]={PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS};
+	if(eventsArray==NULL){
+		default_configure_perf();
+	}else{
+		for(auto i=0; i<CONFIG_COUNT; i++){
+			g_slots[2+i]={PERF_TYPE_RAW, (uint64_t)eventsArray[i]};
+		}
+	}
+
+	//Step (3) Open the group.
+	if( !open_perf_group() ){
+		printf("perf_event_open failed, check perf_event_paranoid?\n");
+		return;
+	}
+
+	//Step (4) Try for the user-space read path.
+	g_fUserspaceReads=kUseUserspaceCounterReads && map_perf_pages();
+	static auto reported=false;
+	if(!reported){
+		printf("perf counters read via %s\n",
+		  g_fUserspaceReads? "user-space rdpmc": "read() syscall");
+		reported=true;
+	}
+
+	//Step (5) Measure what reading them costs.
+	calibrate_counter_overhead();
+}
+//-----------------------------------------------------------------------------
+
+bool fast_counter_reads_available(void){
+	return g_fUserspaceReads;
+}
+
+bool configurable_counter_live(int c){
+	return g_slotOpen[2+c];
+}
+//-----------------------------------------------------------------------------
+
+//This is the external call to read the counters.
+PerformanceCounters get_counters(void){
+	//nr, time_enabled, time_running, then one value per group member.
+	uint64_t buffer[3+COUNTERS_COUNT];
+
+	//Get the time stamp:
+	auto realtime_ns=timebase_ns();
+
+	//And the counter values. If any member is off the PMU just now, the
+	// whole snapshot comes from one read() instead, rather than mixing
+	// values read at different times (around a syscall) in one sample.
+	if(g_fUserspaceReads){
+		auto fAllOnPMU=true;
+		for(auto i=0; i<g_groupCount && fAllOnPMU; i++){
+			fAllOnPMU=read_perf_page(g_groupPage[i], g_countersA[g_groupSlot[i]]);
+		}
+		if(fAllOnPMU){return PerformanceCounters{g_countersA, realtime_ns};}
+	}
+
+	auto bytes=read(g_leaderFD, buffer, sizeof(buffer));
+	static auto warned=false;
+	if(!warned){
+		if(bytes<=0){
+			printf("perf group read failed\n");
+			warned=true;
+		}else if(buffer[2]<buffer[1]){
+			//The kernel could not fit the whole group on the PMU at once.
+			printf("perf group is being multiplexed, too many events?\n");
+			warned=true;
+		}
+	}
+
+	memset(g_countersA, 0, sizeof(g_countersA));
+	if(bytes>0){
+		auto nr=buffer[0];
+		for(auto i=0; i<nr && i<g_groupCount; i++){
+			g_countersA[g_groupSlot[i]]=buffer[3+i];
+		}
+	}
+	return PerformanceCounters{g_countersA, realtime_ns};
+}
+//=============================================================================
+
+static bool open_perf_group(void){
+	g_groupCount=0;
+	memset(g_slotOpen, 0, sizeof(g_slotOpen));
+	for(auto i=0; i<COUNTERS_COUNT; i++){
+		auto& slot=g_slots[i];
+		if(slot.type==PERF_TYPE_RAW && slot.config==0){continue;}
+
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size          =sizeof(attr);
+		attr.type          =slot.type;
+		attr.config        =slot.config;
+		attr.disabled      =(g_leaderFD<0);
+		attr.exclude_kernel=1;
+		attr.exclude_hv    =1;
+		attr.read_format   =PERF_FORMAT_GROUP
+		  |PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+#if defined(__aarch64__)
+		//arm_pmuv3 "rdpmc" format bit: ask for EL0 access to the counter.
+		if(kUseUserspaceCounterReads){attr.config1|=0x2;}
+#endif
+
+		//pid 0, cpu -1: this thread, wherever it runs.
+		auto fd=(int)perf_event_open(&attr, 0, -1, g_leaderFD, 0);
+		//A member that cannot be opened is left out; its counter reads 0,
+		// and configurable_counter_live() says so.
+		if(fd<0){
+			printf("perf_event_open(type %u, config 0x%llx) failed\n",
+			  slot.type, (unsigned long long)slot.config);
+			if(g_leaderFD<0){return false;}
+			continue;
+		}
+		if(g_leaderFD<0){g_leaderFD=fd;}
+		g_slotOpen[i]=true;
+		g_groupSlot[g_groupCount]=i;
+		g_groupFD  [g_groupCount]=fd;
+		g_groupCount++;
+	}
+
+	ioctl(g_leaderFD, PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+	ioctl(g_leaderFD, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+//.............................................................................
+
+static void close_perf_group(void){
+	//Close the members before the leader.
+	for(auto i=g_groupCount-1; i>=0; i--){
+		if(g_groupPage[i]){munmap(g_groupPage[i], sysconf(_SC_PAGESIZE));}
+		g_groupPage[i]=nullptr;
+		close(g_groupFD[i]);
+	}
+	g_fUserspaceReads=false;
+	g_leaderFD=-1;
+	g_groupCount=0;
+	memset(g_slotOpen, 0, sizeof(g_slotOpen));
+}
+//=============================================================================
+#pragma mark User-space reads
+
+//Map each member's control page. We only take the user-space path if
+// *every* member allows it; a mix of paths would not give us anything.
+static bool map_perf_pages(void){
+	auto pageSize=sysconf(_SC_PAGESIZE);
+	auto fAllUserReadable=true;
+	for(auto i=0; i<g_groupCount; i++){
+		auto page=mmap(NULL, pageSize, PROT_READ, MAP_SHARED, g_groupFD[i], 0);
+		if(page==MAP_FAILED){
+			g_groupPage[i]=nullptr;
+			fAllUserReadable=false;
+			continue;
+		}
+		g_groupPage[i]=static_cast<perf_event_mmap_page*>(page);
+		if(!g_groupPage[i]->cap_user_rdpmc){fAllUserReadable=false;}
+	}
+	return fAllUserReadable;
+}
+//.............................................................................
+
+//Read hardware counter <counter> (the control page's index-1).
+#if defined(__x86_64__)
+static inline uint64_t read_pmc(uint32_t counter){
+	uint32_t lo, hi;
+	asm volatile("rdpmc" : "=a" (lo), "=d" (hi) : "c" (counter));
+	return ( (uint64_t)hi<<32 ) | lo;
+}
+#elif defined(__aarch64__)
+//The counter number has to be encoded in the mrs, hence the switch.
+#define PMEVCNTR(n)															\
+	case n:{uint64_t v; asm volatile("mrs %0, pmevcntr" #n "_el0" : "=r" (v)); return v;}
+static inline uint64_t read_pmc(uint32_t counter){
+	switch(counter){
+	PMEVCNTR(0)  PMEVCNTR(1)  PMEVCNTR(2)  PMEVCNTR(3)
+	PMEVCNTR(4)  PMEVCNTR(5)  PMEVCNTR(6)  PMEVCNTR(7)
+	PMEVCNTR(8)  PMEVCNTR(9)  PMEVCNTR(10) PMEVCNTR(11)
+	PMEVCNTR(12) PMEVCNTR(13) PMEVCNTR(14) PMEVCNTR(15)
+	PMEVCNTR(16) PMEVCNTR(17) PMEVCNTR(18) PMEVCNTR(19)
+	PMEVCNTR(20) PMEVCNTR(21) PMEVCNTR(22) PMEVCNTR(23)
+	PMEVCNTR(24) PMEVCNTR(25) PMEVCNTR(26) PMEVCNTR(27)
+	PMEVCNTR(28) PMEVCNTR(29) PMEVCNTR(30)
+	case 31:{uint64_t v; asm volatile("mrs %0, pmccntr_el0" : "=r" (v)); return v;}
+	default: return 0;
+	}
+}
+#undef PMEVCNTR
+#else
+static inline uint64_t read_pmc(uint32_t){return 0;}
+#endif
+//.............................................................................
+
+//The seqlock protocol from include/uapi/linux/perf_event.h.
+//Returns false if the event is not currently on a counter (index==0), when
+// only the kernel knows its count.
+static inline bool read_perf_page(perf_event_mmap_page* page, uint64_t& count){
+	uint32_t seq, index;
+	do{
+		seq=page->lock;
+		asm volatile("" ::: "memory");
+
+		index=page->index;
+		count=page->offset;
+		if(index==0){break;}
+
+		auto width=page->pmc_width;
+		auto pmc  =read_pmc(index-1);
+		//Sign extend the width-bit hardware value.
+		pmc<<=64-width;
+		count+=(int64_t)pmc>>(64-width);
+
+		asm volatile("" ::: "memory");
+	}while(page->lock!=seq);
+	return index!=0;
+}
+//=============================================================================
+
+//Without an eventsArray we use the generic perf events, since we cannot
+// know which raw event numbers this core understands.
+static void default_configure_perf(){
+	auto const kL1DReadMiss=PERF_COUNT_HW_CACHE_L1D
+	  |(PERF_COUNT_HW_CACHE_OP_READ<<8)|(PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+	auto const kDTLBReadMiss=PERF_COUNT_HW_CACHE_DTLB
+	  |(PERF_COUNT_HW_CACHE_OP_READ<<8)|(PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+
+	g_slots[2+0]={PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS};
+	g_slots[2+1]={PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES};
+	g_slots[2+2]={PERF_TYPE_HW_CACHE, (uint64_t)kL1DReadMiss};
+	g_slots[2+3]={PERF_TYPE_HW_CACHE, (uint64_t)kDTLBReadMiss};
+	g_slots[2+4]={PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES};
+	g_slots[2+5]={PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES};
+	g_slots[2+6]={PERF_TYPE_RAW, 0};
+	g_slots[2+7]={PERF_TYPE_RAW, 0};
+}
+//=============================================================================
+
+#endif //__linux__
@@ -38,13 +38,19 @@
 #include <vector>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cfloat>
+#include <cassert>
 
 #include <dlfcn.h>
 #include <pthread.h>
 
 #include "m1cycles.h"
+#include "counterEvents.h"
 
+//Everything from here down to CycleAverager is the macOS (kperf) backend.
+//The Linux (perf_event_open) backend lives in linuxcycles.cpp.
+#if defined(__APPLE__)
 //=============================================================================
 
 //Declare the Performance Counter routines (since Apple does not provide a header).
@@ -80,25 +86,13 @@ KPERF_LIST
 //-----------------------------------------------------------------------------
 #pragma mark Event Definitions
 
-//This is a very partial list of events that can be counted.
-//Investigation of the others is on-going.
-//The most immediately useful events are
+//The fixed events are
 // cycles -- has the obvious meaning. Always in [0].
 // retired -- counts *non-speculated* instructions. Always in [1].
+//The configurable events are named, and looked up, in counterEvents.cpp.
 #define CPMU_NONE 0
 #define CPMU_CORE_retired 		0x01
 #define CPMU_CORE_CYCLE 		0x02
-
-//INST_A64 counts A64 instructions decoded (so includes speculative, and before cracking/fusion)
-#define CPMU_INST_A64 0x8c
-#define CPMU_INST_BRANCH 0x8d
-#define CPMU_SYNC_DC_LOAD_MISS 0xbf
-#define CPMU_SYNC_DC_STORE_MISS 0xc0
-#define CPMU_SYNC_DTLB_MISS 0xc1
-#define CPMU_SYNC_ST_HIT_YNGR_LD 0xc4
-#define CPMU_SYNC_BR_ANY_MISP 0xcb
-#define CPMU_FED_IC_MISS_DEM 0xd3
-#define CPMU_FED_ITLB_MISS 0xd4
 //.............................................................................
 
 //We only want to capture user level 64-bit code events.
@@ -153,16 +147,27 @@ static void default_configure_rdtsc(void);
 
 //This is the external call for counter setup/initialization.
 void setup_performance_counters(bool fUsePCore, int const* eventsArray){
+	note_counter_configuration(fUsePCore, eventsArray);
 
-	//Step (1) Force the code onto P or E cores
-  	if(fUsePCore){
-    	pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
-  	}else{
-    	pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
-  	}
+	//Step (1) Force the code onto P or E cores, and calibrate the clock there.
+	place_on_core(fUsePCore);
+	calibrate_timebase();
 	
 	//Step (2) Initialize the performance counters.
   	init_rdtsc(eventsArray);
+
+	//Step (3) Measure what reading them costs.
+	calibrate_counter_overhead();
+}
+//-----------------------------------------------------------------------------
+
+//kperf offers no user-mode access to the counters.
+bool fast_counter_reads_available(void){
+	return false;
+}
+
+bool configurable_counter_live(int c){
+	return true;
 }
 //-----------------------------------------------------------------------------
 
@@ -171,13 +176,6 @@ PerformanceCounters get_counters(void){
 
 	//One time initializatipons:
 
-	//Conversion factor between mach time and nanoseconds.
-	static double kTBtoNS=0;
-	if(kTBtoNS==0){
-		mach_timebase_info_data_t timebase;
-        mach_timebase_info(&timebase);
-        kTBtoNS=(1.*timebase.numer)/timebase.denom;
-	}
   	static auto warned=false;
     if(!warned){
 		if( kpc_get_thread_counters(0, COUNTERS_COUNT, g_countersA) ){
@@ -188,7 +186,9 @@ PerformanceCounters get_counters(void){
 	//...........................................................................
 
 	//Get the time stamp:
-	auto realtime_ns=mach_absolute_time()*kTBtoNS;
+	//(The calibrated CNTVCT_EL0, which is what mach_absolute_time() reads,
+	// without the call.)
+	auto realtime_ns=timebase_ns();
 	
 	//And the counter values.
 	//We don't bother error testing -- you need to heed the first time warning!
@@ -263,19 +263,6 @@ static void configure_rdtsc(){
   	}
 }
 //=============================================================================
-//From /usr/share/kpep/a14.plist
-#define MAP_LDST_UOP 		125		//
-#define LD_UNIT_UOP			166		//
-#define INST_LDST			155		//5
-#define L1D_CACHE_MISS_LD	163
-#define LD_NT_UOP			230
-
-#define ST_UNIT_UOP			167
-#define L1D_CACHE_MISS_ST	162
-#define L1D_CACHE_WRITEBACK 168
-#define ST_NT_UOP			229
-
-#define ST_MEMORY_ORDER_VIOLATION_NONSPEC 196 //5,4,3
 
 //xxx fill this in with something useful
 static void default_configure_rdtsc(){
@@ -288,101 +275,149 @@ static void default_configure_rdtsc(){
   	//g_configF[0] = CPMU_CORE_CYCLE;	| CFGWORD_EL0A64EN_MASK;
   	//g_configF[0] = CPMU_CORE_retired;	| CFGWORD_EL0A64EN_MASK;
 
-	g_configC[0]=MAP_LDST_UOP;
-	g_configC[1]=LD_UNIT_UOP;
-	g_configC[5]=INST_LDST;
-	g_configC[2]=L1D_CACHE_MISS_LD;
-
-	g_configC[3]=ST_MEMORY_ORDER_VIOLATION_NONSPEC;
-	g_configC[4]=ST_UNIT_UOP;
-	g_configC[6]=L1D_CACHE_MISS_ST;
-	g_configC[7]=L1D_CACHE_WRITEBACK;
-	//[7]
+	//Events the loaded catalogue does not know (some other core) are skipped,
+	// as is anything that does not fit in the first pass.
+	static char const* kDefaultEvents[]={
+		"MAP_LDST_UOP", "LD_UNIT_UOP", "L1D_CACHE_MISS_LD",
+		"ST_MEMORY_ORDER_VIOLATION_NONSPEC", "ST_UNIT_UOP", "INST_LDST",
+		"L1D_CACHE_MISS_ST", "L1D_CACHE_WRITEBACK"
+	};
+	vector<string> eventNames;
+	for(auto name:kDefaultEvents){
+		if( FindCounterEvent(name) ){eventNames.push_back(name);}
+	}
+	CounterSchedule schedule(eventNames);
+	for(auto i=0; i<CONFIG_COUNT; i++){
+		g_configC[i]=schedule.passes[0].eventsArray[i];
+	}
 }
+#endif //__APPLE__
 //=============================================================================
 
-pair<double, double> CycleAverager::operator()(std::function<void(void)> probe){
-	auto outerCount=this->outerCount;
-	PerformanceCounters pc, min(DBL_MAX), max(0.0), sum(0.0);
-
-	//Execute once to set up caches, predictors, etc.
-	pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
-			probe();
+//=============================================================================
+#pragma mark Counter Configuration
+
+static bool g_fCountersConfigured=false, g_fConfiguredPCore=kUsePCore;
+static bool g_fConfiguredDefaultEvents=false;
+static int  g_configuredEvents[VARIABLE_COUNTERS_COUNT];
+
+void note_counter_configuration(bool fUsePCore, int const* eventsArray){
+	g_fCountersConfigured    =true;
+	g_fConfiguredPCore       =fUsePCore;
+	g_fConfiguredDefaultEvents=(eventsArray==NULL);
+	if(eventsArray){
+		memcpy(g_configuredEvents, eventsArray, sizeof(g_configuredEvents));
+	}
+}
 
-	for(auto i=0; i<outerCount; i++){
-	pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
-		pc=get_counters();
+bool configured_on_pcore(void){
+	return g_fConfiguredPCore;
+}
 
-			auto innerCount=this->innerCount;
-			for(auto j=0; j<innerCount; j++){
-				probe();
-			}
+bool counters_configured_for(bool fUsePCore, int const* eventsArray){
+	if( !g_fCountersConfigured || fUsePCore!=g_fConfiguredPCore ){return false;}
+	if(eventsArray==NULL || g_fConfiguredDefaultEvents){
+		return eventsArray==NULL && g_fConfiguredDefaultEvents;
+	}
+	return memcmp(g_configuredEvents, eventsArray, sizeof(g_configuredEvents))==0;
+}
+//=============================================================================
 
+//=============================================================================
+#pragma mark Counter Read Overhead
+
+static CounterOverhead g_counterOverhead{
+  PerformanceCounters(0.0), PerformanceCounters(0.0),
+  PerformanceCounters(0.0), PerformanceCounters(0.0)};
+static int const kNumCalibrationSamples=1000;
+
+void calibrate_counter_overhead(void){
+	vector<PerformanceCounters> samples;
+	samples.reserve(kNumCalibrationSamples);
+	//Warm up whatever the read path touches.
+	get_counters();
+	get_counters();
+	for(auto i=0; i<kNumCalibrationSamples; i++){
+		auto pc=get_counters();
 		pc-=get_counters();
-		min =min.Min(pc);
-		max =max.Max(pc);
-		sum+=pc;
-//cout<<"min "<<min<<"  innerCount"<<innerCount<<endl;
-//cout<<"max"<<max<<endl;
+		samples.push_back(pc);
 	}
-	min/=innerCount;
-	max/=innerCount;
-	sum/=innerCount;
-	sum/=outerCount;
-//cout<<min<<endl;
-//cout<<max<<endl;
-/*cout<<setw(20)<<min.valuesA[2]
-	<<setw(16)<<min.valuesA[3]
-	<<setw(16)<<min.valuesA[4]
-	<<setw(16)<<min.valuesA[5]<<endl;*/
-	switch(this->averagingMethod){
-		case kMean: return pair(sum.cycles(), sum.realtime_ns);
-		case kMin:  return pair(min.cycles(), min.realtime_ns);
-		case kMax:  return pair(max.cycles(), max.realtime_ns);
-		default: 	return pair(0,0);
+
+	//Each lane is sorted separately; the quantiles need not come from the
+	// same sample.
+	vector<double> lane(kNumCalibrationSamples);
+	auto quantile=[&](double q){
+		return lane[ static_cast<size_t>( q*(lane.size()-1) ) ];
+	};
+	auto& o=g_counterOverhead;
+	for(auto j=0; j<=COUNTERS_COUNT; j++){
+		for(auto i=0; i<kNumCalibrationSamples; i++){
+			lane[i]=(j<COUNTERS_COUNT)? samples[i].valuesA[j]: samples[i].realtime_ns;
+		}
+		std::sort(lane.begin(), lane.end());
+		auto set=[&](PerformanceCounters& pc, double value){
+			if(j<COUNTERS_COUNT){pc.valuesA[j]=value;}else{pc.realtime_ns=value;}
+		};
+		set(o.min,    quantile(0.0));
+		set(o.median, quantile(0.5));
+		set(o.p90,    quantile(0.9));
+		set(o.max,    quantile(1.0));
 	}
 }
+//.............................................................................
 
-pair<counters_t, double> CycleAverager::operator()(std::function<void(void)> probe, int){
-	auto outerCount=this->outerCount;
-	PerformanceCounters pc, min(DBL_MAX), max(0.0), sum(0.0);
+CounterOverhead const& counter_read_overhead(void){
+	return g_counterOverhead;
+}
+
+//The reads calibrated above retire instructions of their own, so a
+// retired counter that saw none of them is not counting (it failed to
+// open, or the counters were not set up at all, and reads 0).
+bool retired_counter_live(void){
+	return g_counterOverhead.max.retireds()>0;
+}
+//.............................................................................
 
-	//Execute once to set up caches, predictors, etc.
-	pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
-			probe();
+void print_counter_overhead(void){
+	auto& o=g_counterOverhead;
+	cout<<"Counter read overhead (per get_counters() pair)"
+	    <<(kSubtractCounterOverhead? ", min is subtracted": "")<<endl;
+	cout<<fixed<<setprecision(0)
+	    <<setw(10)<<""<<setw(10)<<"min"<<setw(10)<<"median"
+	    <<setw(10)<<"p90"<<setw(10)<<"max"<<endl;
+	auto row=[&](char const* name, int j){
+		auto get=[&](PerformanceCounters const& pc){
+			return (j<COUNTERS_COUNT)? pc.valuesA[j]: pc.realtime_ns;
+		};
+		cout<<setw(10)<<name<<setw(10)<<get(o.min)<<setw(10)<<get(o.median)
+		    <<setw(10)<<get(o.p90)<<setw(10)<<get(o.max)<<endl;
+	};
+	row("cycles", 0);
+	row("retired", 1);
+	for(auto j=2; j<COUNTERS_COUNT; j++){
+		char name[16];
+		snprintf(name, sizeof(name), "ctr%d", j-2);
+		row(name, j);
+	}
+	row("ns", COUNTERS_COUNT);
+}
+//=============================================================================
+#pragma mark CycleAverager
 
-	for(auto i=0; i<outerCount; i++){
-	pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
-		pc=get_counters();
+//The loop itself is CycleAverager::SampleT(), in m1cycles.h.
+PerformanceCounters CycleAverager::Sample(std::function<void(void)> const& probe){
+	return SampleT<1>(probe);
+}
+//.............................................................................
 
-			auto innerCount=this->innerCount;
-			for(auto j=0; j<innerCount; j++){
-				probe();
-			}
+pair<double, double> CycleAverager::operator()(std::function<void(void)> probe){
+	auto result=Sample(probe);
+	return pair(result.cycles(), result.realtime_ns);
+}
 
-		pc-=get_counters();
-		min =min.Min(pc);
-		max =max.Max(pc);
-		sum+=pc;
-//cout<<"min "<<min<<"  innerCount"<<innerCount<<endl;
-//cout<<"max"<<max<<endl;
-	}
-	min/=innerCount;
-	max/=innerCount;
-	sum/=innerCount;
-	sum/=outerCount;
-//cout<<min<<endl;
-//cout<<max<<endl;
-/*cout<<setw(20)<<min.valuesA[2]
-	<<setw(16)<<min.valuesA[3]
-	<<setw(16)<<min.valuesA[4]
-	<<setw(16)<<min.valuesA[5]<<endl;*/
-	switch(this->averagingMethod){
-		case kMean: return pair(sum.valuesA, sum.realtime_ns);
-		case kMin:  return pair(min.valuesA, min.realtime_ns);
-		case kMax:  return pair(max.valuesA, max.realtime_ns);
-		default: 	exit(1); //Fixme
-	}
+pair<counters_t, double> CycleAverager::operator()(std::function<void(void)> probe, int){
+	auto result=Sample(probe);
+	return pair(result.valuesA, result.realtime_ns);
 }
 
 //=============================================================================
@@ -7,10 +7,14 @@
 #include <iomanip>
 #include <vector>
 #include <array>
+#include <functional>
+#include <utility>
 using namespace std;
 
+#if defined(__APPLE__)
 #include <mach/mach_time.h>
 #include <sys/sysctl.h>
+#endif
 #define COUNTERS_COUNT 			10
 #define VARIABLE_COUNTERS_COUNT (COUNTERS_COUNT-2)
 
@@ -59,7 +63,7 @@ struct PerformanceCounters{
 
 	double realtime_ns;
 
-	PerformanceCounters(unsigned long long* other, double realtime_ns):
+	PerformanceCounters(uint64_t const* other, double realtime_ns):
 	  realtime_ns(realtime_ns){
 		for(auto i=0; i<COUNTERS_COUNT; i++){
 			valuesA[i]=other[i];
@@ -126,6 +130,15 @@ struct PerformanceCounters{
     	*this|=other;
     	return *this;
 	}
+	//For durations: subtract the cost of the counter reads themselves,
+	// never going below zero.
+	inline PerformanceCounters& RemoveOverhead(const PerformanceCounters& overhead){
+		for(auto i=0; i<COUNTERS_COUNT; i++){
+			valuesA[i]=std::max(0.0, valuesA[i]-overhead.valuesA[i]);
+		}
+		realtime_ns=std::max(0.0, realtime_ns-overhead.realtime_ns);
+    	return *this;
+	}
 
 	inline PerformanceCounters& operator/=(double numerator){
     	for(auto i=0; i<COUNTERS_COUNT; i++){
@@ -161,35 +174,241 @@ inline std::ostream& operator<<(std::ostream& os, PerformanceCounters const& oth
 };
 //=============================================================================
 
+//There are two implementations of these, selected at compile time:
+// m1cycles.cpp    (macOS, via the private kperf framework)
+// linuxcycles.cpp (Linux, via perf_event_open)
+//Both fill PerformanceCounters identically: [0] cycles, [1] retired,
+// [2..9] the eight configurable events given in eventsArray.
 void setup_performance_counters(bool fUsePCore, int const* eventsArray);
 extern PerformanceCounters get_counters(void);
 
+//What setup_performance_counters() was last asked for: the core (kUsePCore
+// before it has been called), and whether that was fUsePCore and exactly
+// eventsArray (NULL for the default events), in which case calling it again
+// would only redo what it did. Both backends call
+// note_counter_configuration() on every setup.
+void note_counter_configuration(bool fUsePCore, int const* eventsArray);
+bool configured_on_pcore(void);
+bool counters_configured_for(bool fUsePCore, int const* eventsArray);
+
+//True if get_counters() reads the counters directly from user mode (tens of
+// cycles) rather than via the kernel (~1us), so callers can afford much
+// smaller inner counts.
+bool fast_counter_reads_available(void);
+
+//Whether configurable counter c (valuesC()[c]) is counting the event the
+// last setup asked of it. On Linux an event perf cannot open is left out
+// of the group, and its counter reads 0; on macOS kperf sets up all the
+// counters or none, so this is always true.
+bool configurable_counter_live(int c);
+//.............................................................................
+
+//Every delta of two get_counters() calls includes part of the cost of the
+// calls themselves, in every lane (cycles, retired, and whatever the eight
+// configurable counters count, eg loads). Both backends measure this, for
+// the current configuration, at the end of setup_performance_counters() by
+// taking many deltas around an empty region.
+//CycleAverager and PerformAssemblyProbe subtract the min (so we never
+// over-correct) from each delta when kSubtractCounterOverhead is set.
+static auto const kSubtractCounterOverhead=true;
+struct CounterOverhead{
+	PerformanceCounters min, median, p90, max;
+};
+void calibrate_counter_overhead(void);
+CounterOverhead const& counter_read_overhead(void);
+//Whether the retired instructions counter is counting, as of the last
+// calibration.
+bool retired_counter_live(void);
+void print_counter_overhead(void);
+
 //=============================================================================
 
 //The above is the basic stuff and can probably be reimagined in C without drama.
 //Below we use C++ magic to create convenience syntax for various common
 // operations.
 
+//Needs PerformanceCounters, above; needed by CycleAverager, below.
+#include "statistics.h"
+#include "corePlacement.h"
+#include "timebase.h"
+
 static int kCaptureAllCounters=0;
+
+//The result of running a probe under a CounterSchedule (see counterEvents.h):
+// the fixed counters, and one value per requested event, in the order the
+// events were requested.
+struct CounterSchedule;
+struct ScheduledCounters{
+	double         cycles, retireds, realtime_ns;
+	vector<double> events;	//NaN for one that was not counted
+};
+
 struct CycleAverager{
 	static uint const kInnerCount=1;
 	static uint const kOuterCount=5;
+	//kMedian is robust to the occasional interrupt or frequency change that
+	// spoils kMean, without kMin's bias toward lucky samples.
 	enum AveragingMethod{
-		kMean, kMin, kMax
+		kMean, kMin, kMax, kMedian
 	};
 	
 	uint            innerCount, outerCount;
 	AveragingMethod averagingMethod;
+	//After each call, the result before counter overhead was subtracted,
+	// (per inner iteration, with the same averaging).
+	PerformanceCounters raw;
+	//After each call, the full distribution of the (corrected, per inner
+	// iteration) outer samples: look here to judge how noisy a point was.
+	CounterStatistics   stats;
+
+	//Adaptive repetition, off unless targetRelativeCI>0.
+	//outerCount samples are always taken; after that we keep adding samples
+	// until the 95% confidence interval of the mean cycles is within
+	// +-targetRelativeCI of it, or timeBudgetNs has been spent on this
+	// point (0 means no budget), or we reach maxOuterCount.
+	//The convergence test is on the mean even for kMin/kMedian; if the mean
+	// has settled, so has everything else.
+	double          targetRelativeCI=0;
+	double          timeBudgetNs=0;
+	uint            maxOuterCount=1000;
+	CycleAverager& Adaptive(double targetRelativeCI, double timeBudgetNs,
+	  uint maxOuterCount=1000){
+		this->targetRelativeCI=targetRelativeCI;
+		this->timeBudgetNs    =timeBudgetNs;
+		this->maxOuterCount   =maxOuterCount;
+		return *this;
+	}
+	//After each call: how many samples were discarded because we were
+	// moved off our core (see corePlacement.h).
+	uint            numMigratedSamples=0;
+	//After each call: how many samples ran noticeably below the peak
+	// frequency (see timebase.h), and the mean frequency, in GHz.
+	uint            numFrequencyDrops=0;
+	inline double measuredGHz() const{
+		auto mean=stats.Mean();
+		return (mean.realtime_ns>0)? mean.cycles()/mean.realtime_ns: 0;
+	}
+	//After each call: the precision actually achieved, and at what cost.
+	inline double achievedRelativeCI() const{return stats.RelativeCI95(0);}
+	inline uint64_t numSamples() const{return stats.n;}
 
 	CycleAverager(uint innerCount=kInnerCount, uint outerCount=kOuterCount,
 	  AveragingMethod averagingMethod=kMin):
 	    innerCount(innerCount), outerCount(outerCount),
 	    averagingMethod(averagingMethod){};
 	pair<double, double> operator()( std::function<void(void)> probe );
+	PerformanceCounters Sample( std::function<void(void)> const& probe );
 	pair<counters_t, double> operator()( std::function<void(void)> probe, int );
+	//Reruns the probe once per pass of the schedule, reconfiguring the
+	// counters (on the core they were last set up on) for each pass they
+	// are not already set up for. Implemented in counterEvents.cpp.
+	ScheduledCounters operator()( std::function<void(void)> probe,
+	  CounterSchedule const& schedule );
+
+	//The zero-overhead variants: the probe (typically a lambda) is a template
+	// parameter, so it is inlined into the timed loop instead of being called
+	// through std::function, and the inner loop is unrolled kUnroll times.
+	//Nothing between the two get_counters() calls allocates or dispatches
+	// indirectly. (ProbeHarness.cpp measures the difference.)
+	//	cycleAverager.Inline<8>([&](){ ... });
+	template <uint kUnroll=1, typename Probe>
+	  pair<double, double> Inline( Probe const& probe ){
+		auto result=SampleT<kUnroll>(probe);
+		return pair(result.cycles(), result.realtime_ns);
+	}
+	template <uint kUnroll=1, typename Probe>
+	  pair<counters_t, double> Inline( Probe const& probe, int ){
+		auto result=SampleT<kUnroll>(probe);
+		return pair(result.valuesA, result.realtime_ns);
+	}
+	//The loop shared by everything above.
+	template <uint kUnroll, typename Probe>
+	  PerformanceCounters SampleT( Probe const& probe );
+
+	PerformanceCounters Summarize(CounterStatistics const& stats) const{
+		switch(averagingMethod){
+			case kMean:   return stats.Mean();
+			case kMin:    return stats.Min();
+			case kMax:    return stats.Max();
+			case kMedian: return stats.Median();
+			default: 	  exit(1); //Fixme
+		}
+	}
 };
 
 
+//Expands to kUnroll back to back copies of probe().
+template <uint kUnroll, typename Probe>
+  static inline void RepeatProbe(Probe const& probe){
+	[&]<size_t... I>(std::index_sequence<I...>){
+		( ((void)I, probe()), ... );
+	}(std::make_index_sequence<kUnroll>{});
+}
+
+//This is a template so that it can be instantiated with the probe inlined;
+// Sample() instantiates it with std::function.
+template <uint kUnroll, typename Probe>
+  PerformanceCounters CycleAverager::SampleT(Probe const& probe){
+	static_assert(kUnroll>=1);
+	auto outerCount=this->outerCount;
+	auto innerCount=this->innerCount;
+	PerformanceCounters pc;
+	CounterStatistics   rawStats;
+	stats.Reset();
+
+	//Execute once to set up caches, predictors, etc.
+	reassert_core_placement();
+			probe();
+
+	numMigratedSamples=0;
+	numFrequencyDrops =0;
+	auto startNs=get_counters().realtime_ns;
+	for(uint i=0; ; i++){
+		//Stop when we have enough samples, or (adaptive) enough precision.
+		if(i>=outerCount){
+			if(targetRelativeCI<=0 || i>=maxOuterCount){break;}
+			if(stats.RelativeCI95(0)<=targetRelativeCI){break;}
+			if( timeBudgetNs>0
+			  && get_counters().realtime_ns-startNs>=timeBudgetNs ){break;}
+		}
+
+	reassert_core_placement();
+		pc=get_counters();
+
+			uint j=0;
+			for(; j+kUnroll<=innerCount; j+=kUnroll){
+				RepeatProbe<kUnroll>(probe);
+			}
+			for(; j<innerCount; j++){
+				probe();
+			}
+
+		pc-=get_counters();
+		//A sample that migrated measured some other core (and the
+		// migration); drop it and take another, within reason.
+		if( !core_placement_held() && numMigratedSamples++<outerCount ){
+			i--;
+			continue;
+		}
+		//Kept, but flagged: the cycles are real, they just are not cycles
+		// at the frequency the other samples ran at.
+		if( !note_core_frequency(pc.cycles(), pc.realtime_ns) ){
+			numFrequencyDrops++;
+		}
+		pc/=innerCount;
+		rawStats.Add(pc);
+		if(kSubtractCounterOverhead){
+			auto overhead=counter_read_overhead().min;
+			overhead/=innerCount;
+			pc.RemoveOverhead(overhead);
+		}
+		stats.Add(pc);
+	}
+	raw=Summarize(rawStats);
+	return Summarize(stats);
+}
+//.............................................................................
+
 typedef	vector<size_t> LengthsVector;
 typedef vector< pair<double,double> > CyclesVector;
 typedef vector< pair<counters_t,double> > CyclesVectorB;
@@ -232,19 +451,7 @@ inline std::ostream& operator<<(std::ostream& os, LengthCyclesVector const& lcv)
 }*/
 //=============================================================================
 
-//From /usr/share/kpep/a14.plist
-#define MAP_LDST_UOP 		125		//
-#define LD_UNIT_UOP			166		//
-#define INST_LDST			155		//5
-#define L1D_CACHE_MISS_LD	163
-#define LD_NT_UOP			230
-
-#define ST_UNIT_UOP			167
-#define L1D_CACHE_MISS_ST	162
-#define L1D_CACHE_WRITEBACK 168
-#define ST_NT_UOP			229
-#define ST_MEMORY_ORDER_VIOLATION_NONSPEC 196 //5,4,3
-
-
+//Counter event codes live in counterEvents.cpp (or a loaded event database);
+// ask for them by name.
 
 #endif
@@ -14,18 +14,14 @@
 	
 	The code is on its third refactorization; probably not the last.
 	The idea/hope, after many different experiences, is that when an
-	experiment is performed, *all* changes can be limited to
-	- the construction of a new probeType enum
+	experiment is performed, *all* changes can be limited to one file
+	(ProbeAssembly.cpp, or a new one like it):
 	- the inheritance of an APD from the base AssemblyProbeData
-	- filling in the APD properties, the Builder code that creates the
-	assembly for this probe, and the desired probe printout.
-	
-	At the very least, if anyone wants to improve it, I think something that's
-	required is a better (per probe) way to configure the performance monitor
-	for that particular probe.
-	I've been doing it in an ad hoc way by changing the global settings each time
-	I change a test, which is good enough for current purposes, but hardly ideal
-	long term.
+	- the Builder code that creates the assembly for this probe (written
+	with aarch64Encoder.h), and the desired probe printout
+	- a ProbeRegistration giving its name, its probeCount sweep, the data
+	buffer it needs, and the counter events it wants (see Probes.h).
+	Then run it with --probe <name>.
 	
 	Hopefully you can get away with, one time, looking at the generic code
 	flow (buffer allocations, setting up JIT, setting up performanmce
@@ -35,98 +31,263 @@
 
 #include <iostream>
 #include <cfloat>
-#include <libkern/OSCacheControl.h>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <optional>
+#include <sys/stat.h>
 using namespace std;
 
 #include "m1cycles.h"
+#include "counterEvents.h"
 #include "assemblyBuffer.h"
+#include "aarch64Encoder.h"
+#include "aarch64Disassembler.h"
 #include "dataBuffer.h"
 #include "Probes.h"
+#include "assemblyProbe.h"
+#include "probeScript.h"
+#include "kneeDetection.h"
 
-//.............................................................................
-
-typedef uint32_t Instruction;
-struct AssemblyProbeData{
-	int lo, hi, stride;
-	void* dataBuffer;
-	
-	AssemblyProbeData(int hi, int stride=1, void* dataBuffer=NULL):
-	  lo(0), hi(hi), stride(stride), dataBuffer(dataBuffer){};
-	AssemblyProbeData(int lo, int hi, int stride=1, void* dataBuffer=NULL):
-	  lo(lo), hi(hi), stride(stride), dataBuffer(dataBuffer){};
-	AssemblyProbeData(){};
-	
-	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)=0;
-	virtual void print(int probeCount, PerformanceCounters& min, PerformanceCounters& mean, PerformanceCounters& max);
-};
+//The code around each probe is written in the encoder's mnemonics.
+using namespace A64;
 
-struct ROBSize_NOPs_APD:AssemblyProbeData{
-	using AssemblyProbeData::AssemblyProbeData;
-	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
-};
+//.............................................................................
 
-struct ZCL1_Registers_APD:AssemblyProbeData{
-	using AssemblyProbeData::AssemblyProbeData;
-	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
-};
-struct ZCL2_Stack_APD:AssemblyProbeData{
-	using AssemblyProbeData::AssemblyProbeData;
-	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
-};
-struct ZCL3_Stride_APD:AssemblyProbeData{
-	using AssemblyProbeData::AssemblyProbeData;
-	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+void PerformAssemblyProbe(ProbeParameters& pp, CodeBuffer& code);
+//Returns the number of instructions built; if sections is given, notes
+// where each part of the buffer begins (for --dump).
+uint BuildAssemblyProbe_Wrapper(
+  ProbeParameters& pp, AssemblyProbeData& apd, CodeBuffer& code,
+  vector<ListingSection>* sections=nullptr);
+
+//Set by --dump: -1 to run probes normally, 0 for the first probeCount.
+static int g_dumpProbeCount=-1;
+//Set by --code-offset and --code-offsets: each assembly probe's sweep is
+// run once with its loop at each of these (see ProbeParameters).
+static vector<int> g_codeOffsets={-1};
+//Set by --knees and --knee-search (see kneeDetection.h).
+static bool g_fPrintKnees=false;
+static bool g_fKneeSearch=false;
+
+//A sweep over probeCount can extend the previous point's code rather than
+// rebuild it (see AssemblyProbeExtend()); false always rebuilds.
+static auto const kIncrementalRebuild=true;
+
+//What BuildAssemblyProbe_Wrapper() last built.
+struct LastAssemblyBuild{
+	AssemblyProbeData* apd;
+	Instruction*       ibuf;
+	uint               probeCount;
+	uint               bodyEnd;		//where the loop-back starts
+	uint               loopStart;	//where the loop-back branches to
+	int                codeOffset;
+	uint               entryInstructions;	//run before the loop, per call
 };
+static LastAssemblyBuild g_lastBuild={nullptr, nullptr, 0, 0, 0, -1, 0};
 
-struct TLB_NumSimultaneousLookups_APD:AssemblyProbeData{
-	using AssemblyProbeData::AssemblyProbeData;
-	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
-};
+//=============================================================================
 
-struct L1D_TestWayPredictor_APD:AssemblyProbeData{
-	using AssemblyProbeData::AssemblyProbeData;
-	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
-};
+int main(int argc, const char * argv[]) {
 
+	//Which probe to run, unless --probe or --script says otherwise.
+	auto const kDefaultProbe="l1d-way-predictor";
+		//"tlb-simultaneous-lookups"; //"zcl3-stride"; //"l1-cache-structure";
+	//"stream"; //"l1-cache-line-length"; //"memory-bandwidth"; //"rob-nops";
+	vector<string> probeNames, scriptProbeNames;
+	auto fList=false;
+	vector<size_t> latencyStrides;
+	size_t latencyPointerOffset=0;
+	auto fLatencyPointerOffset=false;
+
+	//Command line options:
+	// --probe <name>   a probe to run (may be repeated)
+	// --script <file>  load the assembly probes described in file (see
+	//                  probeScript.h), and run them all unless --probe
+	//                  picks some
+	// --list           print the probes and exit
+	// --events <file>  counter event database, a kpep .plist (macOS, see
+	//                  /usr/share/kpep/) or a Linux pmu-events .json
+	// --list-events    print the counter events we know about and exit
+	// --cpu <n>        (Linux) pin to cpu n rather than the biggest core
+	// --topology       print the cpu topology and exit
+	// --dump [count]   print an assembly probe as built (for probeCount
+	//                  count, default the first), instead of running it
+	// --code-offset <bytes>  start assembly probes' loops this many bytes
+	//                  past a 16KiB boundary (a multiple of 4), eg 60 to
+	//                  end a fetch block, 16352 to cross a page 32B in
+	// --code-offsets <lo> <hi> <step>  sweep each assembly probe at every
+	//                  offset from lo to hi
+	// --stride <bytes> a node size for latency-stride to chase through (may
+	//                  be repeated), in place of its built in list
+	// --strides <lo> <hi> <step>  every node size from lo to hi
+	// --pointer-offset <bytes>  where in each node the next pointer sits
+	// --chain-seed <n> seed for the latency probes' random chains
+	// --chain-images <dir>  load latency chains saved in dir, and save
+	//                  those that are not (see chainImage.h)
+	// --latency-pages <p>  back latency chains with default, base, thp
+	//                  (transparent huge), 2m or 1g (hugetlb) pages
+	// --knees          after each assembly probe's sweep, print its knees
+	// --knee-search    sweep coarse to fine around the knees, rather than
+	//                  every probeCount (implies --knees)
+	for(auto i=1; i<argc; i++){
+		string arg=argv[i];
+		if(arg=="--probe" && i+1<argc){
+			probeNames.push_back(argv[++i]);
+		}else if(arg=="--script" && i+1<argc){
+			if( !LoadProbeScript(argv[++i], scriptProbeNames) ){exit(1);}
+		}else if(arg=="--list"){
+			fList=true;
+		}else if(arg=="--events" && i+1<argc){
+			if( !LoadCounterEvents(argv[++i]) ){exit(1);}
+		}else if(arg=="--list-events"){
+			PrintCounterEvents();
+			exit(0);
+		}else if(arg=="--cpu" && i+1<argc){
+			select_cpu( atoi(argv[++i]) );
+		}else if(arg=="--topology"){
+			print_cpu_topology();
+			exit(0);
+		}else if(arg=="--code-offset" && i+1<argc){
+			g_codeOffsets={ atoi(argv[++i]) };
+		}else if(arg=="--code-offsets" && i+3<argc){
+			auto lo=atoi(argv[i+1]), hi=atoi(argv[i+2]), step=atoi(argv[i+3]);
+			i+=3;
+			if(step<=0){
+				cout<<"--code-offsets step must be positive"<<endl;
+				exit(1);
+			}
+			g_codeOffsets.clear();
+			for(auto offset=lo; offset<=hi; offset+=step){g_codeOffsets.push_back(offset);}
+		}else if(arg=="--stride" && i+1<argc){
+			latencyStrides.push_back( atol(argv[++i]) );
+		}else if(arg=="--strides" && i+3<argc){
+			auto lo=atol(argv[i+1]), hi=atol(argv[i+2]), step=atol(argv[i+3]);
+			i+=3;
+			if(step<=0){
+				cout<<"--strides step must be positive"<<endl;
+				exit(1);
+			}
+			for(auto stride=lo; stride<=hi; stride+=step){latencyStrides.push_back(stride);}
+		}else if(arg=="--pointer-offset" && i+1<argc){
+			latencyPointerOffset=atol(argv[++i]);
+			fLatencyPointerOffset=true;
+		}else if(arg=="--chain-seed" && i+1<argc){
+			SetLatencyChainSeed( strtoull(argv[++i], NULL, 0) );
+		}else if(arg=="--chain-images" && i+1<argc){
+			string directory=argv[++i];
+			struct stat st;
+			if( stat(directory.c_str(), &st)!=0 || !S_ISDIR(st.st_mode) ){
+				cout<<"--chain-images "<<directory<<" is not a directory"<<endl;
+				exit(1);
+			}
+			SetLatencyChainImages(directory);
+		}else if(arg=="--latency-pages" && i+1<argc){
+			if( !SetLatencyPages(argv[++i]) ){
+				cout<<"--latency-pages "<<argv[i]
+				  <<" is not one of default, base, thp, 2m, 1g"<<endl;
+				exit(1);
+			}
+		}else if(arg=="--knees"){
+			g_fPrintKnees=true;
+		}else if(arg=="--knee-search"){
+			g_fPrintKnees=g_fKneeSearch=true;
+		}else if(arg=="--dump"){
+			g_dumpProbeCount=0;
+			if( i+1<argc && isdigit(argv[i+1][0]) ){
+				g_dumpProbeCount=atoi(argv[++i]);
+			}
+		}else{
+			cout<<"Unknown option "<<arg<<endl;
+			exit(1);
+		}
+	}
 
-void PerformAssemblyProbe(ProbeParameters& pp, Instruction* ibuf);
-AssemblyProbeData&
-  ConstructAssemblyProbeData(ProbeParameters& pp);
-void BuildAssemblyProbe_Wrapper(
-  ProbeParameters& pp, AssemblyProbeData& apd, Instruction* ibuf);
+	if(fList){
+		PrintProbes();
+		exit(0);
+	}
+	for(auto offset:g_codeOffsets){
+		if( offset<-1 || offset>=int(kCodePlacementBytes) || (offset>0 && offset%4!=0) ){
+			cout<<"Code offset "<<offset<<" is not a multiple of 4 in 0.."
+			    <<kCodePlacementBytes-4<<endl;
+			exit(1);
+		}
+	}
 
-//=============================================================================
+	if( !latencyStrides.empty() || fLatencyPointerOffset ){
+		if( latencyStrides.empty() ){
+			cout<<"--pointer-offset needs --stride or --strides"<<endl;
+			exit(1);
+		}
+		for(auto stride:latencyStrides){
+			if( stride<sizeof(void*) || stride>kMaxLatencyStrideBytes
+			 || latencyPointerOffset+sizeof(void*)>stride ){
+				cout<<"Stride "<<stride<<" must be "<<sizeof(void*)<<".."
+				    <<kMaxLatencyStrideBytes<<" bytes, and hold a pointer at +"
+				    <<latencyPointerOffset<<endl;
+				exit(1);
+			}
+		}
+		SetLatencyStrides(latencyStrides, latencyPointerOffset);
+	}
 
-int main(int argc, const char * argv[]) {
+	if( probeNames.empty() ){probeNames=scriptProbeNames;}
+	if( probeNames.empty() ){probeNames.push_back(kDefaultProbe);}
+	vector<ProbeDefinition const*> probes;
+	size_t dataBytes=0;
+	for(auto& name:probeNames){
+		auto probe=FindProbe(name);
+		if(!probe){
+			cout<<"Unknown probe "<<name<<" (--list shows them)"<<endl;
+			exit(1);
+		}
+		probes.push_back(probe);
+		dataBytes=max(dataBytes, probe->dataBytes);
+	}
 
-	auto probeType=kL1D_TestWayPredictor_Probe;
-		//kTLB_NumSimultaneousLookups_Probe; //kZCL3_Stride_Probe; //kL1CacheStructure_Probe;
-	//kStream_Probe; //L1CacheLineLength_Probe; //kMemoryBandwidth_Probe;// kStream_Probe; //kROBSize_NOPs;
-	
 	setup_performance_counters(kUsePCore, NULL);
-	auto dataBuffer=AllocateDataBuffer();
-	auto pp=ProbeParameters(probeType, dataBuffer);
-
-	//The setup is different enough between C and assembly, but common enough
-	// to each case, that it makes sense to split the probes in this large way.
-	if(probeType<kAssemblyProbes){
-		PerformCProbe(pp);
-//When running C probes you want to compile as Release (for obvious reasons)!
-	}else{
-		auto instructionBuffer
-		  =reinterpret_cast<Instruction*>( CreateAssemblyBuffer() );
-		if( reinterpret_cast<size_t>(instructionBuffer)==-1 ){
-			cout<<"You do not have permission to JIT code.\n"
-			<<"Ensure that you are running/debugging as root.\n"
-			<<"Ensure that you have removed the hardened runtime fromm XCcode Entitlements!\n";
+	print_timebase();
+	print_counter_overhead();
+
+	//The assembly probes share one code buffer, and one data buffer, big
+	// enough for any of them.
+	auto dataBuffer=(dataBytes>0)? AllocateDataBuffer(dataBytes): nullptr;
+	CodeBuffer code;
+	auto const
+	  hLine="---------------------------------------------------------------";
+
+	for(auto probe:probes){
+		if(probes.size()>1){
+			cout<<hLine<<endl<<probe->name<<endl;
 		}
 
-		PerformAssemblyProbe(pp, instructionBuffer);
+		//The setup is different enough between C and assembly, but common enough
+		// to each case, that it makes sense to split the probes in this large way.
+		if(probe->perform){
+			probe->perform();
+//When running C probes you want to compile as Release (for obvious reasons)!
+		}else{
+			//Each probe sees its buffer as freshly zeroed.
+			if(probe->dataBytes>0){memset(dataBuffer, 0, probe->dataBytes);}
+			auto pp=ProbeParameters(probe, (probe->dataBytes>0)? dataBuffer: nullptr);
+			if( !code.IsValid() ){
+				code=AcquireCodeBuffer();
+				if( !code.IsValid() ){exit(1);}
+			}
+
+			for(auto offset:g_codeOffsets){
+				if(g_codeOffsets.size()>1){cout<<"code offset "<<offset<<endl;}
+				pp.codeOffset=offset;
+				PerformAssemblyProbe(pp, code);
+			}
 //When running Asm probes you want to compile as Debug.
 //XXX I'm not sure why, something is presumably compiled all the way down to a NOP by
 // the compiler, the tests are not run, and the timings are basically random
 //INVESTIGATE AND FIX LATER.
+		}
 	}
+	if( code.IsValid() ){ReleaseCodeBuffer(code);}
 	return 0;
 }
 //=============================================================================
@@ -137,13 +298,24 @@ int main(int argc, const char * argv[]) {
 // overkill!
 static const int kInnerCount8192=8192/2;
 static const int kOuterCount64=64/2;
+//Since they are overkill, we stop taking outer samples as soon as (after a
+// minimum of kMinOuterCount8) the mean cycles is known to +-kTargetRelativeCI;
+// kOuterCount64 becomes the cap for the occasional noisy point.
+static const int    kMinOuterCount8  =8;
+static const double kTargetRelativeCI=0.002;
+//Retired instructions per trip may differ from those built by this much
+// (plus half an instruction) before a point is flagged. The counters are
+// exact; this is for the call and counter read overheads that are left
+// after subtracting the minimum.
+static const double kRetiredTolerance=0.02;
+static const uint   kLoopBackInstructions=2;
 
 static uint BuildPrologue(Instruction* ibuf);
 static uint BuildEpilogue(Instruction* ibuf);
 static uint BuildOverwriteRegisters(Instruction* ibuf);
 static uint BuildReturn(Instruction* ibuf);
 
-void PerformAssemblyProbe(ProbeParameters& pp, Instruction* ibuf){
+void PerformAssemblyProbe(ProbeParameters& pp, CodeBuffer& code){
 /*
 	The usual loop structure is
 	- the probe is a small amount of code (a few instructions, no looping or such)
@@ -172,29 +344,59 @@ void PerformAssemblyProbe(ProbeParameters& pp, Instruction* ibuf){
 	}
 
 */
-	AssemblyProbeData& apd=ConstructAssemblyProbeData(pp);
+	auto& probe=*pp.probe;
+	AssemblyProbeData& apd=probe.construct();
+
+	if(g_dumpProbeCount>=0){
+		pp.probeCount=(g_dumpProbeCount>0)? g_dumpProbeCount: probe.lo;
+		vector<ListingSection> sections;
+		auto count=BuildAssemblyProbe_Wrapper(pp, apd, code, &sections);
+		cout<<"Probe "<<probe.name<<", probeCount "<<pp.probeCount
+		    <<": "<<count<<" instructions"<<endl;
+		DumpInstructions(code.exec, count, sections);
+		return;
+	}
+
+	//Count the events the probe asked for, if we know them. Only one pass
+	// fits in this loop; anything the schedule pushed to a later pass, or
+	// whose counter could not be set up, is reported and left out.
+	vector<string> eventNames, headings;
+	for(auto i=0; i<probe.events.size(); i++){
+		if( !FindCounterEvent(probe.events[i]) ){
+			cout<<"Skipping unknown counter event "<<probe.events[i]<<endl;
+			continue;
+		}
+		eventNames.push_back(probe.events[i]);
+		headings.push_back( (i<probe.headings.size())?
+		  probe.headings[i]: probe.events[i] );
+	}
+	optional<CounterSchedule> schedule;
+	if( !eventNames.empty() ){
+		schedule.emplace(eventNames, headings);
+		setup_performance_counters(kUsePCore, &schedule->passes[0].eventsArray[0]);
+		cout<<"count\tcycles";
+		for(auto i=0; i<schedule->events.size(); i++){
+			auto& placement=schedule->placements[i];
+			if(placement.pass!=0){
+				cerr<<"Not counting "<<schedule->events[i]->name
+				    <<": it does not fit with the others"<<endl;
+			}else if( !configurable_counter_live(placement.counter) ){
+				cerr<<"Not counting "<<schedule->events[i]->name
+				    <<": its counter could not be set up"<<endl;
+			}else{
+				cout<<"\t"<<schedule->headings[i];
+			}
+		}
+		cout<<"\tCI95\tn\toutliers"<<endl;
+		apd.schedule=&*schedule;
+	}
 		
-	for(int probeCount=apd.lo; probeCount<=apd.hi; probeCount+=apd.stride){
+	//Measures and prints one point of the sweep; returns its cycles.
+	auto MeasurePoint=[&](int probeCount){
 		pp.probeCount=probeCount;
-		BuildAssemblyProbe_Wrapper(pp, apd, ibuf);
-		typedef void (*routine_t)(uint64_t, void*);
-		auto routine=reinterpret_cast<routine_t>(ibuf);
-
-		//Call one time to warm the caches.
-		routine(kInnerCount8192, pp.dataBuffer);
-
-		PerformanceCounters pc, min(DBL_MAX), max(0.0), sum(0.0);
-
-		for(int i=0; i<kOuterCount64; i++){
-			pc=get_counters();
-				routine(kInnerCount8192, pp.dataBuffer);
-			pc-=get_counters();
-			pc/=kInnerCount8192;
-			min=min.Min(pc);
-			max=max.Max(pc);
-			sum+=pc;
-		}
-		sum/=kOuterCount64;
+		auto min=MeasureAssemblyProbe(pp, apd, code);
+		auto sum=apd.stats.Mean();
+		auto max=apd.stats.Max();
 
 		//Experience shows us that these three values are all usually pretty close;
 		//for most purposes min or sum (ie mean) are the best choice; but for
@@ -213,12 +415,115 @@ void PerformAssemblyProbe(ProbeParameters& pp, Instruction* ibuf){
 		//cout<<probeCount<<"\t"<<max;
 		
 		apd.print(probeCount, min, sum, max);
+		return min.cycles();
+	};
+
+	vector<SweepPoint> series;
+	auto numMismatched=0;
+	auto MeasureCheckedPoint=[&](int probeCount){
+		auto cycles=MeasurePoint(probeCount);
+		//Under the row it qualifies.
+		if(apd.fRetiredMismatch){
+			cout<<"\t^ retired "<<setprecision(1)<<apd.stats.Min().retireds()
+			    <<" instructions per trip, built "<<apd.expectedRetireds<<endl;
+			numMismatched++;
+		}
+		return cycles;
+	};
+	if(g_fKneeSearch){
+		series=SearchForKnees(probe.lo, probe.hi, probe.stride, MeasureCheckedPoint);
+	}else{
+		for(int probeCount=probe.lo; probeCount<=probe.hi; probeCount+=probe.stride){
+			series.push_back( SweepPoint{double(probeCount), MeasureCheckedPoint(probeCount)} );
+		}
+	}
+	if(numMismatched>0){
+		cout<<"WARNING: "<<numMismatched<<" of "<<series.size()
+		    <<" points did not retire the instructions built; do not use them"<<endl;
+	}
+	if(g_fPrintKnees){PrintKnees( FindKnees(series) );}
+
+	//Leave the counters as the next probe expects to find them.
+	if(apd.schedule){
+		apd.schedule=nullptr;
+		setup_performance_counters(kUsePCore, NULL);
 	}
 }
+//.............................................................................
+
+//Compares the retired instructions per trip (min, as measured) with what
+// was built. A probe that retired less than the loop-back never ran (the
+// failure once seen under Release builds, that gave random timings), and
+// nothing it measured means anything.
+//That is only known if the retired counter is counting; if it is not
+// (it failed to open, or kperf or perf could not be set up), it reads 0
+// for every probe, so this warns, once, and checks nothing.
+static void CheckRetiredInstructions(ProbeParameters& pp, AssemblyProbeData& apd,
+  PerformanceCounters& min){
+	apd.expectedRetireds=apd.loopInstructions
+	  +double(apd.callInstructions)/kInnerCount8192;
+	apd.fRetiredMismatch=false;
+	if( !retired_counter_live() ){
+		static auto warned=false;
+		if(!warned){
+			printf("Retired instructions are not being counted; "
+			  "not checking them against what probes built\n");
+			warned=true;
+		}
+		return;
+	}
+	auto retired=min.retireds();
+	if( retired<kLoopBackInstructions*(1-kRetiredTolerance) ){
+		printf("Probe %s, probeCount %u, retired %.2f instructions per trip, "
+		  "built %.2f: it did not run\n", pp.probe? pp.probe->name.c_str(): "?",
+		  pp.probeCount, retired, apd.expectedRetireds);
+		exit(1);
+	}
+	apd.fRetiredMismatch=apd.fStraightLine
+	  && fabs(retired-apd.expectedRetireds)>0.5+kRetiredTolerance*apd.expectedRetireds;
+}
+//.............................................................................
+
+PerformanceCounters MeasureAssemblyProbe(
+  ProbeParameters& pp, AssemblyProbeData& apd, CodeBuffer& code){
+	BuildAssemblyProbe_Wrapper(pp, apd, code);
+	typedef void (*routine_t)(uint64_t, void*);
+	auto routine=reinterpret_cast<routine_t>(code.exec);
+
+	//Call one time to warm the caches.
+	routine(kInnerCount8192, pp.dataBuffer);
+
+	PerformanceCounters pc;
+	apd.stats.Reset();
+
+	auto numMigrated=0;
+	for(int i=0; i<kOuterCount64; i++){
+		if( i>=kMinOuterCount8
+		  && apd.stats.RelativeCI95(0)<=kTargetRelativeCI ){break;}
+		reassert_core_placement();
+		pc=get_counters();
+			routine(kInnerCount8192, pp.dataBuffer);
+		pc-=get_counters();
+		//Drop (and redo) samples during which we were moved.
+		if( !core_placement_held() && numMigrated++<kOuterCount64 ){
+			i--;
+			continue;
+		}
+		if(kSubtractCounterOverhead){
+			pc.RemoveOverhead(counter_read_overhead().min);
+		}
+		pc/=kInnerCount8192;
+		apd.stats.Add(pc);
+	}
+	auto min=apd.stats.Min();
+	CheckRetiredInstructions(pp, apd, min);
+	return min;
+}
 //-----------------------------------------------------------------------------
 
-void BuildAssemblyProbe_Wrapper(
-  ProbeParameters& pp, AssemblyProbeData& apd, Instruction* ibuf){
+uint BuildAssemblyProbe_Wrapper(
+  ProbeParameters& pp, AssemblyProbeData& apd, CodeBuffer& code,
+  vector<ListingSection>* sections){
 
 /*
 	We wish to create a block of instructions of the following form:
@@ -251,36 +556,91 @@ void BuildAssemblyProbe_Wrapper(
 ??	d0 = legimate double value (usually 1.0) //maybe I should replace with fmov #?
  */
 
+	//We build through the write view; branches are all relative, so the
+	// code runs unchanged from the exec view.
+	auto ibuf=code.write;
+	pp.execOffset=reinterpret_cast<std::byte*>(code.exec)
+	  -reinterpret_cast<std::byte*>(code.write);
+
 	//Various indices into the instruction buffer.
-	uint o=0, start; int offset;
-	
-	/* See https://developer.apple.com/documentation/apple-silicon/porting-just-in-time-compilers-to-apple-silicon
-	   for details of these JIT wrapper calls.
-	*/
+	//first is the first instruction (re)written this time.
+	//entry is how many instructions run before the loop.
+	uint o=0, first=0, entry=0;
+	Label loop;
+	auto Section=[&](char const* name){
+		if(sections){sections->push_back( ListingSection{o, name} );}
+	};
+
 	//Give us permissions to write to the asm buffer.
-	pthread_jit_write_protect_np(false);
+	BeginCodeWrite(code);
+
+	//If we last built this probe, in this buffer, for a smaller probeCount,
+	// just append to the body and rewrite what follows it.
+	auto& last=g_lastBuild;
+	auto fExtended=false;
+	if( kIncrementalRebuild && sections==nullptr
+	  && last.apd==&apd && last.ibuf==ibuf && last.codeOffset==pp.codeOffset
+	  && pp.probeCount>=last.probeCount ){
+		auto count=apd.AssemblyProbeExtend(ibuf+last.bodyEnd, last.probeCount, pp);
+		if(count>=0){
+			first=last.bodyEnd;
+			o    =last.bodyEnd+count;
+			bind(loop, ibuf, last.loopStart);
+			entry=last.entryInstructions;
+			fExtended=true;
+		}
+	}
 
-	//Fill the buffer with prologue.
-	o+=BuildPrologue(ibuf+o);
-	o+=BuildOverwriteRegisters(ibuf+o);
-	start=o;
+	if(!fExtended){
+		//Fill the buffer with prologue.
+		Section("prologue");
+		o+=BuildPrologue(ibuf+o);
+		Section("register clear");
+		o+=BuildOverwriteRegisters(ibuf+o);
+		entry=o;
+		if(pp.codeOffset>=0){
+			//Branch over NOPs to the placement asked for. What matters is
+			// where the code is fetched from, so place by the exec view.
+			Section("placement padding");
+			Label placed;
+			auto branch=b(placed, o);
+			ibuf[o] = branch;
+			o++;
+			entry++;
+			auto address=reinterpret_cast<uintptr_t>(code.exec+o);
+			o+=( pp.codeOffset-address%kCodePlacementBytes+kCodePlacementBytes )
+			  %kCodePlacementBytes/sizeof(Instruction);
+			for(auto i=placed.fixups[0]+1; i<o; i++){ibuf[i] = nop();}
+			bind(placed, ibuf, o);
+		}
+		bind(loop, ibuf, o);
 
-		//Where the magic happens!
-		o+=apd.AssemblyProbeBuild(ibuf+o, pp);
+			//Where the magic happens!
+			Section("probe body");
+			o+=apd.AssemblyProbeBuild(ibuf+o, pp);
+	}
+	last={&apd, ibuf, pp.probeCount, o, uint(loop.position), pp.codeOffset, entry};
 
 	//Fill the buffer with loopback (every probe needs to be repeated many times
 	// to capture statistics, so we make that inner loop code common.
-	ibuf[o++] = 0x71000400; // subs w0, w0, #1
-	offset=start-o;	assert(offset < 0 && offset > -0x40000); offset&=0x7ffff;
-	ibuf[o++] = 0x54000001 | (offset<< 5); // b.ne
+	Section("loop-back");
+	ibuf[o++] = subs(w0, w0, 1);
+	auto loopBack=b_cond(kNE, loop, o);
+	ibuf[o] = loopBack;
+	o++;
+	apd.loopInstructions=o-loop.position;
 
 	//Fill the buffer with epilogue.
+	Section("epilogue");
+	auto epilogue=o;
 	o+=BuildEpilogue(ibuf+o);
 	o+=BuildReturn(ibuf+o);
+	apd.callInstructions=entry+(o-epilogue);
 
-	//Remove buffer write permission, and ensure I-cache (and similar) coherency.
-	pthread_jit_write_protect_np(true);
-	sys_icache_invalidate( ibuf, o*sizeof(Instruction) );
+	//Remove buffer write permission, and ensure I-cache (and similar) coherency
+	// (for just the lines we touched).
+	EndCodeWrite(code, o*sizeof(Instruction), first*sizeof(Instruction));
+	return o;
 }
 //=============================================================================
 //=============================================================================
@@ -291,14 +651,14 @@ static uint BuildPrologue(Instruction* ibuf){
 
 	uint o=0;
 
-	ibuf[o++] = 0xa9b87bfd; // stp    x29, x30, [sp, #-128]!
-	ibuf[o++] = 0xa9016ffc; // stp    x28, x27, [sp, #16]
-	ibuf[o++] = 0xa90267fa; // stp    x26, x25, [sp, #32]
-	ibuf[o++] = 0xa9035ff8; // stp    x24, x23, [sp, #48]
-	ibuf[o++] = 0xa90457f6; // stp    x22, x21, [sp, #64]
-	ibuf[o++] = 0xa9054ff4; // stp    x20, x19, [sp, #80]
-	ibuf[o++] = 0xa90647f2; // stp    x18, x17, [sp, #96]
-	ibuf[o++] = 0xa9073ff0; // stp    x16, x15, [sp, #112]
+	ibuf[o++] = stp(x29, x30, pre(sp, -128));
+	ibuf[o++] = stp(x28, x27, mem(sp, 16));
+	ibuf[o++] = stp(x26, x25, mem(sp, 32));
+	ibuf[o++] = stp(x24, x23, mem(sp, 48));
+	ibuf[o++] = stp(x22, x21, mem(sp, 64));
+	ibuf[o++] = stp(x20, x19, mem(sp, 80));
+	ibuf[o++] = stp(x18, x17, mem(sp, 96));
+	ibuf[o++] = stp(x16, x15, mem(sp, 112));
 
 	return o;
 }
@@ -310,14 +670,14 @@ static uint BuildEpilogue(Instruction* ibuf){
 
 	uint o=0;
 
-	ibuf[o++] = 0xa9473ff0; // ldp    x16, x15, [sp, #112]
-	ibuf[o++] = 0xa94647f2; // ldp    x18, x17, [sp, #96]
-	ibuf[o++] = 0xa9454ff4; // ldp    x20, x19, [sp, #80]
-	ibuf[o++] = 0xa94457f6; // ldp    x22, x21, [sp, #64]
-	ibuf[o++] = 0xa9435ff8; // ldp    x24, x23, [sp, #48]
-	ibuf[o++] = 0xa94267fa; // ldp    x26, x25, [sp, #32]
-	ibuf[o++] = 0xa9416ffc; // ldp    x28, x27, [sp, #16]
-	ibuf[o++] = 0xa8c87bfd; // ldp    x29, x30, [sp], #128
+	ibuf[o++] = ldp(x16, x15, mem(sp, 112));
+	ibuf[o++] = ldp(x18, x17, mem(sp, 96));
+	ibuf[o++] = ldp(x20, x19, mem(sp, 80));
+	ibuf[o++] = ldp(x22, x21, mem(sp, 64));
+	ibuf[o++] = ldp(x24, x23, mem(sp, 48));
+	ibuf[o++] = ldp(x26, x25, mem(sp, 32));
+	ibuf[o++] = ldp(x28, x27, mem(sp, 16));
+	ibuf[o++] = ldp(x29, x30, post(sp, 128));
 
 	return o;
 }
@@ -333,17 +693,17 @@ static uint BuildOverwriteRegisters(Instruction* ibuf){
 	// Use of all of these should not be an issue, and gives us flexibility
 	// to write assembly in the easiest possible way.
 	for(uint i=2; i<31; i++){
-		ibuf[o++] = 0xd2800000 | i; // mov xi, #0
+		ibuf[o++] = mov(xreg(i), 0);
 	}
 
 	//It's less clear that we need to free (write before use) the vector registers,
 	// or nzcv, but might as well be safe.
 	for(uint i=0; i<32; i++){
-		ibuf[o++] = 0x9e6703e0 | i ; // fmov di, xzr
-//		ibuf[o++] = 0x4ea11c20 | i;  // mov.16b vi, v1
+		ibuf[o++] = fmov(dreg(i), xzr);
+//		ibuf[o++] = mov16b(vreg(i), v1);
 	}
 	
-	ibuf[o++] = 0xeb00001f; // cmp x0, x0
+	ibuf[o++] = cmp(x0, x0);
 
 	return o;
 }
@@ -352,507 +712,34 @@ static uint BuildOverwriteRegisters(Instruction* ibuf){
 static uint BuildReturn(Instruction* ibuf)
 {
 	uint o=0;
-	ibuf[o++] = 0xd65f03c0; // ret
+	ibuf[o++] = ret();
 	return o;
 }
 //=============================================================================
 
-AssemblyProbeData&
-  ConstructAssemblyProbeData(ProbeParameters& pp){
-	
-	switch(pp.probeType){
-	case kROBSize_NOPs_Probe:{
-		static auto adp=ROBSize_NOPs_APD(3600, 20, (void*)NULL);
-		return adp;
-	}
-	case kZCL1_Registers_Probe:{
-		static auto adp=ZCL1_Registers_APD(400, 1, (void*)NULL);
-		return adp;
-	}
-	case kZCL2_Stack_Probe:{
-		static auto adp=ZCL2_Stack_APD(400, 1, (void*)NULL);
-		return adp;
-	}
-	case kZCL3_Stride_Probe:{
-		static auto adp=ZCL3_Stride_APD(400, 1, (void*)NULL);
-		return adp;
-	}
-	case kTLB_NumSimultaneousLookups_Probe:{
-		static auto adp=TLB_NumSimultaneousLookups_APD(400, 1, (void*)NULL);
-		return adp;
-	}
-	case kL1D_TestWayPredictor_Probe:{
-		static auto adp=L1D_TestWayPredictor_APD(8*400, 64, (void*)NULL);
-		return adp;
-	}
-	case kCurrentAssemblyProbe:
-	default:
-		exit(1);
-	}
-}
-//.............................................................................
-
 void AssemblyProbeData::print(int probeCount, PerformanceCounters& min, PerformanceCounters& mean, PerformanceCounters& max)
 {
 	//cout<<probeCount<<"\t"<<min;
+	//The last three columns flag noisy points: the 95% confidence interval
+	// of mean cycles, how many outer samples it took to get there, and how
+	// many of those were outliers.
+	//The middle columns are the probe's registered events, in order, or
+	// valuesC()[1] of the default configuration if it registered none.
 	cout<<fixed<<setprecision(0)<<setw(4)
-		<<probeCount<<"\t"<<min.cycles()
-		<<"\t"<<min.valuesC()[1]
-		<<endl;
-}
-
-//-----------------------------------------------------------------------------
-
-uint ROBSize_NOPs_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
-{
-	uint o=0;
-	
-	for(int i=0; i<pp.probeCount; i++){
-		ibuf[o++] = 0xd503201f; // nop
-	}
-	return o;
-}
-//-----------------------------------------------------------------------------
-
-uint ZCL1_Registers_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
-{
-	uint o=0;
-
-	//Copy x1 to x2
-	ibuf[o++] = 0xaa0103e2; // mov x2, x1
-
-//	ibuf[o++] = 0xaa0103e3; // mov x3, x1
-//	ibuf[o++] = 0xaa0103e4; // mov x4, x1
-	ibuf[o++] = 0x91010023; // add x3, x1, #64
-//	ibuf[o++] = 0x91010024; // add x4, x1, #64
-	ibuf[o++] = 0x91010025; // add x5, x1, #64
-	ibuf[o++] = 0x91020026; // add x6, x1, #128
-	ibuf[o++] = 0x91030027; // add x7, x1, #192
-	ibuf[o++] = 0xd280002a; // mov x10, #1
-
-#if 0
-	for(int i=0; i<pp.probeCount; i++){
-/*
-//Doesn't activate ZCL -- addresses don't "obviously" match
-		ibuf[o++] = 0xf9000021; // str x1, [x1]
-		ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-*/
-
-/*
-//Activates ZCL (but slow validation)
-		ibuf[o++] = 0xf9000041; // str x1, [x2]
-		ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-*/
-/*
-//Activates ZCL (faster validation)
-		ibuf[o++] = 0xf9000041; // str x1, [x2]
-		ibuf[o++] = 0xf9400041; // ldr x1, [x2]
-
-		ibuf[o++] = 0xf9000083; // str x3, [x4]
-		ibuf[o++] = 0xf9400083; // ldr x3, [x4]
-*/
-
-/*
-//Now with Fp/SIMD registers
-//Both cases see no acceleration.
-//Not obviously the same address
-//		ibuf[o++] = 0x3d800020; // str q0, [x1]
-//		ibuf[o++] = 0x3dc00040; // ldr q0, [x2]
-
-//Obviously the same address:
-		ibuf[o++] = 0x3d800020; // str q0, [x1]
-		ibuf[o++] = 0x3dc00020; // ldr q0, [x1]
-*/
-
-		ibuf[o++] = 0xf9000041; // str x1, [x2]
-		ibuf[o++] = 0x91002042; // add x2, x2, #8
-		ibuf[o++] = 0xf85f8041; // ldur x1, [x2, #-8]
-	}
-	return o;
-#endif //0
-
-//......................
-	enum LSType{
-		kIndependentLoadsAndStores,
-		kStoreSameAddressDiftRegister,
-		kStoreSameAddressSameRegister,
-		kLoadDiftAddressSameRegister,
-		kLoadSameAddressSameRegister,
-		kLoadFeedsStoreData,
-		kStoreAddressMatchesLoadAddress,
-		kStoreAddressMatchesLoadAddressWithDIV,
-		kStoreAddressRegMatchesLoadAddressRegWithDIV,
-		kStoreAddressRegMatchesLoadAddressReg,
-		};
-
-	auto lsType=kStoreAddressRegMatchesLoadAddressReg;
-	switch(lsType){
-
-	case kIndependentLoadsAndStores:
-//(a) independent loads and store
-//Two loads, two stores, one cycle per loop body
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf90000a0; // str x0, [x5]
-			ibuf[o++] = 0xf94000d0; // ldr x16, [x6]
-			ibuf[o++] = 0xf94000f1; // ldr x17, [x7]
-		}break;
-
-	case kStoreSameAddressDiftRegister:
-//(b) Now store to the same address (but not using same address register)
-//Two loads, two stores, again one cycle per loop body
-//M1 can "consolidate" the two stores, doesn't have to serialize
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf9000040; // str x0, [x2]
-			ibuf[o++] = 0xf94000d0; // ldr x16, [x6]
-			ibuf[o++] = 0xf94000f1; // ldr x17, [x7]
-		}break;
-
-	case kStoreSameAddressSameRegister:
-//(c) Now store to the same address (using same address register)
-//Two loads, two stores, again one cycle per loop body
-//M1 can "consolidate" the two stores, doesnt have to serialize
-//In theory front end could "prune" this case, so we have net 3 LSU ops
-// (and higher throughput?), but we don't see that.
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf94000d0; // ldr x16, [x6]
-			ibuf[o++] = 0xf94000f1; // ldr x17, [x7]
-		}break;
-
-	case kLoadDiftAddressSameRegister:
-//(d) Now load to the register (frome dift addresses)
-//Two loads, two stores, again one cycle per loop body
-//In theory front end could "prune" the earlier load, so we have net 3 LSU ops
-// (and higher throughput?), but we don't see that.
-//(Of course earlier load would have to test against TLB, so not trivial...)
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf94000d0; // ldr x16, [x6]
-			ibuf[o++] = 0xf94000f0; // ldr x16, [x7]
-		}break;
-
-	case kLoadSameAddressSameRegister:
-//(d) Now store to the same address (using same address register)
-//Two loads, two stores, again one cycle per loop body
-//M1 can "consolidate" the two stores, doesnt have to serialize
-//In theory front end could "prune" this case, so we have net 3 LSU ops
-// (and higher throughput?), but we don't see that.
-//This case is easier because no TLB issue!
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf94000d0; // ldr x16, [x6]
-			ibuf[o++] = 0xf94000d0; // ldr x16, [x6]
-		}break;
-
-	case kLoadFeedsStoreData:
-//(e) Now store to the same address (using same address register)
-//Two loads, two stores, again one cycle per loop body
-//Still no problem. Each x0 loads to a different physical register, nothing
-// that can't easily be queued.
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf9000020; // str x0, [x1]
-			ibuf[o++] = 0xf94000c0; // ldr x0, [x6]
-			ibuf[o++] = 0xf94000f1; // ldr x17, [x7]
-		}break;
-
-	case kStoreAddressMatchesLoadAddress:
-//(f) Now the hard case.
-// Store to same address as load.
-// Naively the load has to serialize after the store, and that's what we see.
-// longterm, as 6 cycles per load/store.
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000021; // str x1, [x1]
-			ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-		}break;
-
-	case kStoreAddressMatchesLoadAddressWithDIV:
-//(g) Now the hard case
-// Store to same address as load, but add some extra work as DIV
-// Naively the load has to serialize after the store, and that's what we see.
-// But the DIV can overlap with the store, so ~3+8 cycles.
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000021; // str x1, [x1]
-			ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-			ibuf[o++] = 0x9aca0842; // udiv x2, x2, x10
-		}break;
-
-	case kStoreAddressRegMatchesLoadAddressRegWithDIV:
-//(h) Now the hard case (but we get saved by ZCL).
-// Store to same address as load, but add some extra work as DIV
-// Naively the load has to serialize after the store.
-// But the ZCL can see that the store feeds the load, so ~5.5 cycles
-// Add 8 NOPs to separate the STR and LDR and cycle count drops even further,
-// to ~3 cycles.
-		for(int i=0; i<pp.probeCount; i++){
-			ibuf[o++] = 0xf9000021; // str x1, [x2]
-			ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-			/*
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			*/
-			ibuf[o++] = 0x9aca0842; // udiv x2, x2, x10
-		}break;
-		
-		case kStoreAddressRegMatchesLoadAddressReg:
-		for(int i=0; i<pp.probeCount; i++){
-/*
-//Doesn't activate ZCL -- addresses don't "obviously" match
-//~7 cycles per load/store
-			ibuf[o++] = 0xf9000021; // str x1, [x1]
-			ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-*/
-/*
-//Maybe activates ZCL -- but x2 appears to change, so slow validation?
-//Still ~7 cycles per load/store, but speeds up DIV case.
-			ibuf[o++] = 0xf9000041; // str x1, [x2]
-			ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-*/
-//Activates ZCL (faster validation)
-//~5 cycles
-			ibuf[o++] = 0xf9000041; // str x1, [x2]
-			ibuf[o++] = 0xf9400041; // ldr x1, [x2]
-//Compare with
-			//ibuf[o++] = 0xf9000041; // str x1, [x2]
-			//ibuf[o++] = 0xf9400021; // ldr x1, [x1]
-//same pattern, same values as far as LSU, LSDP etc are concerned (x1=x2)
-// this runs at ~7cycles because non-matching address registers means front-end
-// cannot ZCL.
-
-//Can the front-end track minor changes to addresses?
-//Patent says yes, but experiment says not yet:
-//We get the same result (usual ~7 cycles) whether or not we include the NOPs
-//below to try to activate the 2012 patent.
-			/*
-			ibuf[o++] = 0xf9000041; // str x1, [x2]
-			ibuf[o++] = 0x91002042; // add x2, x2, #8
-
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-
-			ibuf[o++] = 0xf85f8041; // ldur x1, [x2, #-8]
-			ibuf[o++] = 0xd1002042; // sub x2, x2, #8
-
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			*/
-//What about FP?
-//Non-matching address registers: 7 cycles
-	//	ibuf[o++] = 0x3d800020; // str q0, [x1]
-	//	ibuf[o++] = 0x3dc00040; // ldr q0, [x2]
-
-//Matching address registers: ALSO 7 cycles, so no ZCL
-	//	ibuf[o++] = 0x3d800020; // str q0, [x1]
-	//	ibuf[o++] = 0x3dc00020; // ldr q0, [x1]
-		}break;
-		
-	}return o;
-}
-//-----------------------------------------------------------------------------
-
-uint ZCL2_Stack_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
-{
-//Note that we are assuming a "large enough" red zone below the stack pointer,
-// which is dodgy for production code, but good enough for tests!
-	uint o=0;
-	
-	for(int i=0; i<pp.probeCount; i++){
-//Store to stack then load from stack.
-//With no NOPs (so ZCL does not kick in) takes 7 cycles, with NOPs takes
-// ~2.5 cycles.
-//FP is not accelerated with or withoput NOPs.
-			ibuf[o++] = 0xa9016ffc; // stp  x28, x27, [sp, #-16]
-			//ibuf[o++] = 0xad3d87e0; // stp 	q0, q1, [sp, #-80]
-			
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-
-			ibuf[o++] = 0xa9416ffc; // ldp  x28, x27, [sp, #-16]
-			//ibuf[o++] = 0xad7d87e0; // ldp  q0, q1, [sp, #-80]
-
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-			ibuf[o++] = 0xd503201f; // nop
-	}
-	return o;
-}
-//-----------------------------------------------------------------------------
-
-uint ZCL3_Stride_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
-{
-	uint o=0;
-
-	//Fill the databuffer appropriately.
-	void** dataBuffer=static_cast<void**>(pp.dataBuffer);
-	for(int i=0; i<pp.probeCount*2; i++){
-		dataBuffer[i]=&dataBuffer[i+1];
-	}
-	//Note that (as always) x1 will hold the address of the data buffer.
-
-	ibuf[o++] = 0xd280002a; // mov x10, #1
-	ibuf[o++] = 0xaa0103e2; // mov x2, x1
-
-	for(int i=0; i<pp.probeCount; i++){
-		ibuf[o++] = 0xf9400042; // ldr x2, [x2]
-		//Throw in some NOPs if you like...
-		//ibuf[o++] = 0x9b0a7c42; // mul x2, x2, x10
-		ibuf[o++] = 0x9aca0842; // udiv x2, x2, x10
-		//Throw in some NOPs if you like...
-	}
-
-	return o;
-}
-//-----------------------------------------------------------------------------
-
-uint TLB_NumSimultaneousLookups_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
-{
-	uint o=0;
-	
-	//Create a base address offset by 32K since we can't encode that
-	// directly in a load.
-	ibuf[o++] = 0x91402023; // add x3, x1, #8, lsl #12     ; =32768
-
-	ibuf[o++] = 0xd2880a04; // mov x4, #16464
-	ibuf[o++] = 0xd2901405; // mov x5, #32928
-	
-	for(int i=0; i<pp.probeCount; i++){
-//Three loads to same page. Takes 1 cycle.
-/*
-		ibuf[o++] = 0xf9400022; // ldr x2, [x1]
-		ibuf[o++] = 0xf9400422; // ldr x2, [x1, #8]
-		ibuf[o++] = 0xf9400822; // ldr x2, [x1, #16]
-*/
-//Three loads to two pages. Takes 1.4 cycles.
-/*
-		ibuf[o++] = 0xf9400022; // ldr x2, [x1]
-		ibuf[o++] = 0xf9400422; // ldr x2, [x1, #8]
-		ibuf[o++] = 0xf9600022; // ldr x2, [x1, #16384]
-*/
-//Three loads to three pages. Takes 2.5 cycles.
-/*
-		ibuf[o++] = 0xf9400022; // ldr x2, [x1]
-		ibuf[o++] = 0xf9600022; // ldr x2, [x1, #16384]
-		ibuf[o++] = 0xf9400062; // ldr x2, [x3]
-*/
-//Worst possible case. Keep changing the page address so no reuse of page lookups.
-/*
-		ibuf[o++] = 0xf9400022; // ldr x2, [x1, #0]
-		ibuf[o++] = 0xf8646822; // ldr x2, [x1, x4]
-		ibuf[o++] = 0xf8656822; // ldr x2, [x1, x5]
-		ibuf[o++] = 0x91403021; // add x1, x1, #12, lsl #12    ; =49152
-			//wrap around at 8 pages: 2 load per cycle. queue entries frequently matched
-		ibuf[o++] = 0x926ef821; // and x1, x1, #0xfffffffffffdffff
-			//wrap around at 16 pages: 1 load per cycle. queue entries never matched.
-		//ibuf[o++] = 0x926df821; // and x1, x1, #0xfffffffffffbffff
-			//wrap around at 32 pages: 1 load per 2 cycles. Every load Replays?
-		//ibuf[o++] = 0x926cf821; // and x1, x1, #0xfffffffffff7ffff
-			//wrap around at 64 pages: 1 load per 2 cycles. Every load Replays?
-		//ibuf[o++] = 0x926bf821; // and x1, x1, #0xffffffffffefffff
-*/
-//Oh no, the above was not worst case. It can get FAR worse!
-// What it we split a load across a page boundary?
-// Forces microcode to kick, takes ~31 cycles per bad load.
-
-		ibuf[o++] = 0xf9400022; // ldr x2, [x1]
-		ibuf[o++] = 0xf9400022; // ldr x2, [x1]
-		ibuf[o++] = 0xf85ff062; // ldur x2, [x3, #-1]
-		
-	}
-	return o;
-}
-//-----------------------------------------------------------------------------
-
-uint L1D_TestWayPredictor_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
-{
-	uint o=0;
-
-	//Fill the databuffer appropriately.
-	uint64_t* dataBuffer=static_cast<uint64_t*>(pp.dataBuffer);
-	for(int i=0; i<1000000; i++){
-		//This will fill 56M bytes, but buffer is 256MB in size so will fit.
-
-		dataBuffer[0]=(16119L<<32)|26296;
-		dataBuffer[1]=(29134L<<32)|16716;
-		dataBuffer[2]=(27337L<<32)|19203;
-		dataBuffer[3]=(22781L<<32)| 1290;
-		dataBuffer[4]=(26336L<<32)|15258;
-		dataBuffer[5]=( 1981L<<32)| 6166;
-		dataBuffer[6]=( 1030L<<32)|13888;
-/*
-		dataBuffer[0]=0;
-		dataBuffer[1]=0;
-		dataBuffer[2]=0;
-		dataBuffer[3]=0;
-		dataBuffer[4]=0;
-		dataBuffer[5]=0;
-		dataBuffer[6]=0;
-*/
-		dataBuffer+=7;
-	}
-	//Note that (as always) x1 will hold the address of the data buffer.
-	ibuf[o++] = 0x91000025; // add x5, x1, #0
-	ibuf[o++] = 0x91010026; // add x6, x1, #64
-	ibuf[o++] = 0x91020027; // add x7, x1, #128
-	ibuf[o++] = 0x91030028; // add x8, x1, #192
-	ibuf[o++] = 0x91040029; // add x9, x1, #256
-	ibuf[o++] = 0x9105002a; // add x10, x1, #320
-	//Offset x9 and x10 to put them in different banks from x5 and x6
-	ibuf[o++] = 0x91004129; // add x9, x9, #16
-	ibuf[o++] = 0x9100414a; // add x10, x10, #16
-	
-	ibuf[o++] = 0xd2800004; // mov x4, #0
-
-	for(int i=0; i<pp.probeCount; i+=64){
-		//We specifically want x1 to just keep going through the buffer,
-		// without being reset at the start of each loop.
-		ibuf[o++] = 0xf8401434; // ldr x20, [x1], #1
-
-		for(int j=0; j<64; j++){
-			ibuf[o++] = 0xb3730a84; // bfi x4, x20, #13, #3
-			ibuf[o++] = 0x93d40694; // ror x20, x20, #1
-
-			ibuf[o++] = 0x386468af; // ldrb w15, [x5, x4]
-			ibuf[o++] = 0x386468d0; // ldrb w16, [x6, x4]
-			ibuf[o++] = 0x386468f1; // ldrb w17, [x7, x4]
-			ibuf[o++] = 0x38646912; // ldrb w18, [x8, x4]
-			ibuf[o++] = 0x38646933; // ldrb w19, [x9, x4]
-			ibuf[o++] = 0x38646955; // ldrb w21, [x10, x4]
+		<<probeCount<<"\t"<<min.cycles();
+	if(schedule){
+		for(auto& placement:schedule->placements){
+			if( placement.pass==0 && configurable_counter_live(placement.counter) ){
+				cout<<"\t"<<min.valuesC()[placement.counter];
+			}
 		}
+	}else{
+		cout<<"\t"<<min.valuesC()[1];
 	}
-	return o;
+	cout<<"\t+-"<<setprecision(2)<<100*stats.RelativeCI95(0)<<"%"
+		<<"\t"<<stats.n
+		<<"\t"<<stats.outliers[0]
+		<<endl;
 }
+
 //=============================================================================
@@ -0,0 +1,72 @@
+//
+//  probeRegistry.cpp
+//  AArch64-Explore
+//
+//  The probes, by name (see Probes.h).
+//
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <deque>
+
+#include "Probes.h"
+//=============================================================================
+
+//Registrations run during static initialization, in no particular order
+// across files, so the list is made on first use.
+//A deque, so that registering more (from a script) moves nothing.
+static deque<ProbeDefinition>& Registry(void){
+	static deque<ProbeDefinition> registry;
+	return registry;
+}
+
+void RegisterProbe(ProbeDefinition const& definition){
+	if( FindProbe(definition.name) ){
+		printf("Probe %s registered twice\n", definition.name.c_str());
+		exit(1);
+	}
+	if( (definition.perform==nullptr)==(definition.construct==nullptr) ){
+		printf("Probe %s must have exactly one of perform and construct\n",
+		  definition.name.c_str());
+		exit(1);
+	}
+	Registry().push_back(definition);
+}
+
+ProbeDefinition const* FindProbe(string const& name){
+	for(auto& definition:Registry()){
+		if(name==definition.name){return &definition;}
+	}
+	return nullptr;
+}
+//.............................................................................
+
+void PrintProbes(void){
+	//Registration order is arbitrary, so list them by name.
+	vector<ProbeDefinition const*> sorted;
+	for(auto& definition:Registry()){sorted.push_back(&definition);}
+	sort(sorted.begin(), sorted.end(), [](auto a, auto b){
+		return a->name<b->name;
+	});
+
+	//Script probes can have long names; keep the descriptions in a column,
+	// unless that pushes them off the screen.
+	size_t width=0;
+	for(auto definition:sorted){width=max(width, definition->name.size());}
+	width=min(width, size_t(40));
+
+	cout<<"Probes:"<<endl;
+	for(auto definition:sorted){
+		cout<<"  "<<left<<setw(int(width))<<definition->name<<right<<"  ";
+		if(definition->perform){
+			cout<<"C"<<endl;
+			continue;
+		}
+		cout<<"asm, probeCount "<<definition->lo<<".."<<definition->hi
+		    <<" step "<<definition->stride;
+		for(auto& event:definition->events){cout<<" "<<event;}
+		cout<<endl;
+	}
+}
+//=============================================================================
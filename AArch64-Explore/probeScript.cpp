@@ -0,0 +1,382 @@
+//
+//  probeScript.cpp
+//  AArch64-Explore
+//
+//  Assembly probes described in text files, assembled at load time.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <fstream>
+#include <sstream>
+#include <numeric>
+#include <map>
+#include <deque>
+
+#include "General.h"
+#include "probeScript.h"
+#include "aarch64Assembler.h"
+#include "assemblyProbe.h"
+
+using namespace A64;
+
+//A rotation period beyond this (the lcm of the rotations a line uses) is
+// surely a mistake.
+static uint const kMaxRotationPeriod=1024;
+static uint const kMaxAlignBytes=16_kiB;
+//=============================================================================
+#pragma mark Scripted probes
+
+//One line of a setup or body, ready to emit.
+struct ScriptItem{
+	enum Kind{kInstruction, kNops, kAlign};
+	Kind                kind;
+	//kInstruction: the encoding for each rotation phase (copy i uses
+	// phases[i%phases.size()]).
+	vector<Instruction> phases;
+	uint                count;	//kNops: how many; kAlign: to how many bytes
+};
+
+struct ScriptedProbe_APD:AssemblyProbeData{
+	string             name;
+	int                lo=0, hi=400, stride=1;
+	size_t             dataBytes=16_kiB;
+	vector<string>     events, headings;
+	vector<ScriptItem> setup, body;
+
+	virtual uint AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp);
+	virtual int  AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp);
+};
+
+//Emits items, as for copy number copy; returns how many instructions.
+//ibuf runs execOffset bytes away, at an address only as aligned as a page
+// (4KiB, for the Linux views), so .align goes by that address.
+static uint EmitItems(Instruction* ibuf, vector<ScriptItem> const& items, uint copy,
+  ptrdiff_t execOffset){
+	uint o=0;
+	for(auto& item:items){
+		switch(item.kind){
+		case ScriptItem::kInstruction:
+			ibuf[o++] = item.phases[copy%item.phases.size()];
+			break;
+		case ScriptItem::kNops:
+			for(uint i=0; i<item.count; i++){ibuf[o++] = nop();}
+			break;
+		case ScriptItem::kAlign:
+			while( (reinterpret_cast<uintptr_t>(ibuf+o)+execOffset)%item.count!=0 ){
+				ibuf[o++] = nop();
+			}
+			break;
+		}
+	}
+	return o;
+}
+
+uint ScriptedProbe_APD::AssemblyProbeBuild(Instruction* ibuf, ProbeParameters& pp)
+{
+	uint o=EmitItems(ibuf, setup, 0, pp.execOffset);
+	return o+AssemblyProbeExtend(ibuf+o, 0, pp);
+}
+
+int ScriptedProbe_APD::AssemblyProbeExtend(Instruction* ibuf, uint fromCount, ProbeParameters& pp)
+{
+	uint o=0;
+	for(uint i=fromCount; i<pp.probeCount; i++){
+		o+=EmitItems(ibuf+o, body, i, pp.execOffset);
+	}
+	return o;
+}
+
+//Loaded probes live for the rest of the run (the registry points at them).
+static deque<ScriptedProbe_APD> g_scriptedProbes;
+//=============================================================================
+#pragma mark Parsing
+
+//What we need to know while parsing one file.
+struct ScriptParser{
+	string                      path;
+	int                         lineNumber=0;
+	ScriptedProbe_APD*          probe=nullptr;
+	vector<ScriptItem>*         section=nullptr;
+	map<string, vector<string>> rotations;	//of the current probe
+
+	bool Fail(string const& message){
+		printf("%s:%d: %s\n", path.c_str(), lineNumber, message.c_str());
+		return false;
+	}
+	bool ParseLine(string const& line);
+	bool ParseDirective(vector<string> const& words);
+	bool ParseInstruction(string const& text);
+	bool ParseRegisters(string const& word, vector<string>& registers);
+};
+
+static vector<string> Words(string const& line){
+	istringstream stream(line);
+	vector<string> words;
+	string word;
+	while(stream>>word){words.push_back(word);}
+	return words;
+}
+
+//A count, optionally with a k or M (binary) suffix.
+static bool ParseSize(string const& word, size_t& size){
+	char* end;
+	size=strtoull(word.c_str(), &end, 0);
+	if(end==word.c_str()){return false;}
+	if(*end=='k'){size*=1_kiB; end++;}
+	else if(*end=='M'){size*=1_MiB; end++;}
+	return *end=='\0';
+}
+
+bool ScriptParser::ParseLine(string const& text){
+	auto line=text.substr( 0, text.find("//") );
+	auto words=Words(line);
+	if( words.empty() ){return true;}
+
+	//.word is an instruction; every other . is a directive.
+	if( words[0][0]=='.' && words[0]!=".word" ){return ParseDirective(words);}
+
+	if(!probe){return Fail("instruction before any .probe");}
+	return ParseInstruction(line);
+}
+
+bool ScriptParser::ParseDirective(vector<string> const& words){
+	auto& directive=words[0];
+	auto count=words.size();
+
+	if(directive==".probe"){
+		if(count!=2){return Fail(".probe takes a name");}
+		probe=&g_scriptedProbes.emplace_back();
+		probe->name=words[1];
+		section=&probe->body;
+		rotations.clear();
+		return true;
+	}
+	if(!probe){return Fail(directive+" before any .probe");}
+
+	if(directive==".setup" || directive==".body"){
+		if(count!=1){return Fail(directive+" takes nothing");}
+		section=(directive==".setup")? &probe->setup: &probe->body;
+	}else if(directive==".repeat"){
+		vector<size_t> values;
+		for(auto i=1; i<count; i++){
+			size_t value;
+			if( !ParseSize(words[i], value) ){return Fail("bad count "+words[i]);}
+			values.push_back(value);
+		}
+		if( values.empty() || values.size()>3 ){
+			return Fail(".repeat takes count, or lo hi [stride]");
+		}
+		probe->lo    =int(values[0]);
+		probe->hi    =int( (values.size()>1)? values[1]: values[0] );
+		probe->stride=int( (values.size()>2)? values[2]: 1 );
+		if( probe->hi<probe->lo || probe->stride<=0 ){
+			return Fail("bad .repeat range");
+		}
+	}else if(directive==".buffer"){
+		if( count!=2 || !ParseSize(words[1], probe->dataBytes) ){
+			return Fail(".buffer takes a size (eg 16k, 256M)");
+		}
+	}else if(directive==".events"){
+		for(auto i=1; i<count; i++){
+			auto equals=words[i].find('=');
+			probe->events.push_back( words[i].substr(0, equals) );
+			probe->headings.push_back( (equals==string::npos)?
+			  words[i]: words[i].substr(equals+1) );
+		}
+	}else if(directive==".rotate"){
+		if( count<3 || words[1][0]!='%' || words[1].size()<2 ){
+			return Fail(".rotate takes %name and registers");
+		}
+		vector<string> registers;
+		for(auto i=2; i<count; i++){
+			if( !ParseRegisters(words[i], registers) ){return false;}
+		}
+		rotations[ words[1] ]=registers;
+	}else if(directive==".nops" || directive==".align"){
+		size_t value;
+		if( count!=2 || !ParseSize(words[1], value) ){
+			return Fail(directive+" takes a count");
+		}
+		if( directive==".align"
+		  && (value==0 || (value&(value-1))!=0 || value>kMaxAlignBytes) ){
+			return Fail(".align takes a power of two, at most 16k");
+		}
+		section->push_back( ScriptItem{ (directive==".nops")?
+		  ScriptItem::kNops: ScriptItem::kAlign, {}, uint(value)} );
+	}else{
+		return Fail("unknown directive "+directive);
+	}
+	return true;
+}
+
+//x16 (as itself) or x16-x19 (x16, x17, x18, x19).
+bool ScriptParser::ParseRegisters(string const& word, vector<string>& registers){
+	auto dash=word.find('-');
+	if(dash==string::npos){
+		registers.push_back(word);
+		return true;
+	}
+	auto first=word.substr(0, dash), last=word.substr(dash+1);
+	if( first.size()<2 || last.size()<2 || first[0]!=last[0]
+	  || !isdigit(first[1]) || !isdigit(last[1]) ){
+		return Fail("bad register range "+word);
+	}
+	auto from=atoi(first.c_str()+1), to=atoi(last.c_str()+1);
+	if(to<from){return Fail("bad register range "+word);}
+	for(auto n=from; n<=to; n++){
+		registers.push_back( first[0]+to_string(n) );
+	}
+	return true;
+}
+
+//Splits an instruction into its mnemonic and operands, at the commas
+// outside []; each operand trimmed, and all of it lower case.
+static void SplitOperands(string const& text, string& mnemonic, vector<string>& operands){
+	string lower;
+	for(auto c:text){lower+=(char)tolower(c);}
+	istringstream stream(lower);
+	stream>>mnemonic;
+	string rest;
+	getline(stream, rest);
+	string operand;
+	auto depth=0;
+	auto flush=[&]{
+		auto first=operand.find_first_not_of(" \t");
+		auto last =operand.find_last_not_of(" \t");
+		operands.push_back( (first==string::npos)? "": operand.substr(first, last-first+1) );
+		operand.clear();
+	};
+	for(auto c:rest){
+		if(c=='['){depth++;}
+		if(c==']'){depth--;}
+		if(c==',' && depth==0){flush(); continue;}
+		operand+=c;
+	}
+	flush();
+}
+
+//Whether text writes x0 (or w0), the wrapper's trip counter: as its
+// destination (the first operand, or the second of a load pair or an
+// atomic), a store exclusive's status, or a base register written back.
+//.word is taken on trust.
+static bool WritesTripCounter(string const& text){
+	string mnemonic;
+	vector<string> operands;
+	SplitOperands(text, mnemonic, operands);
+	auto isTripCounter=[](string const& operand){
+		return operand=="x0" || operand=="w0";
+	};
+	//Written back: [x0, #8]! or [x0], #8
+	for(size_t i=0; i<operands.size(); i++){
+		auto& operand=operands[i];
+		if( operand.rfind("[x0]", 0)!=0 && operand.rfind("[x0,", 0)!=0 ){continue;}
+		auto fPostIndex=operand.back()==']' && i+1<operands.size();
+		if( operand.back()=='!' || fPostIndex ){return true;}
+	}
+
+	static char const* const kNoDestination[]={
+		".word", "cmp", "cmn", "tst", "ccmp", "ccmn", "fcmp", "fcmpe",
+		"fccmp", "fccmpe", "b", "bl", "br", "blr", "ret", "cbz", "cbnz",
+		"tbz", "tbnz", "prfm", "prfum", "msr", "dc", "ic", "tlbi", "sys",
+		"hint", "nop", "isb", "dsb", "dmb", "yield"};
+	for(auto name:kNoDestination){
+		if(mnemonic==name){return false;}
+	}
+	if( mnemonic.rfind("b.", 0)==0 ){return false;}
+	auto fStoreExclusive=mnemonic.rfind("stx", 0)==0 || mnemonic.rfind("stlx", 0)==0;
+	if( mnemonic.rfind("st", 0)==0 && !fStoreExclusive ){return false;}
+
+	if( !operands.empty() && isTripCounter(operands[0]) ){return true;}
+	auto fSecondToo=mnemonic.rfind("ld", 0)==0 || mnemonic.rfind("swp", 0)==0;
+	return fSecondToo && operands.size()>=3 && isTripCounter(operands[1]);
+}
+
+//Splits text into the literal pieces and the %names between them.
+static void SplitPlaceholders(string const& text,
+  vector<string>& literals, vector<string>& names){
+	literals.assign(1, "");
+	for(size_t at=0; at<text.size(); ){
+		if(text[at]!='%'){
+			literals.back()+=text[at++];
+			continue;
+		}
+		auto end=at+1;
+		while( end<text.size() && (isalnum(text[end]) || text[end]=='_') ){end++;}
+		names.push_back( text.substr(at, end-at) );
+		literals.push_back("");
+		at=end;
+	}
+}
+
+bool ScriptParser::ParseInstruction(string const& text){
+	//Which rotations this line uses, and so how many phases it has.
+	vector<string> literals, names;
+	SplitPlaceholders(text, literals, names);
+	uint period=1;
+	for(auto& name:names){
+		auto rotation=rotations.find(name);
+		if( rotation==rotations.end() ){return Fail("no .rotate for "+name);}
+		period=lcm( period, uint(rotation->second.size()) );
+		if(period>kMaxRotationPeriod){return Fail("rotations too long");}
+	}
+
+	ScriptItem item{ScriptItem::kInstruction, {}, 0};
+	for(uint phase=0; phase<period; phase++){
+		auto substituted=literals[0];
+		for(auto n=0; n<names.size(); n++){
+			auto& registers=rotations[ names[n] ];
+			substituted+=registers[phase%registers.size()]+literals[n+1];
+		}
+
+		if( WritesTripCounter(substituted) ){
+			return Fail(substituted+" writes x0, the wrapper's trip counter");
+		}
+
+		auto context=path+":"+to_string(lineNumber)+": "+substituted;
+		g_encodingContext=context.c_str();
+		Instruction instruction;
+		string error;
+		auto fOK=Assemble(substituted, instruction, error);
+		g_encodingContext=nullptr;
+		if(!fOK){return Fail(error);}
+		//A branch means the instructions retired are not simply those
+		// built; see AssemblyProbeData::fStraightLine.
+		if( IsBranch(instruction) ){probe->fStraightLine=false;}
+		item.phases.push_back(instruction);
+	}
+	section->push_back(item);
+	return true;
+}
+//=============================================================================
+
+bool LoadProbeScript(string const& path, vector<string>& names){
+	ifstream file(path);
+	if(!file){
+		printf("Can't open probe script %s\n", path.c_str());
+		return false;
+	}
+
+	auto firstProbe=g_scriptedProbes.size();
+	ScriptParser parser;
+	parser.path=path;
+	string line;
+	while( getline(file, line) ){
+		parser.lineNumber++;
+		if( !parser.ParseLine(line) ){return false;}
+	}
+
+	for(auto p=firstProbe; p<g_scriptedProbes.size(); p++){
+		auto apd=&g_scriptedProbes[p];
+		RegisterProbe({
+			.name=apd->name,
+			.construct=[apd]()->AssemblyProbeData&{return *apd;},
+			.lo=apd->lo, .hi=apd->hi, .stride=apd->stride,
+			.dataBytes=apd->dataBytes,
+			.events=apd->events, .headings=apd->headings});
+		names.push_back(apd->name);
+	}
+	return true;
+}
+//=============================================================================
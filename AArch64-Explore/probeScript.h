@@ -0,0 +1,65 @@
+//
+//  probeScript.h
+//  AArch64-Explore
+//
+//  Assembly probes described in text files, assembled at load time.
+//
+
+#ifndef probeScript_h
+#define probeScript_h
+
+#include <string>
+#include <vector>
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	Most experiments are a variant of some other experiment: the same loads
+	with a different address register, a few NOPs between the store and the
+	load, ... Written in C++ each variant is a recompile (or a commented out
+	block, and an enum to choose between them). Written in a probe script
+	they are just text, and a file can hold dozens of them, all of which
+	run in one invocation:
+		//Comments run from // to the end of the line.
+		.probe zcl-store-load-same-reg      //the name --probe takes
+		.repeat 0 400 1                     //probeCount lo hi [stride]
+		.buffer 16k                         //bytes of data buffer, in x1
+		.events LD_UNIT_UOP=loads ST_UNIT_UOP=stores
+		.rotate %r x16-x19                  //%r is x16, x17, x18, x19, x16, ...
+		.setup                              //run once, before the loop
+			mov x2, x1
+		.body                               //the probe, repeated probeCount times
+			str x1, [x2]
+			ldr %r, [x2]
+			.nops 8                         //eight NOPs
+			.align 64                       //NOPs up to a 64B boundary
+	The instructions are anything aarch64Assembler.h accepts. Each probe runs
+	in the standard wrapper (see PerformAssemblyProbe() in main.cpp), so on
+	entry x1 is the data buffer, and x0 (w0) is the wrapper's trip counter,
+	which a probe may read but must not write; an instruction that does is
+	an error. Do not count on the values of the other registers.
+
+	Everything but .probe is optional. By default the probe repeats 0 to
+	400 times, has a 16KiB buffer, counts what the counters are configured
+	to count anyway, and the instructions are the body.
+
+	.rotate breaks the dependence (or the false sharing) between successive
+	copies of the body: copy i uses entry i%n of the list, which is either
+	registers or ranges of them (x16-x19, d0-d7). .repeat with a single
+	count runs just that count. .align is relative to the address the code
+	runs at, and must be a power of two no larger than 16KiB.
+
+	Errors (including an instruction that will not assemble, for any entry
+	of any rotation) are reported with the file and line when the file is
+	loaded, before anything runs.
+*/
+//=============================================================================
+
+//Registers every probe in the file (see Probes.h), and appends their names,
+// in order, to names.
+//On error prints it, with the file and line, and returns false.
+bool LoadProbeScript(string const& path, vector<string>& names);
+//=============================================================================
+
+#endif /* probeScript_h */
@@ -0,0 +1,251 @@
+//
+//  statistics.h
+//  AArch64-Explore
+//
+//  Streaming statistics over PerformanceCounters samples.
+//
+
+#ifndef statistics_h
+#define statistics_h
+
+#include <cmath>
+#include <cfloat>
+#include <array>
+
+#include "General.h"
+#include "m1cycles.h"
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	Min, max and mean of the outer samples throw away the information that
+	tells a noisy run apart from a real microarchitectural effect.
+	CounterStatistics keeps, for every lane (the COUNTERS_COUNT counters plus
+	realtime_ns), as samples stream in:
+	- min, max
+	- mean and variance (Welford, so no catastrophic cancellation)
+	- median, 10th and 90th percentiles (P-square estimators, Jain and
+	  Chlamtac 1985: five markers per quantile, no sample storage)
+	- the median absolute deviation (also P-square, of |x-median|), from which
+	  we flag a sample as an outlier when its modified z-score
+	  0.6745*|x-median|/MAD exceeds kOutlierZ.
+
+	Everything is fixed size, so accumulating allocates nothing and is safe
+	to do between counter reads. The lanes are processed as flat arrays in
+	simple loops, which the compiler is happy to vectorize.
+
+	Until there are five samples the quantiles are computed exactly from the
+	samples seen so far.
+*/
+//=============================================================================
+
+//The two-sided 95% critical value of Student's t with dof degrees of
+// freedom (dof>0).
+inline double StudentT95(uint64_t dof){
+	static double const kT95[]={
+	  0, 12.71, 4.30, 3.18, 2.78, 2.57, 2.45, 2.36, 2.31, 2.26,
+	  2.23, 2.20, 2.18, 2.16, 2.14, 2.13, 2.12, 2.11, 2.10, 2.09};
+	return (dof<lengthof(kT95))? kT95[dof]: 1.96+2.5/dof;
+}
+//.............................................................................
+
+struct CounterStatistics{
+	static int const kNumLanes=COUNTERS_COUNT+1;	//[COUNTERS_COUNT] is ns
+	static constexpr double kOutlierZ=3.5;
+	typedef array<double, kNumLanes> Lanes;
+
+	//...........................................................................
+	//One P-square estimator per lane, all tracking the same quantile.
+	struct P2Quantile{
+		double                  p;
+		array<Lanes, 5>         height;		//marker heights
+		array<Lanes, 5>         position;	//actual marker positions (1-based)
+		array<double, 5>        desired;	//desired positions, same for all lanes
+		array<double, 5>        increment;
+
+		void Reset(double p){
+			this->p=p;
+			desired  ={1, 1+2*p, 1+4*p, 3+2*p, 5};
+			increment={0, p/2,   p,     (1+p)/2, 1};
+			for(auto m=0; m<5; m++){
+				position[m].fill(m+1);
+			}
+		}
+
+		//n is the number of samples *including* this one.
+		inline void Add(Lanes const& x, uint64_t n){
+			if(n<=5){
+				//Keep the first five sorted, per lane (insertion sort).
+				for(auto l=0; l<kNumLanes; l++){
+					auto i=static_cast<int>(n)-1;
+					while( i>0 && height[i-1][l]>x[l] ){
+						height[i][l]=height[i-1][l];
+						i--;
+					}
+					height[i][l]=x[l];
+				}
+				return;
+			}
+			for(auto m=0; m<5; m++){
+				desired[m]+=increment[m];
+			}
+			for(auto l=0; l<kNumLanes; l++){
+				//Find the cell, extending the extremes if needed.
+				int k;
+				if(x[l]<height[0][l]){
+					height[0][l]=x[l];
+					k=0;
+				}else if(x[l]>=height[4][l]){
+					height[4][l]=x[l];
+					k=3;
+				}else{
+					k=0;
+					while( x[l]>=height[k+1][l] ){k++;}
+				}
+				for(auto m=k+1; m<5; m++){
+					position[m][l]+=1;
+				}
+
+				//Nudge the three middle markers toward their desired positions.
+				for(auto m=1; m<4; m++){
+					auto d=desired[m]-position[m][l];
+					auto below=position[m][l]-position[m-1][l];
+					auto above=position[m+1][l]-position[m][l];
+					if( (d>=1 && above>1) || (d<=-1 && below>1) ){
+						auto s=(d>0)? 1.0: -1.0;
+						auto q =height[m][l];
+						auto qp=height[m+1][l], qm=height[m-1][l];
+						//Parabolic prediction...
+						auto qNew=q+s/(above+below)*(
+						  (below+s)*(qp-q)/above + (above-s)*(q-qm)/below );
+						//...falling back to linear if it leaves the bracket.
+						if( !(qm<qNew && qNew<qp) ){
+							auto qn=(s>0)? qp: qm;
+							auto dn=(s>0)? above: below;
+							qNew=q+s*(qn-q)/dn;
+						}
+						height[m][l]=qNew;
+						position[m][l]+=s;
+					}
+				}
+			}
+		}
+
+		inline double Get(int lane, uint64_t n) const{
+			if(n==0){return 0;}
+			if(n<=5){
+				//Exact, from the sorted first samples.
+				return height[ static_cast<int>( p*(n-1)+0.5 ) ][lane];
+			}
+			return height[2][lane];
+		}
+	};
+	//...........................................................................
+
+	uint64_t   n;
+	Lanes      min, max, mean, m2;
+	P2Quantile median, p10, p90, mad;
+	array<uint64_t, kNumLanes> outliers;
+
+	CounterStatistics(){Reset();}
+
+	void Reset(){
+		n=0;
+		min.fill(DBL_MAX);
+		max.fill(-DBL_MAX);
+		mean.fill(0);
+		m2.fill(0);
+		median.Reset(0.5);
+		p10.Reset(0.1);
+		p90.Reset(0.9);
+		mad.Reset(0.5);
+		outliers.fill(0);
+	}
+
+	static inline Lanes ToLanes(PerformanceCounters const& pc){
+		Lanes x;
+		for(auto l=0; l<COUNTERS_COUNT; l++){x[l]=pc.valuesA[l];}
+		x[COUNTERS_COUNT]=pc.realtime_ns;
+		return x;
+	}
+	static inline PerformanceCounters FromLanes(Lanes const& x){
+		PerformanceCounters pc;
+		for(auto l=0; l<COUNTERS_COUNT; l++){pc.valuesA[l]=x[l];}
+		pc.realtime_ns=x[COUNTERS_COUNT];
+		return pc;
+	}
+	//...........................................................................
+
+	//Returns a bit mask of the lanes in which this sample is an outlier
+	// relative to the samples before it (bit COUNTERS_COUNT is ns).
+	inline uint32_t Add(PerformanceCounters const& pc){
+		auto x=ToLanes(pc);
+		n++;
+
+		uint32_t outlierMask=0;
+		Lanes deviation;
+		for(auto l=0; l<kNumLanes; l++){
+			deviation[l]=(n>1)? std::fabs( x[l]-median.Get(l, n-1) ): 0;
+			auto madL=mad.Get(l, n-1);
+			if( n>5 && madL>0 && 0.6745*deviation[l]/madL>kOutlierZ ){
+				outlierMask|=1u<<l;
+				outliers[l]++;
+			}
+		}
+
+		for(auto l=0; l<kNumLanes; l++){
+			min[l]=std::min(min[l], x[l]);
+			max[l]=std::max(max[l], x[l]);
+			auto delta=x[l]-mean[l];
+			mean[l]+=delta/n;
+			m2[l]+=delta*(x[l]-mean[l]);
+		}
+		median.Add(x, n);
+		p10   .Add(x, n);
+		p90   .Add(x, n);
+		mad   .Add(deviation, n);
+		return outlierMask;
+	}
+	//...........................................................................
+
+	inline double Variance(int lane) const{
+		return (n>1)? m2[lane]/(n-1): 0;
+	}
+	inline double StdDev(int lane) const{
+		return std::sqrt( Variance(lane) );
+	}
+	//Standard deviation over mean; the quickest "how noisy was this" number.
+	inline double RelativeStdDev(int lane) const{
+		return (mean[lane]!=0)? StdDev(lane)/std::fabs(mean[lane]): 0;
+	}
+	inline double MAD(int lane) const{return mad.Get(lane, n);}
+
+	//Half width of the 95% confidence interval of the mean, relative to the
+	// mean (Student's t, since we often only have a handful of samples).
+	inline double RelativeCI95(int lane) const{
+		if(n<2){return DBL_MAX;}
+		return StudentT95(n-1)*RelativeStdDev(lane)/std::sqrt( static_cast<double>(n) );
+	}
+
+	PerformanceCounters Min()   const{return FromLanes(min);}
+	PerformanceCounters Max()   const{return FromLanes(max);}
+	PerformanceCounters Mean()  const{return FromLanes(mean);}
+	PerformanceCounters Median()const{return Quantile(median);}
+	PerformanceCounters P10()   const{return Quantile(p10);}
+	PerformanceCounters P90()   const{return Quantile(p90);}
+	PerformanceCounters StdDev()const{
+		Lanes x;
+		for(auto l=0; l<kNumLanes; l++){x[l]=StdDev(l);}
+		return FromLanes(x);
+	}
+
+private:
+	PerformanceCounters Quantile(P2Quantile const& q) const{
+		Lanes x;
+		for(auto l=0; l<kNumLanes; l++){x[l]=q.Get(l, n);}
+		return FromLanes(x);
+	}
+};
+//=============================================================================
+
+#endif /* statistics_h */
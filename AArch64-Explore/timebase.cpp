@@ -0,0 +1,151 @@
+//
+//  timebase.cpp
+//  AArch64-Explore
+//
+//  A calibrated wall-clock timebase, and tracking of the core frequency.
+//
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "timebase.h"
+
+//How long to calibrate over; the error is dominated by the clock_gettime()
+// read at each end, so longer is better, up to a point.
+static auto const kCalibrationNs=100E6;
+//Clock reads at each end; we keep the pair that brackets most tightly.
+static auto const kCalibrationReads=32;
+//Samples shorter than this are too coarse (one timebase tick is ~40ns on
+// Apple) to say anything about the frequency.
+static auto const kMinFrequencySampleNs=50E3;
+
+double g_timebaseNsPerTick=1;
+static double g_timebaseFrequency       =0;
+static double g_timebaseNominalFrequency=0;
+static double g_calibrationErrorNs      =0;
+
+static double g_peakGHz       =0;
+static uint64_t g_frequencyDrops=0;
+//=============================================================================
+
+static double monotonic_raw_ns(void){
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return ts.tv_sec*1E9+ts.tv_nsec;
+}
+
+//One (ticks, ns) point: the timebase read in the middle of the tightest of
+// kCalibrationReads clock_gettime() brackets.
+//Returns the width of that bracket in errorNs.
+static pair<double, double> calibration_point(double& errorNs){
+	auto best=pair(0.0, 0.0);
+	errorNs=INFINITY;
+	for(auto i=0; i<kCalibrationReads; i++){
+		auto before=monotonic_raw_ns();
+		auto ticks =read_timebase_ticks();
+		auto after =monotonic_raw_ns();
+		if(after-before<errorNs){
+			errorNs=after-before;
+			best=pair(double(ticks), (before+after)/2);
+		}
+	}
+	return best;
+}
+//.............................................................................
+
+static double nominal_frequency(void){
+#if defined(__aarch64__)
+	uint64_t frequency;
+	asm volatile("mrs %0, cntfrq_el0" : "=r" (frequency));
+	return frequency;
+#elif defined(__x86_64__)
+	//Leaf 0x15 gives the TSC/crystal ratio, when the CPU bothers to fill it in.
+	unsigned eax, ebx, ecx, edx;
+	if( __get_cpuid(0x15, &eax, &ebx, &ecx, &edx) && eax!=0 && ecx!=0 ){
+		return double(ecx)*ebx/eax;
+	}
+	return 0;
+#else
+	return 1E9;
+#endif
+}
+
+void calibrate_timebase(void){
+	static auto fCalibrated=false;
+	if(fCalibrated){return;}
+	fCalibrated=true;
+
+#if defined(__x86_64__)
+	//Without an invariant TSC the tick rate follows the core clock, and
+	// there is no timebase to calibrate.
+	unsigned eax, ebx, ecx, edx;
+	if( !__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx&(1<<8)) ){
+		printf("TSC is not invariant; realtime_ns will be unreliable\n");
+	}
+#endif
+
+	double startError, endError;
+	auto start=calibration_point(startError);
+	while(monotonic_raw_ns()-start.second<kCalibrationNs){}
+	auto end  =calibration_point(endError);
+
+	g_timebaseFrequency       =(end.first-start.first)/(end.second-start.second)*1E9;
+	g_timebaseNsPerTick       =1E9/g_timebaseFrequency;
+	g_timebaseNominalFrequency=nominal_frequency();
+	g_calibrationErrorNs      =(startError+endError)/2;
+}
+
+double timebase_frequency(void){
+	return g_timebaseFrequency;
+}
+
+double timebase_nominal_frequency(void){
+	return g_timebaseNominalFrequency;
+}
+//.............................................................................
+
+void print_timebase(void){
+	auto frequency=g_timebaseFrequency;
+	auto nominal  =g_timebaseNominalFrequency;
+	printf("Timebase: %.4f MHz measured", frequency/1E6);
+	if(nominal>0){
+		printf(", %.4f MHz nominal", nominal/1E6);
+	}
+	printf(" (+-%.0f ppm)\n", g_calibrationErrorNs/kCalibrationNs*1E6);
+	//More than 0.1% off means the firmware's CNTFRQ is wrong, or the TSC
+	// ratio is. Trust the measurement.
+	if( nominal>0 && fabs(frequency-nominal)/nominal>0.001 ){
+		printf("Timebase runs %.2f%% from its nominal rate; using measured\n",
+		  (frequency-nominal)/nominal*100);
+	}
+}
+//=============================================================================
+
+bool note_core_frequency(double cycles, double ns){
+	if(cycles<=0 || ns<kMinFrequencySampleNs){return true;}
+	auto ghz=cycles/ns;
+	g_peakGHz=std::max(g_peakGHz, ghz);
+	if(ghz>=kFrequencyDropFraction*g_peakGHz){return true;}
+
+	//Report the first few, then just count.
+	if(g_frequencyDrops++<4){
+		printf("Frequency drop: sample ran at %.2f GHz, peak %.2f GHz\n",
+		  ghz, g_peakGHz);
+	}
+	return false;
+}
+
+double peak_core_frequency_ghz(void){
+	return g_peakGHz;
+}
+
+uint64_t frequency_drop_count(void){
+	return g_frequencyDrops;
+}
+//=============================================================================
@@ -0,0 +1,90 @@
+//
+//  timebase.h
+//  AArch64-Explore
+//
+//  A calibrated wall-clock timebase, and tracking of the core frequency.
+//
+
+#ifndef timebase_h
+#define timebase_h
+
+#include <cstdint>
+#include <time.h>
+using namespace std;
+
+//=============================================================================
+#pragma mark Introduction
+/*
+	Two different clocks matter to us.
+
+	The timebase is a constant rate counter that ticks regardless of what the
+	core clock is doing: CNTVCT_EL0 on AArch64 (24MHz on Apple, often 25MHz
+	to 1GHz elsewhere), the invariant TSC on x86. Reading it is a single
+	instruction, much cheaper than a syscall. We do not trust the nominal
+	rate (CNTFRQ_EL0 is set by firmware and is sometimes simply wrong; the
+	TSC has no architected rate at all), so at startup we calibrate it
+	against CLOCK_MONOTONIC_RAW, and all realtime_ns values come from it.
+
+	The core clock is what the cycles counter counts. The ratio of the two
+	over a sample is the frequency the core actually ran at. Earlier code
+	assumed that was 3.2GHz; now every CycleAverager sample reports it to
+	note_core_frequency(), which keeps the peak seen so far and flags
+	samples that ran noticeably slower (thermal throttling, an E core, a
+	power-managed DVFS step, ...) since their cycle counts and their
+	bandwidths no longer describe the same machine.
+*/
+//=============================================================================
+
+//Samples below this fraction of the peak frequency seen are flagged.
+static auto const kFrequencyDropFraction=0.97;
+
+//Reads the raw timebase (not serializing beyond what is noted).
+inline uint64_t read_timebase_ticks(void){
+#if defined(__aarch64__)
+	uint64_t ticks;
+	//The isb stops the read being hoisted above earlier instructions.
+	asm volatile("isb; mrs %0, cntvct_el0" : "=r" (ticks) :: "memory");
+	return ticks;
+#elif defined(__x86_64__)
+	uint32_t lo, hi;
+	asm volatile("rdtscp" : "=a" (lo), "=d" (hi) :: "rcx", "memory");
+	return (uint64_t(hi)<<32)|lo;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return ts.tv_sec*1000000000ull+ts.tv_nsec;
+#endif
+}
+
+//Calibrates the timebase; cheap to call again (it only runs once).
+//Called from setup_performance_counters().
+void calibrate_timebase(void);
+
+//Ticks per second, as measured (and as the hardware claims, 0 if unknown).
+double timebase_frequency(void);
+double timebase_nominal_frequency(void);
+
+//Conversion factor, valid after calibrate_timebase().
+extern double g_timebaseNsPerTick;
+
+inline double timebase_ns(void){
+	return read_timebase_ticks()*g_timebaseNsPerTick;
+}
+
+void print_timebase(void);
+//=============================================================================
+
+//Records the frequency of one sample (ignored if cycles is zero, i.e. no
+// cycle counter, or the sample is too short to time accurately).
+//Returns false if this sample ran below kFrequencyDropFraction of the peak
+// frequency seen so far.
+bool note_core_frequency(double cycles, double ns);
+
+//Highest frequency seen so far, in GHz (0 if none yet).
+double peak_core_frequency_ghz(void);
+
+//How many samples note_core_frequency() has flagged, in total.
+uint64_t frequency_drop_count(void);
+//=============================================================================
+
+#endif /* timebase_h */